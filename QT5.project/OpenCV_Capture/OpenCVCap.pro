@@ -41,13 +41,20 @@ INCLUDEPATH += $$PWD/main \
     $$PWD/main/ui
 
 SOURCES += main/main.cpp \
+    main/helper/FramePool.cpp \
     main/helper/MatToQImage.cpp \
     main/helper/MeanShift.cpp \
     main/helper/MyUtils.cpp \
+    main/helper/ProcessingPipeline.cpp \
     main/helper/RangeSlider.cpp \
     main/helper/SharedImageBuffer.cpp \
+    main/helper/V4L2Capture.cpp \
     main/helper/_ProcessingFrame.cpp \
     main/helper/tcpsendpix.cpp \
+    main/magnification/Magnificator.cpp \
+    main/magnification/RieszPyramid.cpp \
+    main/magnification/SpatialFilter.cpp \
+    main/magnification/TemporalFilter.cpp \
     main/threads/CaptureThread.cpp \
     main/threads/PlayerThread.cpp \
     main/threads/ProcessingThread.cpp \
@@ -55,19 +62,28 @@ SOURCES += main/main.cpp \
     main/ui/CameraConnectDialog.cpp \
     main/ui/CameraView.cpp \
     main/ui/FrameLabel.cpp \
+    main/ui/GLFrameView.cpp \
+    main/ui/MagnifyOptions.cpp \
     main/ui/MainWindow.cpp \
     main/ui/VideoView.cpp
 
 
 HEADERS += \
     main/helper/ComplexMat.h \
+    main/helper/FramePool.h \
     main/helper/MatToQImage.h \
     main/helper/MeanShift.h \
     main/helper/MyUtils.h \
+    main/helper/ProcessingPipeline.h \
     main/helper/RangeSlider.h \
     main/helper/SharedImageBuffer.h \
+    main/helper/V4L2Capture.h \
     main/helper/_ProcessingFrame.h \
     main/helper/tcpsendpix.h \
+    main/magnification/Magnificator.h \
+    main/magnification/RieszPyramid.h \
+    main/magnification/SpatialFilter.h \
+    main/magnification/TemporalFilter.h \
     main/threads/CaptureThread.h \
     main/threads/PlayerThread.h \
     main/threads/ProcessingThread.h \
@@ -75,16 +91,21 @@ HEADERS += \
     main/ui/CameraConnectDialog.h \
     main/ui/CameraView.h \
     main/ui/FrameLabel.h \
+    main/ui/GLFrameView.h \
+    main/ui/MagnifyOptions.h \
     main/ui/MainWindow.h \
     main/ui/VideoView.h \
     main/other/Buffer.h \
     main/other/Config.h \
+    main/other/FrameMailbox.h \
+    main/other/FrameSlot.h \
     main/other/Structures.h
 
 FORMS += \
     main/ui/MainWindow.ui \
     main/ui/CameraView.ui \
     main/ui/CameraConnectDialog.ui \
+    main/ui/MagnifyOptions.ui \
     main/ui/VideoView.ui
 
 # Spare me those nasty C++ compiler warnings and pray instead
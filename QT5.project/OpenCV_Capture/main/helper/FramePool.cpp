@@ -0,0 +1,66 @@
+/************************************************************************************/
+/* An OpenCV/Qt based realtime application			                    */
+/*                                                                                  */
+/*                                                                                  */
+/* Based on the work of                                                             */
+/*      Joseph Pan      <https://github.com/wzpan/QtEVM>                            */
+/*      Nick D'Ademo    <https://github.com/nickdademo/qt-opencv-multithreaded>     */
+/*                                                                                  */
+/* helper/FramePool.cpp                                                             */
+/*                                                                                  */
+/* This program is free software: you can redistribute it and/or modify             */
+/* it under the terms of the GNU General Public License as published by             */
+/* the Free Software Foundation, either version 3 of the License, or                */
+/* (at your option) any later version.                                              */
+/*                                                                                  */
+/* This program is distributed in the hope that it will be useful,                  */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of                   */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    */
+/* GNU General Public License for more details.                                     */
+/*                                                                                  */
+/* You should have received a copy of the GNU General Public License                */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.            */
+/************************************************************************************/
+
+#include "main/helper/FramePool.h"
+
+#include <algorithm>
+
+FramePool::FramePool(int nSlots)
+{
+	// Create (still unallocated) slots, memory is allocated by the first retrieve into each slot
+	slots.resize(std::max(nSlots, 1));
+	// Initialize variables(s)
+	nextSlot = 0;
+	misses = 0;
+}
+
+Mat& FramePool::acquire()
+{
+	int n = (int)slots.size();
+	// Look for a slot nobody else holds a reference to, starting after the last one handed out
+	for (int i = 0; i < n; i++) {
+		int idx = (nextSlot + i) % n;
+		Mat &slot = slots[idx];
+		if (slot.u == NULL || CV_XADD(&slot.u->refcount, 0) == 1) {
+			nextSlot = (idx + 1) % n;
+			return slot;
+		}
+	}
+	// All slots are in flight: fall back to a fresh allocation
+	misses++;
+	if (misses == 1)
+		qDebug() << "FramePool: all" << n << "slots in use, allocating extra frame";
+	overflow.release();
+	return overflow;
+}
+
+int FramePool::size()
+{
+	return (int)slots.size();
+}
+
+int FramePool::getMisses()
+{
+	return misses;
+}
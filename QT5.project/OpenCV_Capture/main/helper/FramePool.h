@@ -0,0 +1,60 @@
+/************************************************************************************/
+/* An OpenCV/Qt based realtime application			                    */
+/*                                                                                  */
+/*                                                                                  */
+/* Based on the work of                                                             */
+/*      Joseph Pan      <https://github.com/wzpan/QtEVM>                            */
+/*      Nick D'Ademo    <https://github.com/nickdademo/qt-opencv-multithreaded>     */
+/*                                                                                  */
+/* helper/FramePool.h                                                               */
+/*                                                                                  */
+/* This program is free software: you can redistribute it and/or modify             */
+/* it under the terms of the GNU General Public License as published by             */
+/* the Free Software Foundation, either version 3 of the License, or                */
+/* (at your option) any later version.                                              */
+/*                                                                                  */
+/* This program is distributed in the hope that it will be useful,                  */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of                   */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    */
+/* GNU General Public License for more details.                                     */
+/*                                                                                  */
+/* You should have received a copy of the GNU General Public License                */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.            */
+/************************************************************************************/
+
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+// C++
+#include <vector>
+// Qt
+#include <QDebug>
+// OpenCV
+#include <opencv2/core.hpp>
+
+using namespace cv;
+
+/*  FramePool
+ *
+ *    Fixed set of reference-counted frame slots owned by CaptureThread. A slot is
+ *    free again once every other Mat header referring to it (image buffer,
+ *    ProcessingThread) has been released, so frames are retrieved straight into
+ *    reused memory and handed downstream without copying.
+ *
+ */
+class FramePool
+{
+public:
+	FramePool(int nSlots);
+	Mat& acquire();
+	int size();
+	int getMisses();
+
+private:
+	std::vector<Mat> slots;
+	Mat overflow;
+	int nextSlot;
+	int misses;
+};
+
+#endif // FRAMEPOOL_H
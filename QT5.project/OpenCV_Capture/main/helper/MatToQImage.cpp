@@ -25,31 +25,85 @@
 #include "main/helper/MatToQImage.h"
 // Qt
 #include <QDebug>
+// OpenCV
+#include <opencv2/imgproc.hpp>
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 5, 0)
+// Gray color table, built once (used to translate colour indexes to qRgb values)
+static const QVector<QRgb>& grayColorTable()
+{
+	static const QVector<QRgb> colorTable = [] {
+		QVector<QRgb> table(256);
+		for (int i = 0; i < 256; i++)
+			table[i] = qRgb(i, i, i);
+		return table;
+	}();
+	return colorTable;
+}
+#endif
+
+// Copy rows of mat into the (already allocated) image, one memcpy if both are contiguous
+static void copyRows(const Mat& mat, QImage& img)
+{
+	const size_t rowBytes = mat.cols * mat.elemSize();
+	if (mat.isContinuous() && (size_t)img.bytesPerLine() == rowBytes) {
+		memcpy(img.bits(), mat.data, rowBytes * mat.rows);
+		return;
+	}
+	for (int i = 0; i < mat.rows; i++)
+		memcpy(img.scanLine(i), mat.ptr(i), rowBytes);
+}
 
 QImage MatToQImage(const Mat& mat)
 {
 	// 8-bits unsigned, NO. OF CHANNELS=1
 	if (mat.type() == CV_8UC1) {
-		// Set the color table (used to translate colour indexes to qRgb values)
-		QVector<QRgb> colorTable;
-		for (int i = 0; i < 256; i++)
-			colorTable.push_back(qRgb(i, i, i));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+		QImage img(mat.cols, mat.rows, QImage::Format_Grayscale8);
+#else
+		QImage img(mat.cols, mat.rows, QImage::Format_Indexed8);
+		img.setColorTable(grayColorTable());
+#endif
+		if (img.isNull())
+			return img;
 		// Copy input Mat
-		const uchar *qImageBuffer = (const uchar*)mat.data;
-		// Create QImage with same dimensions as input Mat
-		QImage img(qImageBuffer, mat.cols, mat.rows, mat.step, QImage::Format_Indexed8);
-		img.setColorTable(colorTable);
+		copyRows(mat, img);
 		return img;
 	}
 	// 8-bits unsigned, NO. OF CHANNELS=3
 	else if (mat.type() == CV_8UC3) {
-		// Copy input Mat
-		const uchar *qImageBuffer = (const uchar*)mat.data;
-		// Create QImage with same dimensions as input Mat
-		QImage img(qImageBuffer, mat.cols, mat.rows, mat.step, QImage::Format_RGB888);
-		return img.rgbSwapped();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+		// Qt takes BGR as is, plain copy
+		QImage img(mat.cols, mat.rows, QImage::Format_BGR888);
+		if (img.isNull())
+			return img;
+		copyRows(mat, img);
+#else
+		// Swap BGR->RGB straight into the image buffer (no rgbSwapped() copy)
+		QImage img(mat.cols, mat.rows, QImage::Format_RGB888);
+		if (img.isNull())
+			return img;
+		Mat dst(mat.rows, mat.cols, CV_8UC3, img.bits(), img.bytesPerLine());
+		cvtColor(mat, dst, COLOR_BGR2RGB);
+#endif
+		return img;
 	}else {
 		qDebug() << "ERROR: Mat could not be converted to QImage.";
 		return QImage();
 	}
 }
+
+QImage MatToQImage(const Mat& mat, const QSize& displaySize, Mat& scaled)
+{
+	// Display size not known yet, show the frame as is
+	if (displaySize.isEmpty() || mat.empty())
+		return MatToQImage(mat);
+	// Same fit as QPixmap::scaled(..., Qt::KeepAspectRatio) on the GUI side
+	QSize fit = QSize(mat.cols, mat.rows).scaled(displaySize, Qt::KeepAspectRatio);
+	if (fit.isEmpty() || (fit.width() == mat.cols && fit.height() == mat.rows))
+		return MatToQImage(mat);
+	// INTER_AREA for downscaling (no aliasing), bilinear when the label is larger than the frame
+	int interpolation = (fit.width() < mat.cols) ? INTER_AREA : INTER_LINEAR;
+	cv::resize(mat, scaled, Size(fit.width(), fit.height()), 0, 0, interpolation);
+	return MatToQImage(scaled);
+}
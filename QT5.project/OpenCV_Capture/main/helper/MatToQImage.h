@@ -34,5 +34,7 @@
 using namespace cv;
 
 QImage MatToQImage(const Mat&);
+// Scaled to fit displaySize (aspect ratio kept) into the reusable buffer scaled, then converted
+QImage MatToQImage(const Mat& mat, const QSize& displaySize, Mat& scaled);
 
 #endif // MATTOQIMAGE_H
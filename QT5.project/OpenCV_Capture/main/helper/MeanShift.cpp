@@ -1,6 +1,7 @@
 //---------------- Head  File ---------------------------------------
 #include "MeanShift.h"
 #include <math.h>
+#include <opencv2/core/hal/intrin.hpp>
 
 //---------------- Name space ---------------------------------------
 using namespace cv;
@@ -10,7 +11,7 @@ using namespace std;
 #define MS_MAX_NUM_CONVERGENCE_STEPS	5										// up to 10 steps are for convergence
 #define MS_MEAN_SHIFT_TOL_COLOR			0.3										// minimum mean color shift change
 #define MS_MEAN_SHIFT_TOL_SPATIAL		0.3										// minimum mean spatial shift change
-const int dxdy[][2] = {{-1,-1},{-1,0},{-1,1},{0,-1},{0,1},{1,-1},{1,0},{1,1}};	// Region Growing
+const int dxdyVisited[][2] = {{-1,-1},{-1,0},{-1,1},{0,-1}};							// Union-find, neighbours before the pixel
 
 // Constructor
 Point5D::Point5D(){
@@ -91,221 +92,235 @@ void Point5D::Print(){
 MeanShift::MeanShift(float s, float r){
 	hs = s;
 	hr = r;
+	SampleBudget = 0;
+}
+
+// Sum up all window samples of one row within the color bandwidth of (cl, ca, cb)
+// Lab is the interleaved (l, a, b) float row, columns [Left, Right)
+static inline void MSAccumRow(const float *Lab, int Left, int Right, float cl, float ca, float cb, float hr2,
+			      float &SumL, float &SumA, float &SumB, float &SumY, int &NumPts){
+	int hy = Left;
+#if CV_SIMD128
+	v_float32x4 vcl = v_setall_f32(cl), vca = v_setall_f32(ca), vcb = v_setall_f32(cb);
+	v_float32x4 vhr2 = v_setall_f32(hr2), vone = v_setall_f32(1.f), vstep = v_setall_f32(4.f);
+	v_float32x4 vsl = v_setzero_f32(), vsa = v_setzero_f32(), vsb = v_setzero_f32();
+	v_float32x4 vsy = v_setzero_f32(), vn = v_setzero_f32();
+	v_float32x4 vy((float)hy, (float)(hy + 1), (float)(hy + 2), (float)(hy + 3));
+	for(; hy <= Right - 4; hy += 4){
+		v_float32x4 l, a, b;
+		v_load_deinterleave(Lab + hy * 3, l, a, b);
+		v_float32x4 dl = l - vcl, da = a - vca, db = b - vcb;
+		// Squared color distance against squared bandwidth
+		v_float32x4 mask = (dl * dl + da * da + db * db) < vhr2;
+		vsl += l & mask;
+		vsa += a & mask;
+		vsb += b & mask;
+		vsy += vy & mask;
+		vn += vone & mask;
+		vy += vstep;
+	}
+	SumL += v_reduce_sum(vsl);
+	SumA += v_reduce_sum(vsa);
+	SumB += v_reduce_sum(vsb);
+	SumY += v_reduce_sum(vsy);
+	NumPts += cvRound(v_reduce_sum(vn));
+#endif
+	for(; hy < Right; hy++){
+		const float *Pt = Lab + hy * 3;
+		float dl = Pt[0] - cl, da = Pt[1] - ca, db = Pt[2] - cb;
+		if(dl * dl + da * da + db * db < hr2){
+			SumL += Pt[0];
+			SumA += Pt[1];
+			SumB += Pt[2];
+			SumY += hy;
+			NumPts++;
+		}
+	}
 }
 
 // Mean Shift Filtering
 void MeanShift::MSFiltering(Mat& Img){
 	int ROWS = Img.rows;			// Get row number
 	int COLS = Img.cols;			// Get column number
-	split(Img, IMGChannels);		// Split Lab color
+	if(ROWS == 0 || COLS == 0)
+		return;
 
-	Point5D PtCur;					// Current point
-	Point5D PtPrev;					// Previous point
-	Point5D PtSum;					// Sum vector of the shift vector
-	Point5D Pt;
-	int Left;						// Left boundary
-	int Right;						// Right boundary
-	int Top;						// Top boundary
-	int Bottom;						// Bottom boundary
-	int NumPts;						// number of points in a hypersphere
-	int step;
-	
-	for(int i = 0; i < ROWS; i++){
-		for(int j = 0; j < COLS; j++){
-			Left = (j - hs) > 0 ? (j - hs) : 0;						// Get Left boundary of the filter
-			Right = (j + hs) < COLS ? (j + hs) : COLS;				// Get Right boundary of the filter
-			Top = (i - hs) > 0 ? (i - hs) : 0;						// Get Top boundary of the filter
-			Bottom = (i + hs) < ROWS ? (i + hs) : ROWS;				// Get Bottom boundary of the filter
-			// Set current point and scale it to Lab color range
-			PtCur.MSPOint5DSet(i, j, (float)IMGChannels[0].at<uchar>(i, j), (float)IMGChannels[1].at<uchar>(i, j), (float)IMGChannels[2].at<uchar>(i, j));
-			PtCur.PointLab();
-			step = 0;				// count the times
-			do{
-				PtPrev.MSPoint5DCopy(PtCur);						// Set the original point and previous one
-				PtSum.MSPOint5DSet(0, 0, 0, 0, 0);					// Initial Sum vector
-				NumPts = 0;											// Count number of points that satisfy the bandwidths
-				for(int hx = Top; hx < Bottom; hx++){
-					for(int hy = Left; hy < Right; hy++){
-						// Set point in the spatial bandwidth
-						Pt.MSPOint5DSet(hx, hy, (float)IMGChannels[0].at<uchar>(hx, hy), (float)IMGChannels[1].at<uchar>(hx, hy), (float)IMGChannels[2].at<uchar>(hx, hy));
-						Pt.PointLab();
+	// Interleaved float Lab buffer, scaled to Lab range once per frame
+	Img.convertTo(LabBuffer, CV_32F);
+	multiply(LabBuffer, Scalar(100.0 / 255, 1, 1), LabBuffer);
+	subtract(LabBuffer, Scalar(0, 128, 128), LabBuffer);
+
+	// Optional work bound per frame: fewer convergence steps for large frames/windows
+	int MaxSteps = MS_MAX_NUM_CONVERGENCE_STEPS;
+	if(SampleBudget > 0){
+		double Window = (double)min(2 * hs, (float)COLS) * min(2 * hs, (float)ROWS);
+		double Steps = SampleBudget / ((double)ROWS * COLS * max(Window, 1.0));
+		MaxSteps = (int)max(1.0, min((double)MS_MAX_NUM_CONVERGENCE_STEPS, Steps));
+	}
 
-						// Check it satisfied color bandwidth or not
-						if(Pt.MSPoint5DColorDistance(PtCur) < hr){
-							PtSum.MSPoint5DAccum(Pt);				// Accumulate the point to Sum vector
-							NumPts++;								// Count
-						}
+	const float hr2 = hr * hr;
+	const float TolColor2 = MS_MEAN_SHIFT_TOL_COLOR * MS_MEAN_SHIFT_TOL_COLOR;
+	const float TolSpatial2 = MS_MEAN_SHIFT_TOL_SPATIAL * MS_MEAN_SHIFT_TOL_SPATIAL;
+	const Mat &Lab = LabBuffer;
+
+	// Rows are independent: every pixel only reads the Lab buffer
+	parallel_for_(Range(0, ROWS), [&](const Range &range){
+		for(int i = range.start; i < range.end; i++){
+			Vec3b *Out = Img.ptr<Vec3b>(i);
+			const float *Center = Lab.ptr<float>(i);
+			for(int j = 0; j < COLS; j++){
+				int Left = (j - hs) > 0 ? (j - hs) : 0;						// Get Left boundary of the filter
+				int Right = (j + hs) < COLS ? (j + hs) : COLS;				// Get Right boundary of the filter
+				int Top = (i - hs) > 0 ? (i - hs) : 0;						// Get Top boundary of the filter
+				int Bottom = (i + hs) < ROWS ? (i + hs) : ROWS;				// Get Bottom boundary of the filter
+				// Current point
+				float x = i, y = j;
+				float l = Center[j * 3 + 0], a = Center[j * 3 + 1], b = Center[j * 3 + 2];
+				int step = 0;				// count the times
+				float dc2, ds2;
+				do{
+					float SumX = 0, SumY = 0, SumL = 0, SumA = 0, SumB = 0;
+					int NumPts = 0;											// Count number of points that satisfy the bandwidths
+					for(int hx = Top; hx < Bottom; hx++){
+						int RowPts = 0;
+						MSAccumRow(Lab.ptr<float>(hx), Left, Right, l, a, b, hr2, SumL, SumA, SumB, SumY, RowPts);
+						SumX += (float)hx * RowPts;
+						NumPts += RowPts;
 					}
-				}
-				PtSum.MSPoint5DScale(1.0 / NumPts);					// Scale Sum vector to average vector
-				PtCur.MSPoint5DCopy(PtSum);							// Get new origin point
-				step++;												// One time end
-			// filter iteration to end
-			}while((PtCur.MSPoint5DColorDistance(PtPrev) > MS_MEAN_SHIFT_TOL_COLOR) && (PtCur.MSPoint5DSpatialDistance(PtPrev) > MS_MEAN_SHIFT_TOL_SPATIAL) && (step < MS_MAX_NUM_CONVERGENCE_STEPS));
-			
-			// Scale the color
-			PtCur.PointRGB();
-			// Copy the result to image
-			Img.at<Vec3b>(i, j) = Vec3b(PtCur.l, PtCur.a, PtCur.b);
+					// Nothing within the color bandwidth: keep the current point
+					if(NumPts == 0)
+						break;
+					float Scale = 1.0f / NumPts;
+					float dx = SumX * Scale - x, dy = SumY * Scale - y;
+					float dl = SumL * Scale - l, da = SumA * Scale - a, db = SumB * Scale - b;
+					x += dx; y += dy; l += dl; a += da; b += db;		// Get new origin point
+					dc2 = dl * dl + da * da + db * db;
+					ds2 = dx * dx + dy * dy;
+					step++;												// One time end
+				// filter iteration to end
+				}while((dc2 > TolColor2) && (ds2 > TolSpatial2) && (step < MaxSteps));
+
+				// Scale the color back and copy the result to image
+				Out[j] = Vec3b((uchar)(l * 255 / 100), (uchar)(a + 128), (uchar)(b + 128));
+			}
 		}
+	});
+}
+
+// Find the root label with path halving
+static inline int MSFindRoot(int *Parent, int Label){
+	while(Parent[Label] != Label){
+		Parent[Label] = Parent[Parent[Label]];
+		Label = Parent[Label];
 	}
+	return Label;
 }
 
-void MeanShift::MSSegmentation(Mat& Img){
+// Merge two sets, the smaller label becomes the root (keeps labels in raster order)
+static inline void MSUnion(int *Parent, int A, int B){
+	A = MSFindRoot(Parent, A);
+	B = MSFindRoot(Parent, B);
+	if(A < B)
+		Parent[B] = A;
+	else if(B < A)
+		Parent[A] = B;
+}
 
-//---------------- Mean Shift Filtering -----------------------------
-	// Same as MSFiltering function
+// Mean Shift Segmentation
+// Filtering, then 8-connected components of neighbours closer than the color bandwidth
+void MeanShift::MSSegmentation(Mat& Img){
+	MSFiltering(Img);
 	int ROWS = Img.rows;
 	int COLS = Img.cols;
-	split(Img, IMGChannels);
-
-	Point5D PtCur;
-	Point5D PtPrev;
-	Point5D PtSum;
-	Point5D Pt;
-	int Left;
-	int Right;
-	int Top;
-	int Bottom;
-	int NumPts;					// number of points in a hypersphere
-	int step;
-	
-	for(int i = 0; i < ROWS; i++){
-		for(int j = 0; j < COLS; j++){
-			Left = (j - hs) > 0 ? (j - hs) : 0;
-			Right = (j + hs) < COLS ? (j + hs) : COLS;
-			Top = (i - hs) > 0 ? (i - hs) : 0;
-			Bottom = (i + hs) < ROWS ? (i + hs) : ROWS;
-			PtCur.MSPOint5DSet(i, j, (float)IMGChannels[0].at<uchar>(i, j), (float)IMGChannels[1].at<uchar>(i, j), (float)IMGChannels[2].at<uchar>(i, j));
-			PtCur.PointLab();
-			step = 0;
-			do{
-				PtPrev.MSPoint5DCopy(PtCur);
-				PtSum.MSPOint5DSet(0, 0, 0, 0, 0);
-				NumPts = 0;
-				for(int hx = Top; hx < Bottom; hx++){
-					for(int hy = Left; hy < Right; hy++){
-						
-						Pt.MSPOint5DSet(hx, hy, (float)IMGChannels[0].at<uchar>(hx, hy), (float)IMGChannels[1].at<uchar>(hx, hy), (float)IMGChannels[2].at<uchar>(hx, hy));
-						Pt.PointLab();
+	Regions.clear();
+	if(ROWS == 0 || COLS == 0)
+		return;
 
-						if(Pt.MSPoint5DColorDistance(PtCur) < hr){
-							PtSum.MSPoint5DAccum(Pt);
-							NumPts++;
-						}
-					}
-				}
-				PtSum.MSPoint5DScale(1.0 / NumPts);
-				PtCur.MSPoint5DCopy(PtSum);
-				step++;
-			}while((PtCur.MSPoint5DColorDistance(PtPrev) > MS_MEAN_SHIFT_TOL_COLOR) && (PtCur.MSPoint5DSpatialDistance(PtPrev) > MS_MEAN_SHIFT_TOL_SPATIAL) && (step < MS_MAX_NUM_CONVERGENCE_STEPS));
-			
-			PtCur.PointRGB();
-			Img.at<Vec3b>(i, j) = Vec3b(PtCur.l, PtCur.a, PtCur.b);
-		}
-	}
-//--------------------------------------------------------------------
+	// Lab of the filtered image
+	Img.convertTo(LabBuffer, CV_32F);
+	multiply(LabBuffer, Scalar(100.0 / 255, 1, 1), LabBuffer);
+	subtract(LabBuffer, Scalar(0, 128, 128), LabBuffer);
+	const float hr2 = hr * hr;
 
-//----------------------- Segmentation ------------------------------
-	int RegionNumber = 0;			// Reigon number
-	int label = -1;					// Label number
-	float *Mode = new float [ROWS * COLS * 3];					// Store the Lab color of each region
-	int *MemberModeCount = new int [ROWS * COLS];				// Store the number of each region
-	memset(MemberModeCount, 0, ROWS * COLS * sizeof(int));		// Initialize the MemberModeCount
-	split(Img, IMGChannels);
-	// Label for each point
-	int **Labels = new int *[ROWS];
-	for(int i = 0; i < ROWS; i++)
-		Labels[i] = new int [COLS];
-
-	// Initialization
+//----------------------- Pass 1: union ------------------------------
+	Labels.create(ROWS, COLS, CV_32S);
+	int *Parent = Labels.ptr<int>(0);		// Labels is continuous, holds the parent index during pass 1
 	for(int i = 0; i < ROWS; i++){
+		const float *Cur = LabBuffer.ptr<float>(i);
+		const float *Up = (i > 0) ? LabBuffer.ptr<float>(i - 1) : NULL;
 		for(int j = 0; j < COLS; j++){
-			Labels[i][j] = -1;
+			int Idx = i * COLS + j;
+			Parent[Idx] = Idx;
+			const float *Pt = Cur + j * 3;
+			// Already visited neighbours: NW, N, NE, W
+			for(int k = 0; k < 4; k++){
+				int hx = i + dxdyVisited[k][0];
+				int hy = j + dxdyVisited[k][1];
+				if((hx < 0) || (hy < 0) || (hy >= COLS))
+					continue;
+				const float *P = ((hx == i) ? Cur : Up) + hy * 3;
+				float dl = Pt[0] - P[0], da = Pt[1] - P[1], db = Pt[2] - P[2];
+				// Check the color
+				if(dl * dl + da * da + db * db < hr2)
+					MSUnion(Parent, Idx, hx * COLS + hy);
+			}
 		}
 	}
 
-	for(int i = 0; i < ROWS; i++){
-		for(int j = 0; j < COLS;j ++){
-			// If the point is not being labeled
-			if(Labels[i][j] < 0){
-				Labels[i][j] = ++label;		// Give it a new label number
-				// Get the point
-				PtCur.MSPOint5DSet(i, j, (float)IMGChannels[0].at<uchar>(i, j), (float)IMGChannels[1].at<uchar>(i, j), (float)IMGChannels[2].at<uchar>(i, j));
-				PtCur.PointLab();
-
-				// Store each value of Lab
-				Mode[label * 3 + 0] = PtCur.l;
-				Mode[label * 3 + 1] = PtCur.a;
-				Mode[label * 3 + 2] = PtCur.b;
-				
-				// Region Growing 8 Neighbours
-				vector<Point5D> NeighbourPoints;
-				NeighbourPoints.push_back(PtCur);
-				while(!NeighbourPoints.empty()){
-					Pt = NeighbourPoints.back();
-					NeighbourPoints.pop_back();
-
-					// Get 8 neighbours
-					for(int k = 0; k < 8; k++){
-						int hx = Pt.x + dxdy[k][0];
-						int hy = Pt.y + dxdy[k][1];
-						if((hx >= 0) && (hy >= 0) && (hx < ROWS) && (hy < COLS) && (Labels[hx][hy] < 0)){
-							Point5D P;
-							P.MSPOint5DSet(hx, hy, (float)IMGChannels[0].at<uchar>(hx, hy), (float)IMGChannels[1].at<uchar>(hx, hy), (float)IMGChannels[2].at<uchar>(hx, hy));
-							P.PointLab();
-
-							// Check the color
-							if(PtCur.MSPoint5DColorDistance(P) < hr){
-								// Satisfied the color bandwidth
-								Labels[hx][hy] = label;				// Give the same label					
-								NeighbourPoints.push_back(P);		// Push it into stack
-								MemberModeCount[label]++;			// This region number plus one
-								// Sum all color in same region
-								Mode[label * 3 + 0] += P.l;
-								Mode[label * 3 + 1] += P.a;
-								Mode[label * 3 + 2] += P.b;
-							}
-						}
-					}
-				}
-				MemberModeCount[label]++;							// Count the point itself
-				Mode[label * 3 + 0] /= MemberModeCount[label];		// Get average color
-				Mode[label * 3 + 1] /= MemberModeCount[label];
-				Mode[label * 3 + 2] /= MemberModeCount[label];
-			}
+//----------------------- Pass 2: label ------------------------------
+	// Parents always precede their members in raster order, so a single pass resolves
+	// every pixel; resolved entries hold -(label + 1)
+	int RegionNumber = 0;
+	for(int Idx = 0; Idx < ROWS * COLS; Idx++){
+		int P = Parent[Idx];
+		int Label;
+		if(P == Idx){
+			Label = RegionNumber++;
+			Parent[Idx] = -Label - 1;
+			MSRegion Region;
+			Region.Area = 0;
+			Region.MeanLab = Vec3f(0, 0, 0);
+			Region.Box = Rect(Idx % COLS, Idx / COLS, 1, 1);
+			Regions.push_back(Region);
+		}else{
+			Parent[Idx] = Parent[P];
+			Label = -Parent[Idx] - 1;
 		}
+		// Region statistics
+		MSRegion &Region = Regions[Label];
+		const Vec3b &Color = Img.at<Vec3b>(Idx / COLS, Idx % COLS);
+		Region.Area++;
+		Region.MeanLab += Vec3f(Color[0], Color[1], Color[2]);
+		Region.Box |= Rect(Idx % COLS, Idx / COLS, 1, 1);
 	}
-	RegionNumber = label + 1;										// Get region number
-	
-	// Get result image from Mode array
+	// Final labels 0..RegionNumber-1
+	for(int Idx = 0; Idx < ROWS * COLS; Idx++)
+		Parent[Idx] = -Parent[Idx] - 1;
+	for(size_t r = 0; r < Regions.size(); r++)
+		Regions[r].MeanLab *= 1.0f / Regions[r].Area;
+
+	// Get result image from the region colors
 	for(int i = 0; i < ROWS; i++){
+		const int *Label = Labels.ptr<int>(i);
+		Vec3b *Out = Img.ptr<Vec3b>(i);
 		for(int j = 0; j < COLS; j++){
-			label = Labels[i][j];
-			float l = Mode[label * 3 + 0];
-			float a = Mode[label * 3 + 1];
-			float b = Mode[label * 3 + 2];
-			Point5D Pixel;
-			Pixel.MSPOint5DSet(i, j, l, a, b);
-			Pixel.PointRGB();
-//			Pixel.Print();
-			Img.at<Vec3b>(i, j) = Vec3b(Pixel.l, Pixel.a, Pixel.b);
+			const Vec3f &Mean = Regions[Label[j]].MeanLab;
+			Out[j] = Vec3b(saturate_cast<uchar>(Mean[0]), saturate_cast<uchar>(Mean[1]), saturate_cast<uchar>(Mean[2]));
 		}
 	}
-//--------------------------------------------------------------------
+}
+
+// Number of regions found by the last MSSegmentation
+int MeanShift::getRegionCount(){
+	return (int)Regions.size();
+}
 
-//	for(int i = 0; i < ROWS; i++){
-//		for(int j = 0; j < COLS - 1; j++){
-//			if(Labels[i][j] != Labels[i][j + 1])
-//				Img.at<Vec3b>(i, j) = Vec3b(255, 255, 255);
-//		}
-//	}
+// Area, mean color (OpenCV Lab) and bounding box per region of the last MSSegmentation
+const vector<MSRegion>& MeanShift::getRegions(){
+	return Regions;
+}
 
-//--------------- Delete Memory Applied Before -----------------------
-	delete[] Mode;
-	delete[] MemberModeCount;
-	
-	for(int i = 0; i < ROWS; i++)
-		delete[] Labels[i];
-	delete[] Labels;
+// Region label per pixel (CV_32S) of the last MSSegmentation
+const Mat& MeanShift::getLabels(){
+	return Labels;
 }
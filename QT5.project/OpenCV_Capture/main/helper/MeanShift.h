@@ -32,13 +32,27 @@ public:
 	void Print();                                      // Print 5D point
 };
 
+// Region found by Mean Shift Segmentation
+struct MSRegion {
+	int Area;               // number of pixels
+	Vec3f MeanLab;          // mean color, OpenCV 8-bit Lab range
+	Rect Box;               // bounding box
+};
+
 class MeanShift {
 public:
 	float hs;               // spatial radius
 	float hr;               // color radius
+	double SampleBudget;    // window samples per MSFiltering call, caps the convergence steps (0: unlimited)
 	vector<Mat> IMGChannels;
+	Mat LabBuffer;          // interleaved float Lab of the frame being filtered
+	Mat Labels;             // region label per pixel (CV_32S)
+	vector<MSRegion> Regions;
 public:
 	MeanShift(float, float);                              // Constructor for spatial bandwidth and color bandwidth
 	void MSFiltering(Mat&);                               // Mean Shift Filtering
 	void MSSegmentation(Mat&);                            // Mean Shift Segmentation
+	int getRegionCount();                                 // Number of regions of the last segmentation
+	const vector<MSRegion>& getRegions();                 // Region statistics of the last segmentation
+	const Mat& getLabels();                               // Label image of the last segmentation
 };
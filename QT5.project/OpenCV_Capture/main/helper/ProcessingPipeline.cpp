@@ -0,0 +1,655 @@
+/************************************************************************************/
+/* An OpenCV/Qt based realtime application			                    */
+/*                                                                                  */
+/*                                                                                  */
+/* Based on the work of                                                             */
+/*      Joseph Pan      <https://github.com/wzpan/QtEVM>                            */
+/*      Nick D'Ademo    <https://github.com/nickdademo/qt-opencv-multithreaded>     */
+/*                                                                                  */
+/* helper/ProcessingPipeline.cpp                                                    */
+/*                                                                                  */
+/* This program is free software: you can redistribute it and/or modify             */
+/* it under the terms of the GNU General Public License as published by             */
+/* the Free Software Foundation, either version 3 of the License, or                */
+/* (at your option) any later version.                                              */
+/*                                                                                  */
+/* This program is distributed in the hope that it will be useful,                  */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of                   */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    */
+/* GNU General Public License for more details.                                     */
+/*                                                                                  */
+/* You should have received a copy of the GNU General Public License                */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.            */
+/************************************************************************************/
+
+#include "main/helper/ProcessingPipeline.h"
+#include "main/helper/_ProcessingFrame.h"
+#include "main/helper/MeanShift.h"
+
+/*  PrefixStage
+ *
+ *    gray, flip, blur, dilate and erode; run in parallel horizontal bands when the
+ *    frame is large enough, each band (plus halo rows) goes through all enabled steps
+ *    while it is still in cache. The halo absorbs the band edge effects so the result
+ *    is bit-exact with the serial path.
+ *
+ */
+class PrefixStage : public ProcessingStage
+{
+public:
+	string name()
+	{
+		return label;
+	}
+
+	bool configure(const ImageProcessingFlags &flags, const ImageProcessingSettings &settings)
+	{
+		grayscaleOn = flags.grayscaleOn;
+		flipOn = flags.flipOn;
+		blurOn = flags.blurOn;
+		dilateOn = flags.dilateOn;
+		erodeOn = flags.erodeOn;
+		flipcode = settings.flipcode;
+		blurType = settings.blurType;
+		morphOption = settings.morphOption;
+		dilateIterations = settings.dilateNumberOfIterations;
+		erodeIterations = settings.erodeNumberOfIterations;
+		tileBands = settings.tileBands;
+		// Creating kernel matrix for morph blur
+		element.release();
+		if (blurOn && blurType == 2) {
+			int morph_elem = 2;
+			int morph_size = 2;
+			element = getStructuringElement(morph_elem, Size(2 * morph_size + 1, 2 * morph_size + 1), Point(morph_size, morph_size));
+		}
+		// Name after the fused steps
+		label.clear();
+		if (grayscaleOn) label += "gray+";
+		if (flipOn) label += "flip+";
+		if (blurOn) label += "blur+";
+		if (dilateOn) label += "dilate+";
+		if (erodeOn) label += "erode+";
+		if (!label.empty())
+			label.erase(label.size() - 1);
+		return grayscaleOn || flipOn || blurOn || dilateOn || erodeOn;
+	}
+
+	void process(Mat &f)
+	{
+		if (processBands(f))
+			return;
+		// Convert to grayscale
+		if (grayscaleOn && (f.channels() >= 3))
+			cvtColor(f, f, cv::COLOR_BGR2GRAY, 1);
+		// Flip
+		if (flipOn)
+			flip(f, f, flipcode); //0:x-axis 1:y-axis -1:both-axis
+		filter(f);
+	}
+
+private:
+	// Blur/Smooth, dilate and erode in place. Borders are isolated: on a ROI view of the grabbed frame the
+	// filters must not read parent pixels outside it, since a band is a standalone copy of its rows
+	void filter(Mat &f)
+	{
+		if (blurOn) {
+			switch (blurType) {
+			default:
+			case 0: // Median, in place it filters a copy of f, so it never reads outside either
+				medianBlur(f, f, 3);
+				break;
+			case 1: //Gaussian
+				GaussianBlur(f, f, cv::Size(5, 5), 2, 2, BORDER_DEFAULT | BORDER_ISOLATED);
+				break;
+			case 2:  //Morph
+				morphologyEx(f, f, morphOption, element, Point(-1, -1), 1, BORDER_CONSTANT | BORDER_ISOLATED);
+				break;
+			}
+		}
+		if (dilateOn)
+			dilate(f, f, Mat(), Point(-1, -1), dilateIterations, BORDER_CONSTANT | BORDER_ISOLATED);
+		if (erodeOn)
+			erode(f, f, Mat(), Point(-1, -1), erodeIterations, BORDER_CONSTANT | BORDER_ISOLATED);
+	}
+
+	// Rows a band needs above and below itself: the sum of the enabled kernel radii
+	int haloRows(int rows)
+	{
+		int halo = 0;
+		if (blurOn) {
+			switch (blurType) {
+			default:
+			case 0: // Median 3x3
+				halo += 1;
+				break;
+			case 1: // Gaussian 5x5
+				halo += 2;
+				break;
+			case 2: // Morph 5x5, compound operations apply the element twice
+				if (morphOption == MORPH_OPEN || morphOption == MORPH_CLOSE ||
+				    morphOption == MORPH_TOPHAT || morphOption == MORPH_BLACKHAT)
+					halo += 4;
+				else
+					halo += 2;
+				break;
+			}
+		}
+		// Default 3x3 element, n iterations grow the radius by n (never more than the frame)
+		if (dilateOn)
+			halo += min(max(dilateIterations, 0), rows);
+		if (erodeOn)
+			halo += min(max(erodeIterations, 0), rows);
+		return halo;
+	}
+
+	// Returns false if the frame should be processed serially instead
+	bool processBands(Mat &f)
+	{
+		if (f.empty() || tileBands == 0 || tileBands == 1)
+			return false;
+
+		int halo = haloRows(f.rows);
+		int bands = (tileBands < 0) ? getNumThreads() : tileBands;
+		bands = min(bands, f.rows / max(TILE_MIN_BAND_ROWS, 4 * halo));
+		if (bands < 2)
+			return false;
+
+		const Mat src = f;
+		int rows = src.rows;
+		bool toGray = grayscaleOn && (src.channels() >= 3);
+
+		// Reuse the previous output unless somebody still holds on to it
+		if (tiledOutput.u != NULL && CV_XADD(&tiledOutput.u->refcount, 0) != 1)
+			tiledOutput.release();
+		tiledOutput.create(src.size(), toGray ? CV_MAKETYPE(src.depth(), 1) : src.type());
+		Mat dst = tiledOutput;
+
+		parallel_for_(Range(0, bands), [&](const Range &range) {
+			static thread_local Mat fetched, grayBand;
+			for (int b = range.start; b < range.end; b++) {
+				int y0 = rows * b / bands;
+				int y1 = rows * (b + 1) / bands;
+				int a = max(y0 - halo, 0);
+				int e = min(y1 + halo, rows);
+				// Fetch band and halo, already flipped (flip commutes with the pointwise gray conversion)
+				if (flipOn) {
+					Range srcRows = (flipcode <= 0) ? Range(rows - e, rows - a) : Range(a, e);
+					flip(src.rowRange(srcRows), fetched, flipcode);
+				}else
+					src.rowRange(a, e).copyTo(fetched);
+				Mat &band = toGray ? grayBand : fetched;
+				if (toGray)
+					cvtColor(fetched, grayBand, cv::COLOR_BGR2GRAY, 1);
+				filter(band);
+				// Stitch the exact rows back
+				band.rowRange(y0 - a, y1 - a).copyTo(dst.rowRange(y0, y1));
+			}
+		});
+
+		f = dst;
+		return true;
+	}
+
+	bool grayscaleOn, flipOn, blurOn, dilateOn, erodeOn;
+	int flipcode, blurType, morphOption, dilateIterations, erodeIterations, tileBands;
+	Mat element;
+	Mat tiledOutput;
+	string label;
+};
+
+// HSV segment and histogram
+class HsvStage : public ProcessingStage
+{
+public:
+	string name()
+	{
+		return "hsv";
+	}
+
+	bool configure(const ImageProcessingFlags &flags, const ImageProcessingSettings &settings)
+	{
+		equalizeOn = flags.hsvEqualizeOn;
+		low = Scalar(settings.hsvHueLow, settings.hsvSatLow, settings.hsvValLow);
+		high = Scalar(settings.hsvHueHigh, settings.hsvSatHigh, settings.hsvValHigh);
+		return flags.hsvHistogramOn;
+	}
+
+	void process(Mat &f)
+	{
+		if (f.channels() < 3)
+			return;
+		// Convert from BGR to HSV colorspace
+		cvtColor(f, frameHSV, COLOR_BGR2HSV);
+		// Detect the object based on HSV Range Values
+		inRange(frameHSV, low, high, frameMask);
+		GaussianBlur(frameMask, frameMask, Size(5, 5), 2, 2);
+		// Convert back BGR for HSV and Mask
+		cvtColor(frameMask, frameMaskBGR, COLOR_GRAY2BGR);
+		cvtColor(frameHSV, frameHSV, COLOR_HSV2BGR);
+		bitwise_and(frameHSV, frameMaskBGR, f);
+
+		if (equalizeOn) {
+			split(frameHSV, planes); //H,S,V
+			equalizeHist(planes[2], planes[2]); //equalize V plane
+			merge(planes, f);
+		}
+
+		//Do histogram calc...
+		calcHistogram(f, f);
+	}
+
+private:
+	bool equalizeOn;
+	Scalar low, high;
+	Mat frameHSV, frameMask, frameMaskBGR;
+	vector<Mat> planes;
+};
+
+// Canny edge detection
+class CannyStage : public ProcessingStage
+{
+public:
+	string name()
+	{
+		return "canny";
+	}
+
+	bool configure(const ImageProcessingFlags &flags, const ImageProcessingSettings &settings)
+	{
+		threshold1 = settings.cannyThreshold1;
+		threshold2 = settings.cannyThreshold2;
+		apertureSize = settings.cannyApertureSize;
+		L2gradient = settings.cannyL2gradient;
+		return flags.cannyOn;
+	}
+
+	void process(Mat &f)
+	{
+		if (f.channels() >= 3) cvtColor(f, gray, COLOR_BGR2GRAY);
+		else f.copyTo(gray);
+
+		GaussianBlur(gray, gray, Size(3, 3), 0);
+		Canny(gray, edges, threshold1, threshold2, apertureSize, L2gradient);
+		if (f.channels() >= 3) {
+			split(f, channels);//split into channels
+			channels[0] = edges; //B
+			channels[2] = edges; //R
+			merge(channels, f);//mergeback
+		}else edges.copyTo(f);
+	}
+
+private:
+	double threshold1, threshold2;
+	int apertureSize;
+	bool L2gradient;
+	Mat gray, edges;
+	vector<Mat> channels;
+};
+
+// Cartoon
+class CartoonStage : public ProcessingStage
+{
+public:
+	string name()
+	{
+		return "cartoon";
+	}
+
+	bool configure(const ImageProcessingFlags &flags, const ImageProcessingSettings &)
+	{
+		return flags.cartoonOn;
+	}
+
+	void process(Mat &f)
+	{
+		cartoonifyImage(f, f);
+	}
+};
+
+// Spatial/Color meanshift
+class MeanShiftStage : public ProcessingStage
+{
+public:
+	// Initilize Mean Shift with spatial bandwith and color bandwith
+	MeanShiftStage() : MSProc(10, 16), segmentOn(false)
+	{
+	}
+
+	string name()
+	{
+		return "meanshift";
+	}
+
+	bool configure(const ImageProcessingFlags &flags, const ImageProcessingSettings &settings)
+	{
+		segmentOn = flags.meanshiftSegmentOn;
+		MSProc.SampleBudget = settings.meanshiftSampleBudget;
+		return flags.meanshiftOn || flags.meanshiftSegmentOn;
+	}
+
+	void process(Mat &f)
+	{
+		if (f.channels() < 3)
+			return;
+		//reduce to 1/4 for faster processing
+		cv::resize(f, img, cv::Size(), 0.5, 0.5);
+		// Convert color from BGR to Lab
+		cvtColor(img, img, COLOR_BGR2Lab);
+		// Filtering or segmentation (filtering + region merge, each region painted with its mean)
+		if (segmentOn)
+			MSProc.MSSegmentation(img);
+		else
+			MSProc.MSFiltering(img);
+		// Convert color from Lab to BGR
+		cvtColor(img, f, COLOR_Lab2BGR);
+	}
+
+private:
+	MeanShift MSProc;
+	Mat img;
+	bool segmentOn;
+};
+
+/*  GrabCutStage
+ *
+ *    simple foreground grabcut with a MOG2 background model owned by this pipeline
+ *    (one per stream); created lazily, dropped on reset() or when the model scale
+ *    changes. With downscale N the model is updated at 1/N resolution and the mask
+ *    is scaled back up.
+ *
+ */
+class GrabCutStage : public ProcessingStage
+{
+public:
+	GrabCutStage() : downscale(1)
+	{
+	}
+
+	string name()
+	{
+		return "grabcut";
+	}
+
+	bool configure(const ImageProcessingFlags &flags, const ImageProcessingSettings &settings)
+	{
+		int newDownscale = max(settings.grabcutDownscale, 1);
+		if (newDownscale != downscale)
+			reset();
+		downscale = newDownscale;
+		return flags.grabcutOn;
+	}
+
+	void process(Mat &f)
+	{
+		if (f.empty()) return;
+		// Init MOG2 BackgroundSubstractor
+		if (backgroundSubtractor.empty())
+			backgroundSubtractor = createBackgroundSubtractorMOG2(false);
+
+		// Update the background model
+		if (downscale > 1) {
+			resize(f, small, Size(max(f.cols / downscale, 1), max(f.rows / downscale, 1)), 0, 0, INTER_AREA);
+			backgroundSubtractor->apply(small, MOGMask);
+		}else
+			backgroundSubtractor->apply(f, MOGMask);
+
+		// Some works with noises on frame //
+		// Blur the foreground mask to reduce the effect of noise and false positives
+		// Remove the shadow parts and the noise
+		medianBlur(MOGMask, MOGMask, 5);
+		threshold(MOGMask, MOGMask, 20, 255, THRESH_BINARY_INV);
+		if (downscale > 1)
+			resize(MOGMask, MOGMask, f.size(), 0, 0, INTER_NEAREST);
+
+		// Using mask to cut foreground (white)
+		f.setTo(Scalar(255, 255, 255), MOGMask);
+	}
+
+	void reset()
+	{
+		backgroundSubtractor.release();
+	}
+
+private:
+	Ptr<BackgroundSubtractor> backgroundSubtractor;
+	Mat small, MOGMask;
+	int downscale;
+};
+
+// PCA orientation of bright objects
+class PcaStage : public ProcessingStage
+{
+public:
+	string name()
+	{
+		return "pca";
+	}
+
+	bool configure(const ImageProcessingFlags &flags, const ImageProcessingSettings &)
+	{
+		return flags.pcaOn;
+	}
+
+	void process(Mat &f)
+	{
+		Mat bin;
+		if (f.channels() >= 3) {
+			cvtColor(f, gray, COLOR_BGR2GRAY);
+			bin = gray;
+		}else bin = f;
+		threshold(bin, bin, 160, 255, THRESH_BINARY);
+		// Find all objects of interest
+		findContours(bin, contours, hierarchy, RETR_LIST, CHAIN_APPROX_NONE);
+
+		if (f.channels() == 1) cvtColor(f, f, COLOR_GRAY2BGR);
+		// For each object
+		for (size_t i = 0; i < contours.size(); ++i) {
+			// Calculate its area
+			double area = contourArea(contours[i]);
+			// Ignore if too small or too large
+			if (area < (32 * 10) || (320 * 100) < area) continue;
+			// Draw the contour
+			drawContours(f, contours, i, CV_RGB(255, 0, 0), 1, LINE_8, hierarchy, 0);
+
+			// Get the object orientation
+			getOrientationPCA(contours[i], f);
+		}
+	}
+
+private:
+	Mat gray;
+	vector<vector<Point> > contours;
+	vector<Vec4i> hierarchy;
+};
+
+/*  ColorCheckerStage
+ *
+ *    MacBeth ColorChecker; the detector is created once. After a detection only a
+ *    padded region around the last chart position is searched, the full frame again
+ *    every researchInterval frames or as soon as the chart is lost.
+ *
+ */
+class ColorCheckerStage : public ProcessingStage
+{
+public:
+	ColorCheckerStage() : tracking(false), framesSinceSearch(0)
+	{
+	}
+
+	string name()
+	{
+		return "colorchecker";
+	}
+
+	bool configure(const ImageProcessingFlags &flags, const ImageProcessingSettings &settings)
+	{
+		// Detector is created once and kept for the lifetime of the pipeline
+		if (flags.colorcheckerOn && detector.empty())
+			detector = cv::mcc::CCheckerDetector::create();
+		researchInterval = settings.colorcheckerResearchInterval;
+		return flags.colorcheckerOn;
+	}
+
+	void process(Mat &f)
+	{
+		if (f.channels() < 3)
+			return;
+		Rect frameRect(0, 0, f.cols, f.rows);
+		// Track inside the padded last position unless a full search is due
+		bool fullSearch = !tracking || researchInterval <= 0 || framesSinceSearch >= researchInterval
+				  || (lastROI & frameRect) != lastROI;
+		bool detected;
+		if (fullSearch) {
+			// Marker type to detect
+			detected = detector->process(f, cv::mcc::TYPECHART(0), 1);
+			framesSinceSearch = 0;
+		}else {
+			detected = detector->process(f, cv::mcc::TYPECHART(0), vector<Rect>(1, lastROI), 1);
+			framesSinceSearch++;
+		}
+		if (!detected) {
+			if (tracking || fullSearch)
+				qDebug("ChartColor not detected \n");
+			tracking = false;
+			return;
+		}
+		// get checker
+		std::vector<cv::Ptr<cv::mcc::CChecker> > checkers = detector->getListColorChecker();
+		for (cv::Ptr<cv::mcc::CChecker> checker : checkers) {
+			// current checker
+			cv::Ptr<cv::mcc::CCheckerDraw> cdraw = cv::mcc::CCheckerDraw::create(checker);
+			cdraw->draw(f);
+		}
+		if (checkers.empty()) {
+			tracking = false;
+			return;
+		}
+		// Remember padded position of the first chart for the next frame
+		Rect box = boundingRect(checkers[0]->getBox());
+		int padX = cvRound(box.width * COLORCHECKER_ROI_PADDING);
+		int padY = cvRound(box.height * COLORCHECKER_ROI_PADDING);
+		lastROI = Rect(box.x - padX, box.y - padY, box.width + 2 * padX, box.height + 2 * padY) & frameRect;
+		tracking = !lastROI.empty();
+	}
+
+	void reset()
+	{
+		tracking = false;
+	}
+
+private:
+	cv::Ptr<cv::mcc::CCheckerDetector> detector;
+	Rect lastROI;
+	bool tracking;
+	int framesSinceSearch;
+	int researchInterval;
+};
+
+/*  MagnifyStage
+ *
+ *    color/laplace/riesz/wavelet magnification, streamed one frame at a time; runs last so it
+ *    magnifies what the other stages produced. The Magnificator keeps the temporal
+ *    filter state between frames, reset() drops it.
+ *
+ */
+class MagnifyStage : public ProcessingStage
+{
+public:
+	string name()
+	{
+		return "magnify";
+	}
+
+	bool configure(const ImageProcessingFlags &flags, const ImageProcessingSettings &settings)
+	{
+		return magnificator.configure(flags, settings);
+	}
+
+	void process(Mat &f)
+	{
+		magnificator.process(f);
+	}
+
+	void reset()
+	{
+		magnificator.clearBuffer();
+	}
+
+	MagnifyCounters getCounters(int mode)
+	{
+		return magnificator.getCounters(mode);
+	}
+
+private:
+	Magnificator magnificator;
+};
+
+ProcessingPipeline::ProcessingPipeline()
+{
+	// All stages in processing order
+	stages.push_back(unique_ptr<ProcessingStage>(new PrefixStage()));
+	stages.push_back(unique_ptr<ProcessingStage>(new HsvStage()));
+	stages.push_back(unique_ptr<ProcessingStage>(new CannyStage()));
+	stages.push_back(unique_ptr<ProcessingStage>(new CartoonStage()));
+	stages.push_back(unique_ptr<ProcessingStage>(new MeanShiftStage()));
+	stages.push_back(unique_ptr<ProcessingStage>(new GrabCutStage()));
+	stages.push_back(unique_ptr<ProcessingStage>(new PcaStage()));
+	stages.push_back(unique_ptr<ProcessingStage>(new ColorCheckerStage()));
+	magnifyStage = new MagnifyStage();
+	stages.push_back(unique_ptr<ProcessingStage>(magnifyStage));
+	timings.resize(stages.size());
+}
+
+/*  update
+ *
+ *    (re)configures every stage and keeps the enabled ones as the per-frame plan,
+ *    called from the updateImageProcessingFlags/updateProcessingSettings slots
+ *
+ */
+void ProcessingPipeline::update(const ImageProcessingFlags &flags, const ImageProcessingSettings &settings)
+{
+	plan.clear();
+	for (size_t i = 0; i < stages.size(); i++) {
+		if (stages[i]->configure(flags, settings))
+			plan.push_back(i);
+		if (timings[i].name != stages[i]->name()) {
+			timings[i].name = stages[i]->name();
+			timings[i].lastMs = 0.0;
+			timings[i].averageMs = 0.0;
+		}
+	}
+}
+
+void ProcessingPipeline::process(Mat *f)
+{
+	for (size_t i = 0; i < plan.size(); i++) {
+		int64 start = getTickCount();
+		stages[plan[i]]->process(*f);
+		// Per-stage time, averaged over roughly the last PIPELINE_TIMING_SMOOTHING frames
+		StageTiming &timing = timings[plan[i]];
+		timing.lastMs = (getTickCount() - start) * 1000.0 / getTickFrequency();
+		if (timing.averageMs == 0.0)
+			timing.averageMs = timing.lastMs;
+		else
+			timing.averageMs += (timing.lastMs - timing.averageMs) / PIPELINE_TIMING_SMOOTHING;
+	}
+}
+
+void ProcessingPipeline::reset()
+{
+	for (size_t i = 0; i < stages.size(); i++)
+		stages[i]->reset();
+}
+
+vector<StageTiming> ProcessingPipeline::getStageTimings()
+{
+	vector<StageTiming> result;
+	for (size_t i = 0; i < plan.size(); i++)
+		result.push_back(timings[plan[i]]);
+	return result;
+}
+
+MagnifyCounters ProcessingPipeline::getMagnifyCounters(int mode)
+{
+	return magnifyStage->getCounters(mode);
+}
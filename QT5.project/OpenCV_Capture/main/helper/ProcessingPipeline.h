@@ -0,0 +1,95 @@
+/************************************************************************************/
+/* An OpenCV/Qt based realtime application			                    */
+/*                                                                                  */
+/*                                                                                  */
+/* Based on the work of                                                             */
+/*      Joseph Pan      <https://github.com/wzpan/QtEVM>                            */
+/*      Nick D'Ademo    <https://github.com/nickdademo/qt-opencv-multithreaded>     */
+/*                                                                                  */
+/* helper/ProcessingPipeline.h                                                      */
+/*                                                                                  */
+/* This program is free software: you can redistribute it and/or modify             */
+/* it under the terms of the GNU General Public License as published by             */
+/* the Free Software Foundation, either version 3 of the License, or                */
+/* (at your option) any later version.                                              */
+/*                                                                                  */
+/* This program is distributed in the hope that it will be useful,                  */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of                   */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    */
+/* GNU General Public License for more details.                                     */
+/*                                                                                  */
+/* You should have received a copy of the GNU General Public License                */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.            */
+/************************************************************************************/
+
+#ifndef PROCESSINGPIPELINE_H
+#define PROCESSINGPIPELINE_H
+
+// C++
+#include <memory>
+#include <string>
+#include <vector>
+// Qt
+#include "QDebug"
+// OpenCV
+#include <opencv2/opencv.hpp>
+// Local
+#include "main/other/Structures.h"
+#include "main/other/Config.h"
+#include "main/magnification/Magnificator.h"
+
+using namespace cv;
+using namespace std;
+
+/*  ProcessingStage
+ *
+ *    one step of the filter chain; configure() is called whenever flags or settings
+ *    change and prepares kernels, detectors and scratch Mats, process() runs per frame
+ *
+ */
+class ProcessingStage
+{
+public:
+	virtual ~ProcessingStage() {}
+	virtual string name() = 0;
+	// Returns true if the stage is enabled by flags
+	virtual bool configure(const ImageProcessingFlags &flags, const ImageProcessingSettings &settings) = 0;
+	virtual void process(Mat &f) = 0;
+	// Drops state that depends on previous frames (e.g. after a ROI change)
+	virtual void reset() {}
+};
+
+class MagnifyStage;
+
+struct StageTiming {
+	string name;
+	double lastMs;
+	double averageMs;
+};
+
+/*  ProcessingPipeline
+ *
+ *    compiled form of ImageProcessingFlags/Settings: an ordered plan of the enabled
+ *    stages, rebuilt by update() only when the flags or settings change. The stage
+ *    objects live as long as the pipeline, so stateful stages keep their state.
+ *
+ */
+class ProcessingPipeline
+{
+public:
+	ProcessingPipeline();
+	void update(const ImageProcessingFlags &flags, const ImageProcessingSettings &settings);
+	void process(Mat *f);
+	void reset();
+	vector<StageTiming> getStageTimings();
+	MagnifyCounters getMagnifyCounters(int mode);
+
+private:
+	vector<unique_ptr<ProcessingStage> > stages;
+	// Also owned by stages, kept to reach the magnification counters
+	MagnifyStage *magnifyStage;
+	vector<int> plan;
+	vector<StageTiming> timings;
+};
+
+#endif // PROCESSINGPIPELINE_H
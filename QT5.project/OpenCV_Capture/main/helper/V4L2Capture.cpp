@@ -0,0 +1,553 @@
+/************************************************************************************/
+/* An OpenCV/Qt based realtime application			                    */
+/*                                                                                  */
+/*                                                                                  */
+/* Based on the work of                                                             */
+/*      Joseph Pan      <https://github.com/wzpan/QtEVM>                            */
+/*      Nick D'Ademo    <https://github.com/nickdademo/qt-opencv-multithreaded>     */
+/*                                                                                  */
+/* helper/V4L2Capture.cpp                                                           */
+/*                                                                                  */
+/* This program is free software: you can redistribute it and/or modify             */
+/* it under the terms of the GNU General Public License as published by             */
+/* the Free Software Foundation, either version 3 of the License, or                */
+/* (at your option) any later version.                                              */
+/*                                                                                  */
+/* This program is distributed in the hope that it will be useful,                  */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of                   */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    */
+/* GNU General Public License for more details.                                     */
+/*                                                                                  */
+/* You should have received a copy of the GNU General Public License                */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.            */
+/************************************************************************************/
+
+#include "main/helper/V4L2Capture.h"
+
+// C++
+#include <algorithm>
+#include <vector>
+// Qt
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QThread>
+// OpenCV
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#if defined(Q_OS_LINUX)
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
+#endif
+
+struct V4L2Buffer {
+	void *start;
+	size_t length;
+};
+
+struct V4L2Device
+{
+	V4L2Device();
+	~V4L2Device();
+	void queue(int index);
+	void stop();
+	int fd;
+	bool fake;
+	bool streaming;
+	QMutex mutex;
+	// Driver buffers (real device)
+	std::vector<V4L2Buffer> buffers;
+	// Mapped file, frame ranges and free buffer slots (fake device)
+	V4L2Buffer file;
+	std::vector<std::pair<size_t, size_t> > fakeFrames;
+	std::vector<bool> fakeQueued;
+	size_t fakeNextFrame;
+	int fakeFrameInterval;
+	QElapsedTimer fakeClock;
+	qint64 fakeNextDue;
+};
+
+// Holds a driver buffer while Mats refer to it
+struct V4L2BufferRef {
+	std::shared_ptr<V4L2Device> device;
+	int index;
+};
+
+/*  V4L2BufferAllocator
+ *
+ *    Allocator attached to Mats wrapping driver buffers. Releasing the last header
+ *    requeues the buffer instead of freeing memory, anything newly allocated through
+ *    such a Mat (e.g. create() with another size) goes to the standard allocator.
+ *
+ */
+class V4L2BufferAllocator : public MatAllocator
+{
+public:
+	UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+			   AccessFlag flags, UMatUsageFlags usageFlags) const override
+	{
+		return Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+	}
+
+	bool allocate(UMatData* u, AccessFlag accessFlags, UMatUsageFlags usageFlags) const override
+	{
+		return Mat::getStdAllocator()->allocate(u, accessFlags, usageFlags);
+	}
+
+	void deallocate(UMatData* u) const override
+	{
+		V4L2BufferRef *ref = (V4L2BufferRef*)u->userdata;
+		if (ref) {
+			ref->device->queue(ref->index);
+			delete ref;
+		}
+		delete u;
+	}
+};
+
+static V4L2BufferAllocator *bufferAllocator()
+{
+	// Never destroyed, frames may still be released during shutdown
+	static V4L2BufferAllocator *allocator = new V4L2BufferAllocator();
+	return allocator;
+}
+
+V4L2Device::V4L2Device()
+{
+	fd = -1;
+	fake = false;
+	streaming = false;
+	file.start = NULL;
+	file.length = 0;
+	fakeNextFrame = 0;
+	fakeFrameInterval = 0;
+	fakeNextDue = 0;
+}
+
+#if defined(Q_OS_LINUX)
+
+static int xioctl(int fd, unsigned long request, void *arg)
+{
+	int r;
+	do {
+		r = ioctl(fd, request, arg);
+	} while (r == -1 && errno == EINTR);
+	return r;
+}
+
+V4L2Device::~V4L2Device()
+{
+	// Last reference is gone: nothing can point into the mappings anymore
+	stop();
+	for (size_t i = 0; i < buffers.size(); i++)
+		munmap(buffers[i].start, buffers[i].length);
+	if (file.start != NULL)
+		munmap(file.start, file.length);
+	if (fd >= 0)
+		::close(fd);
+}
+
+void V4L2Device::queue(int index)
+{
+	QMutexLocker locker(&mutex);
+	// Device was released in the meantime, buffer stays mapped until the device is destroyed
+	if (!streaming)
+		return;
+	if (fake) {
+		fakeQueued[index] = true;
+		return;
+	}
+	struct v4l2_buffer buf;
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = index;
+	if (xioctl(fd, VIDIOC_QBUF, &buf) == -1)
+		qDebug() << "V4L2Capture: VIDIOC_QBUF failed:" << strerror(errno);
+}
+
+void V4L2Device::stop()
+{
+	QMutexLocker locker(&mutex);
+	if (!streaming)
+		return;
+	// Buffers stay mapped (and valid) after stopping the stream
+	if (!fake) {
+		enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		xioctl(fd, VIDIOC_STREAMOFF, &type);
+	}
+	streaming = false;
+}
+
+#else
+
+V4L2Device::~V4L2Device()
+{
+}
+
+void V4L2Device::queue(int)
+{
+}
+
+void V4L2Device::stop()
+{
+}
+
+#endif
+
+V4L2Capture::V4L2Capture()
+{
+	// Initialize variables(s)
+	width = 0;
+	height = 0;
+	bytesPerLine = 0;
+	pixelFormat = 0;
+	currentIndex = -1;
+	currentOffset = 0;
+	currentBytesUsed = 0;
+}
+
+V4L2Capture::~V4L2Capture()
+{
+	release();
+}
+
+bool V4L2Capture::open(int deviceNumber, int width, int height, int fps, int nBuffers)
+{
+	return open("/dev/video" + std::to_string(deviceNumber), width, height, fps, nBuffers);
+}
+
+#if defined(Q_OS_LINUX)
+
+bool V4L2Capture::open(const std::string &path, int width, int height, int fps, int nBuffers)
+{
+	release();
+	// Open device node or regular file (fake device)
+	struct stat st;
+	if (stat(path.c_str(), &st) == -1) {
+		qDebug() << "V4L2Capture: cannot access" << path.c_str();
+		return false;
+	}
+	bool isFile = S_ISREG(st.st_mode);
+	int fd = ::open(path.c_str(), isFile ? O_RDONLY : (O_RDWR | O_NONBLOCK));
+	if (fd == -1) {
+		qDebug() << "V4L2Capture: cannot open" << path.c_str() << strerror(errno);
+		return false;
+	}
+	device = std::make_shared<V4L2Device>();
+	device->fd = fd;
+	bool opened = isFile ? openFakeDevice(fd, width, height, fps, nBuffers)
+			     : openDevice(fd, width, height, fps, nBuffers);
+	if (!opened) {
+		device.reset();
+		return false;
+	}
+	qDebug() << "V4L2Capture: opened" << path.c_str() << this->width << "x" << this->height
+		 << (pixelFormat == V4L2CAPTURE_FMT_MJPEG ? "MJPEG" : "YUYV");
+	return true;
+}
+
+bool V4L2Capture::setFormat(int fd, unsigned int format, int width, int height)
+{
+	struct v4l2_format fmt;
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	// Keep the current size if none was requested
+	if (xioctl(fd, VIDIOC_G_FMT, &fmt) == -1)
+		return false;
+	if (width != -1)
+		fmt.fmt.pix.width = width;
+	if (height != -1)
+		fmt.fmt.pix.height = height;
+	fmt.fmt.pix.pixelformat = format;
+	fmt.fmt.pix.field = V4L2_FIELD_ANY;
+	if (xioctl(fd, VIDIOC_S_FMT, &fmt) == -1 || fmt.fmt.pix.pixelformat != format)
+		return false;
+	// Driver may have adjusted the size
+	this->width = fmt.fmt.pix.width;
+	this->height = fmt.fmt.pix.height;
+	this->bytesPerLine = fmt.fmt.pix.bytesperline;
+	this->pixelFormat = format;
+	return true;
+}
+
+bool V4L2Capture::openDevice(int fd, int width, int height, int fps, int nBuffers)
+{
+	// Check capabilities
+	struct v4l2_capability cap;
+	memset(&cap, 0, sizeof(cap));
+	if (xioctl(fd, VIDIOC_QUERYCAP, &cap) == -1)
+		return false;
+	unsigned int caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+	if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+		qDebug() << "V4L2Capture: device does not support streaming capture";
+		return false;
+	}
+	// Prefer YUYV (cheap to convert), use MJPEG if YUYV cannot deliver the requested size
+	bool yuyv = setFormat(fd, V4L2CAPTURE_FMT_YUYV, width, height);
+	if (!yuyv || (width != -1 && this->width != width) || (height != -1 && this->height != height)) {
+		if (!setFormat(fd, V4L2CAPTURE_FMT_MJPEG, width, height) && !(yuyv && setFormat(fd, V4L2CAPTURE_FMT_YUYV, width, height))) {
+			qDebug() << "V4L2Capture: neither YUYV nor MJPEG supported";
+			return false;
+		}
+	}
+	// Set frame rate
+	if (fps > 0) {
+		struct v4l2_streamparm parm;
+		memset(&parm, 0, sizeof(parm));
+		parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		parm.parm.capture.timeperframe.numerator = 1;
+		parm.parm.capture.timeperframe.denominator = fps;
+		xioctl(fd, VIDIOC_S_PARM, &parm);
+	}
+	// Request and map driver buffers
+	struct v4l2_requestbuffers req;
+	memset(&req, 0, sizeof(req));
+	req.count = nBuffers;
+	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.memory = V4L2_MEMORY_MMAP;
+	if (xioctl(fd, VIDIOC_REQBUFS, &req) == -1 || req.count < 2) {
+		qDebug() << "V4L2Capture: VIDIOC_REQBUFS failed";
+		return false;
+	}
+	for (unsigned int i = 0; i < req.count; i++) {
+		struct v4l2_buffer buf;
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		if (xioctl(fd, VIDIOC_QUERYBUF, &buf) == -1)
+			return false;
+		V4L2Buffer b;
+		b.length = buf.length;
+		b.start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
+		if (b.start == MAP_FAILED)
+			return false;
+		device->buffers.push_back(b);
+		if (xioctl(fd, VIDIOC_QBUF, &buf) == -1)
+			return false;
+	}
+	// Start streaming
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if (xioctl(fd, VIDIOC_STREAMON, &type) == -1)
+		return false;
+	device->streaming = true;
+	return true;
+}
+
+bool V4L2Capture::openFakeDevice(int fd, int width, int height, int fps, int nBuffers)
+{
+	// Map whole file, copy-on-write: retrieve() hands out writable Mats over it
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size < 4)
+		return false;
+	device->fake = true;
+	device->file.length = st.st_size;
+	device->file.start = mmap(NULL, device->file.length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (device->file.start == MAP_FAILED) {
+		device->file.start = NULL;
+		return false;
+	}
+	const uchar *data = (const uchar*)device->file.start;
+	size_t length = device->file.length;
+	if (data[0] == 0xFF && data[1] == 0xD8) {
+		// Concatenated JPEGs: split at every EOI directly followed by SOI
+		size_t start = 0;
+		for (size_t i = 2; i + 3 < length; i++) {
+			if (data[i] == 0xFF && data[i + 1] == 0xD9 && data[i + 2] == 0xFF && data[i + 3] == 0xD8) {
+				device->fakeFrames.push_back(std::make_pair(start, i + 2 - start));
+				start = i + 2;
+			}
+		}
+		device->fakeFrames.push_back(std::make_pair(start, length - start));
+		// Take frame size from the first image
+		Mat first = imdecode(Mat(1, (int)device->fakeFrames[0].second, CV_8UC1, (void*)data), IMREAD_COLOR);
+		if (first.empty())
+			return false;
+		this->width = first.cols;
+		this->height = first.rows;
+		this->bytesPerLine = 0;
+		this->pixelFormat = V4L2CAPTURE_FMT_MJPEG;
+	}else {
+		// Raw YUYV frames of the requested size
+		this->width = (width != -1) ? width : 640;
+		this->height = (height != -1) ? height : 480;
+		this->bytesPerLine = this->width * 2;
+		this->pixelFormat = V4L2CAPTURE_FMT_YUYV;
+		size_t frameSize = (size_t)this->bytesPerLine * this->height;
+		for (size_t offset = 0; offset + frameSize <= length; offset += frameSize)
+			device->fakeFrames.push_back(std::make_pair(offset, frameSize));
+	}
+	if (device->fakeFrames.empty())
+		return false;
+	// Emulate driver buffers and frame rate
+	device->fakeQueued.assign(std::max(nBuffers, 2), true);
+	device->fakeFrameInterval = 1000 / ((fps > 0) ? fps : 30);
+	device->fakeClock.start();
+	device->streaming = true;
+	return true;
+}
+
+bool V4L2Capture::grab()
+{
+	if (!isOpened())
+		return false;
+	// Previous frame was grabbed but never retrieved: give it back
+	if (currentIndex != -1) {
+		device->queue(currentIndex);
+		currentIndex = -1;
+	}
+	if (device->fake)
+		return grabFake();
+	// Wait for a filled buffer
+	fd_set fds;
+	FD_ZERO(&fds);
+	FD_SET(device->fd, &fds);
+	struct timeval tv;
+	tv.tv_sec = 1;
+	tv.tv_usec = 0;
+	if (select(device->fd + 1, &fds, NULL, NULL, &tv) <= 0)
+		return false;
+	// Dequeue it
+	struct v4l2_buffer buf;
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	if (xioctl(device->fd, VIDIOC_DQBUF, &buf) == -1) {
+		if (errno != EAGAIN)
+			qDebug() << "V4L2Capture: VIDIOC_DQBUF failed:" << strerror(errno);
+		return false;
+	}
+	// Corrupted or empty buffers (UVC cameras do deliver them): hand back and skip the frame
+	if ((buf.flags & V4L2_BUF_FLAG_ERROR) || buf.bytesused == 0) {
+		device->queue(buf.index);
+		return false;
+	}
+	currentIndex = buf.index;
+	currentOffset = 0;
+	currentBytesUsed = buf.bytesused;
+	return true;
+}
+
+bool V4L2Capture::grabFake()
+{
+	// Pace frames like a camera would
+	qint64 wait = device->fakeNextDue - device->fakeClock.elapsed();
+	if (wait > 0)
+		QThread::msleep(wait);
+	QMutexLocker locker(&device->mutex);
+	// Find a buffer that is not held downstream
+	int index = -1;
+	for (size_t i = 0; i < device->fakeQueued.size(); i++) {
+		if (device->fakeQueued[i]) {
+			index = (int)i;
+			break;
+		}
+	}
+	// All buffers in use: the frame is lost, as with a real driver
+	device->fakeNextDue = std::max(device->fakeNextDue + device->fakeFrameInterval, device->fakeClock.elapsed());
+	if (index == -1)
+		return false;
+	device->fakeQueued[index] = false;
+	const std::pair<size_t, size_t> &f = device->fakeFrames[device->fakeNextFrame++ % device->fakeFrames.size()];
+	currentIndex = index;
+	currentOffset = f.first;
+	currentBytesUsed = f.second;
+	return true;
+}
+
+#else
+
+bool V4L2Capture::open(const std::string &, int, int, int, int)
+{
+	qDebug() << "V4L2Capture: only available on Linux";
+	return false;
+}
+
+bool V4L2Capture::grab()
+{
+	return false;
+}
+
+#endif
+
+bool V4L2Capture::retrieve(Mat &frame)
+{
+	if (!isOpened() || currentIndex == -1)
+		return false;
+	// Wrap the grabbed buffer without copying
+	uchar *data = (uchar*)(device->fake ? device->file.start : device->buffers[currentIndex].start) + currentOffset;
+	Mat wrapped;
+	if (pixelFormat == V4L2CAPTURE_FMT_YUYV)
+		wrapped = Mat(height, width, CV_8UC2, data, bytesPerLine);
+	else
+		wrapped = Mat(1, (int)currentBytesUsed, CV_8UC1, data);
+	// Tie the Mat to the buffer, it is requeued when the last header is released
+	UMatData *u = new UMatData(bufferAllocator());
+	u->data = u->origdata = data;
+	u->size = currentBytesUsed;
+	u->flags = UMatData::USER_ALLOCATED;
+	u->userdata = new V4L2BufferRef{device, currentIndex};
+	u->refcount = 1;
+	wrapped.u = u;
+	wrapped.allocator = bufferAllocator();
+	frame = wrapped;
+	currentIndex = -1;
+	return true;
+}
+
+bool V4L2Capture::isOpened()
+{
+	return device.get() != NULL;
+}
+
+void V4L2Capture::release()
+{
+	if (!isOpened())
+		return;
+	if (currentIndex != -1) {
+		device->queue(currentIndex);
+		currentIndex = -1;
+	}
+	// Stop streaming; mappings are freed once no frame refers to the device anymore
+	device->stop();
+	device.reset();
+}
+
+int V4L2Capture::getWidth()
+{
+	return width;
+}
+
+int V4L2Capture::getHeight()
+{
+	return height;
+}
+
+unsigned int V4L2Capture::getPixelFormat()
+{
+	return pixelFormat;
+}
+
+bool V4L2Capture::convertToBGR(const Mat &raw, Mat &bgr, unsigned int pixelFormat)
+{
+	switch (pixelFormat) {
+	case V4L2CAPTURE_FMT_YUYV:
+		cvtColor(raw, bgr, COLOR_YUV2BGR_YUYV);
+		return true;
+	case V4L2CAPTURE_FMT_MJPEG:
+		// Decode into the existing buffer (reused if the size matches)
+		imdecode(raw, IMREAD_COLOR, &bgr);
+		return !bgr.empty();
+	default:
+		bgr = raw;
+		return true;
+	}
+}
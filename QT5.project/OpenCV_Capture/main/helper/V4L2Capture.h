@@ -0,0 +1,88 @@
+/************************************************************************************/
+/* An OpenCV/Qt based realtime application			                    */
+/*                                                                                  */
+/*                                                                                  */
+/* Based on the work of                                                             */
+/*      Joseph Pan      <https://github.com/wzpan/QtEVM>                            */
+/*      Nick D'Ademo    <https://github.com/nickdademo/qt-opencv-multithreaded>     */
+/*                                                                                  */
+/* helper/V4L2Capture.h                                                             */
+/*                                                                                  */
+/* This program is free software: you can redistribute it and/or modify             */
+/* it under the terms of the GNU General Public License as published by             */
+/* the Free Software Foundation, either version 3 of the License, or                */
+/* (at your option) any later version.                                              */
+/*                                                                                  */
+/* This program is distributed in the hope that it will be useful,                  */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of                   */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    */
+/* GNU General Public License for more details.                                     */
+/*                                                                                  */
+/* You should have received a copy of the GNU General Public License                */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.            */
+/************************************************************************************/
+
+#ifndef V4L2CAPTURE_H
+#define V4L2CAPTURE_H
+
+// C++
+#include <memory>
+#include <string>
+// Qt
+#include <QtGlobal>
+#include <QDebug>
+// OpenCV
+#include <opencv2/core.hpp>
+
+using namespace cv;
+
+// Raw pixel formats delivered by V4L2Capture (same values as the V4L2 fourcc codes)
+#define V4L2CAPTURE_FOURCC(a, b, c, d)      ((unsigned int)(a) | ((unsigned int)(b) << 8) | ((unsigned int)(c) << 16) | ((unsigned int)(d) << 24))
+#define V4L2CAPTURE_FMT_YUYV                V4L2CAPTURE_FOURCC('Y', 'U', 'Y', 'V')
+#define V4L2CAPTURE_FMT_MJPEG               V4L2CAPTURE_FOURCC('M', 'J', 'P', 'G')
+
+struct V4L2Device;
+
+/*  V4L2Capture
+ *
+ *    Native Video4Linux2 capture backend (Linux only, every call fails elsewhere).
+ *    Driver buffers are mmap'd and handed out as Mats without copying; a buffer is
+ *    requeued to the driver once the last Mat referring to it is released. Frames
+ *    stay in their raw format (YUYV or MJPEG) until convertToBGR() is called.
+ *
+ *    A regular file can be opened instead of a device node for testing: either raw
+ *    YUYV frames of the requested size or a stream of concatenated JPEG images.
+ *
+ */
+class V4L2Capture
+{
+public:
+	V4L2Capture();
+	~V4L2Capture();
+	bool open(int deviceNumber, int width, int height, int fps, int nBuffers);
+	bool open(const std::string &path, int width, int height, int fps, int nBuffers);
+	bool isOpened();
+	void release();
+	bool grab();
+	bool retrieve(Mat &frame);
+	int getWidth();
+	int getHeight();
+	unsigned int getPixelFormat();
+	static bool convertToBGR(const Mat &raw, Mat &bgr, unsigned int pixelFormat);
+
+private:
+	bool openDevice(int fd, int width, int height, int fps, int nBuffers);
+	bool openFakeDevice(int fd, int width, int height, int fps, int nBuffers);
+	bool setFormat(int fd, unsigned int format, int width, int height);
+	bool grabFake();
+	std::shared_ptr<V4L2Device> device;
+	int width;
+	int height;
+	int bytesPerLine;
+	unsigned int pixelFormat;
+	int currentIndex;
+	size_t currentOffset;
+	size_t currentBytesUsed;
+};
+
+#endif // V4L2CAPTURE_H
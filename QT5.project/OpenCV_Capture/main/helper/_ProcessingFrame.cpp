@@ -151,35 +151,6 @@ double getOrientationPCA(vector<Point> &pts, Mat &img)
 	return atan2(eigen_vecs[0].y, eigen_vecs[0].x);
 }
 
-// Make simple frame and MOG2 mask
-Mat frame, MOGMask;
-// Init MOG2 BackgroundSubstractor
-Ptr<BackgroundSubtractor> BackgroundSubstractor;
-static bool initGrabCut = true;
-void cvGrabCut(cv::Mat *f, cv::Mat *o)
-{
-	frame = *f;
-	if (frame.empty()) return;
-	if (initGrabCut) {
-		BackgroundSubstractor = createBackgroundSubtractorMOG2(false);
-		initGrabCut = false;
-	}
-
-	// Update the background model
-	BackgroundSubstractor->apply(frame, MOGMask);
-
-	// Some works with noises on frame //
-	// Blur the foreground mask to reduce the effect of noise and false positives
-	// Remove the shadow parts and the noise
-	medianBlur(MOGMask, MOGMask, 5);
-	threshold(MOGMask, MOGMask, 20, 255, THRESH_BINARY_INV);
-
-	// Zeros images
-	cv::Mat foregroundImg((*f).size(), CV_8UC3, cv::Scalar(255, 255, 255));    //W
-
-	// Using mask to cut foreground
-	foregroundImg.copyTo(*o, MOGMask);
-}
 //
 //https://github.com/zerenlu/cartoon
 //
@@ -224,235 +195,3 @@ void cartoonifyImage(const Mat &srcColor, Mat &dst)
 	dst.setTo(0);
 	bigImg.copyTo(dst, mask);
 }
-/*  cvProcessFrame
- *
- *    main frame processing at here:
- *        Gray, Flip, Blur, Dilate, Erode, Canny, HSV segment/Histogram, MacBeth colorcheck, PCA...
- *
- *    called by threads/PlayerThread.cpp(ui/VideoView.cpp), threads/ProcessingThread.cpp(ui/CameraView.cpp)
- *
- */
-void cvProcessFrame(cv::Mat *f, ImageProcessingFlags flags, ImageProcessingSettings settings)
-{
-	Mat gray, frameHSV, frameMask;
-	vector<Mat> planes;
-
-	// Convert to grayscale
-	if (flags.grayscaleOn && ((*f).channels() >= 3)) {
-		cvtColor(*f, *f, cv::COLOR_BGR2GRAY, 1);
-	}
-	// Flip
-	if (flags.flipOn) {
-		//flip(*frame, *frame, 1); //0:x-axis 1:y-axis -1:both-axis
-		flip(*f, *f, settings.flipcode);
-	}
-	// Blur/Smooth
-	if (flags.blurOn) {
-		//qDebug() << "Blur:" << settings.blurType;
-		switch (settings.blurType) {
-		default:
-		case 0: // Median
-			medianBlur(*f, *f, 3);
-			break;
-		case 1: //Gaussian
-			GaussianBlur(*f, *f, cv::Size(5, 5), 2, 2);
-			break;
-		case 2:  //Morph
-			// Creating kernel matrix
-			int morph_elem = 2;
-			int morph_size = 2;
-			Mat element = getStructuringElement(morph_elem, Size(2 * morph_size + 1, 2 * morph_size + 1), Point(morph_size, morph_size));
-			// Applying Blur effect on the Image
-			morphologyEx(*f, *f, settings.morphOption, element);
-			break;
-		}
-	}
-	// Dilate
-	if (flags.dilateOn) {
-		dilate(*f, *f, Mat(), Point(-1, -1), settings.dilateNumberOfIterations);
-	}
-	// Erode
-	if (flags.erodeOn) {
-		erode(*f, *f, Mat(), Point(-1, -1), settings.erodeNumberOfIterations);
-	}
-	// Do HSV Histogram
-
-	if (flags.hsvHistogramOn && ((*f).channels() >= 3)) {
-		// Convert from BGR to HSV colorspace
-		cvtColor(*f, frameHSV, COLOR_BGR2HSV);
-		// Detect the object based on HSV Range Values
-		inRange(frameHSV, Scalar(settings.hsvHueLow, settings.hsvSatLow, settings.hsvValLow),
-			Scalar(settings.hsvHueHigh, settings.hsvSatHigh, settings.hsvValHigh), frameMask);
-		GaussianBlur(frameMask, frameMask, Size(5, 5), 2, 2);
-		// Convert back BGR for HSV and Mask
-		cvtColor(frameMask, frameMask, COLOR_GRAY2BGR);
-		cvtColor(frameHSV, frameHSV, COLOR_HSV2BGR);
-		*f = frameHSV & frameMask; //bitwise AND
-
-		if (flags.hsvEqualizeOn) {
-			//Mat HSVMat, mergeMat;
-			//vector<Mat> planes;
-			split(frameHSV, planes); //H,S,V
-			equalizeHist(planes[2], planes[2]); //equalize V plane
-			merge(planes, *f);
-		}
-
-		//Do histogram calc...
-		calcHistogram(*f, *f);
-	}
-	// Canny edge detection
-	if (flags.cannyOn) {
-		gray = (*f).clone();
-		if (gray.channels() >= 3) cvtColor(gray, gray, COLOR_BGR2GRAY);
-
-		GaussianBlur(gray, gray, Size(3, 3), 0);
-		Canny(gray, gray, settings.cannyThreshold1, settings.cannyThreshold2, settings.cannyApertureSize, settings.cannyL2gradient);
-		if ((*f).channels() >= 3) {
-			vector<Mat> channels;
-			Mat z = Mat::zeros(gray.rows, gray.cols, CV_8UC1);
-			split(*f, channels);//split into channels
-			channels[0] = gray; //B
-			channels[2] = gray; //R
-			merge(channels, *f);//mergeback
-		}else *f = gray;
-	}
-//
-// sp The spatial window radius.
-// sr The color window radius.
-// maxLevel Maximum level of the pyramid for the segmentation.
-//
-//	pyrMeanShiftFiltering(*f, *f, 20, 45, 3);
-//
-/*
-   cv::Rect rectangle(5, 5, (*f).cols - 5, (*f).rows - 5);
-
-   cv::Mat result;         // segmentation result (4 possible values)
-   cv::Mat bgModel, fgModel;         // the models (internally used)
-
-   // GrabCut segmentation
-   cv::grabCut(*f,           // input image
-          result, // segmentation result
-          rectangle, // rectangle containing foreground
-          bgModel, fgModel, // models
-          1, // number of iterations
-          cv::GC_INIT_WITH_RECT); // use rectangle
-   // Get the pixels marked as likely foreground
-   cv::compare(result, cv::GC_PR_FGD, result, cv::CMP_EQ);
-   // Generate output image
-   cv::Mat foreground((*f).size(), CV_8UC3, cv::Scalar(255, 255, 255));    //Black
-   //*f = foreground & result;
-   foreground.copyTo(*f, result);
- */
-        /*
-           //Floodfill background
-           Point center = Point((*f).size().width / 2, (*f).size().height / 2);
-           Rect rect;
-           floodFill(*f,           //input image
-            center,    //Pick up point
-            Scalar(0, 0, 0), //fill color
-            &rect,         //Redraw the smallest rectangle, the default value is 0;
-            Scalar(30, 30, 30), //Negative difference, the difference between the picked point pixel rgb and the current pixel rgb, the difference is greater than this
-            Scalar(12, 12, 12));       //Positive difference, the difference between the current pixel rgb and the picked point pixel rgb, the difference is less than this
-         */
-/*
-   //Founding largest contour------------------------------------------------
-   cvtColor(*f, gray, COLOR_BGR2GRAY);
-   threshold(gray, gray, 100, 255, THRESH_BINARY_INV); //Threshold the gray
-
-   int largest_contour_index = 0;
-   double largest_area;
-   Rect bounding_rect;
-   vector<vector<Point> > contours; // Vector for storing contour
-   vector<Vec4i> hierarchy;
-   findContours(gray, contours, hierarchy, RETR_CCOMP, CHAIN_APPROX_SIMPLE);
-   // iterate through each contour.
-   for (int i = 0; i < contours.size(); i++) {
-      //  Find the area of contour
-      double a = contourArea(contours[i], false);
-      if (a > largest_area) {
-         largest_area = a; cout << i << " area  " << a << endl;
-         // Store the index of largest contour
-         largest_contour_index = i;
-         // Find the bounding rectangle for biggest contour
-         bounding_rect = boundingRect(contours[i]);
-      }
-   }
-   Scalar color(255, 0, 0);     // color of the contour in the
-   //Draw the contour and rectangle
-   drawContours(*f, contours, largest_contour_index, color, 2, LINE_8, hierarchy);
-   //-----------------------------------------------------------------------------
- */
-        // Do cartoon
-        if (flags.cartoonOn) {
-                cartoonifyImage(*f, *f);
-        }
-
-	// Do Spatial/Color meanshift
-	if (((*f).channels() >= 3) && (flags.meanshiftOn)) {
-		Mat Img = *f;
-		cv::resize(Img, Img, cv::Size(), 0.5, 0.5);                                                                                                                                                                                                                                                           //reduce to 1/4 for faster processing
-		// Convert color from BGR to Lab
-		cvtColor(Img, Img, COLOR_BGR2Lab);
-		// Initilize Mean Shift with spatial bandwith and color bandwith
-		//MeanShift MSProc(8, 16);
-		MeanShift MSProc(10, 16);
-		// Filtering Process
-		MSProc.MSFiltering(Img);
-		// Segmentation Process include Filtering Process (Region Growing)
-		//MSProc.MSSegmentation(Img);
-
-		// Convert color from Lab to BGR
-		//cv::resize(Img, Img, cv::Size(), 2, 2); //do we need to gain back the original size?
-		cvtColor(Img, *f, COLOR_Lab2BGR);
-	}
-
-	// Do simple foreground grabcut
-	if (flags.grabcutOn) {
-		cvGrabCut(f, f);
-	}
-
-
-	// Do PCA
-	if (flags.pcaOn) {
-		if ((*f).channels() >= 3) cvtColor(*f, gray, COLOR_BGR2GRAY);
-		else gray = *f;
-		threshold(gray, gray, 160, 255, THRESH_BINARY);
-		// Find all objects of interest
-		vector<vector<Point> > contours;
-		vector<Vec4i> hierarchy;
-		findContours(gray, contours, hierarchy, RETR_LIST, CHAIN_APPROX_NONE);
-
-		if ((*f).channels() == 1) cvtColor(*f, *f, COLOR_GRAY2BGR);
-		// For each object
-		for (size_t i = 0; i < contours.size(); ++i) {
-			// Calculate its area
-			double area = contourArea(contours[i]);
-			// Ignore if too small or too large
-			if (area < (32 * 10) || (320 * 100) < area) continue;
-			// Draw the contour
-			drawContours(*f, contours, i, CV_RGB(255, 0, 0), 1, LINE_8, hierarchy, 0);
-
-			// Get the object orientation
-			getOrientationPCA(contours[i], *f);
-		}
-	}
-
-
-	// MacBeth ColorChecker
-	if (flags.colorcheckerOn && ((*f).channels() >= 3)) {
-		//Do Macbech colorchecker
-		cv::Ptr<cv::mcc::CCheckerDetector> detector = cv::mcc::CCheckerDetector::create();
-		// Marker type to detect
-		if (!detector->process(*f, cv::mcc::TYPECHART(0), 1)) {
-			qDebug("ChartColor not detected \n");
-		}else {
-			// get checker
-			std::vector<cv::Ptr<cv::mcc::CChecker> > checkers = detector->getListColorChecker();
-			for (cv::Ptr<cv::mcc::CChecker> checker : checkers) {
-				// current checker
-				cv::Ptr<cv::mcc::CCheckerDraw> cdraw = cv::mcc::CCheckerDraw::create(checker);
-				cdraw->draw(*f);
-			}
-		}
-	}
-}
@@ -42,9 +42,9 @@
 using namespace cv;
 using namespace std;
 
-void cvProcessFrame(cv::Mat *frame, ImageProcessingFlags flags, ImageProcessingSettings settings);
 void calcHistogram(cv::Mat s, cv::Mat o);
 double getOrientationPCA(vector<Point> &pts, Mat &img);
 void backgroundSubtrackt(cv::Mat s, cv::Mat o);
+void cartoonifyImage(const Mat &srcColor, Mat &dst);
 
 #endif // _PROCESSINGFRAME_H
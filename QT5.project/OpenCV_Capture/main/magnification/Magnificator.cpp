@@ -27,13 +27,11 @@
 ////////////////////////
 ///Constructor /////////
 ////////////////////////
-Magnificator::Magnificator(std::vector<Mat> *pBuffer,
-                           ImageProcessingFlags *imageProcFlags,
-                           ImageProcessingSettings *imageProcSettings) :
-    processingBuffer(pBuffer),
-    imgProcFlags(imageProcFlags),
-    imgProcSettings(imageProcSettings),
-    currentFrame(0)
+Magnificator::Magnificator() :
+    grayscale(false),
+    mode(MAGNIFY_NONE),
+    frameCount(0),
+    colorWindow(0)
 {
     levels = 4;
     exaggeration_factor = 2.f;
@@ -45,11 +43,93 @@ Magnificator::~Magnificator()
     clearBuffer();
 }
 
-int Magnificator::calculateMaxLevels()
+bool Magnificator::configure(const ImageProcessingFlags &imageProcFlags, const ImageProcessingSettings &imageProcSettings)
 {
-    Size s = processingBuffer->front().size();
-    return calculateMaxLevels(s);
+    int newMode = modeFromFlags(imageProcFlags);
+
+    // Filter state of the old mode/pyramid layout is useless for the new one
+    if(newMode != mode
+            || imageProcSettings.levels != imgProcSettings.levels
+            || imageProcFlags.grayscaleOn != grayscale
+            || imageProcSettings.temporalStorage != imgProcSettings.temporalStorage)
+        clearBuffer();
+
+    mode = newMode;
+    grayscale = imageProcFlags.grayscaleOn;
+    imgProcSettings = imageProcSettings;
+
+    // Butterworth coefficients depend on the framerate, which is only known after the stream started
+    if(loCutoff && hiCutoff && imgProcSettings.framerate > 0
+            && loCutoff->itsFramerate != imgProcSettings.framerate) {
+        loCutoff->updateFramerate(imgProcSettings.framerate);
+        hiCutoff->updateFramerate(imgProcSettings.framerate);
+    }
+
+    return mode != MAGNIFY_NONE;
+}
+
+void Magnificator::process(Mat &frame)
+{
+    if(mode == MAGNIFY_NONE || frame.empty())
+        return;
+
+    // Number of levels in pyramid, limited to what the frame can hold
+    levels = std::max(1, std::min(imgProcSettings.levels, calculateMaxLevels(frame.size())));
+
+    int64 start = getTickCount();
+    switch(mode) {
+    case MAGNIFY_COLOR:
+        colorMagnify(frame);
+        break;
+    case MAGNIFY_LAPLACE:
+        laplaceMagnify(frame);
+        break;
+    case MAGNIFY_RIESZ:
+        rieszMagnify(frame);
+        break;
+    case MAGNIFY_WAVELET:
+        waveletMagnify(frame);
+        break;
+    }
+    ++frameCount;
+
+    // Per-mode time, averaged over roughly the last PIPELINE_TIMING_SMOOTHING frames
+    MagnifyCounters &c = counters[mode];
+    c.lastMs = (getTickCount() - start) * 1000.0 / getTickFrequency();
+    if(c.frames == 0)
+        c.averageMs = c.lastMs;
+    else
+        c.averageMs += (c.lastMs - c.averageMs) / PIPELINE_TIMING_SMOOTHING;
+    c.maxMs = std::max(c.maxMs, c.lastMs);
+    ++c.frames;
+    measureState(c);
 }
+
+int Magnificator::getMode()
+{
+    return mode;
+}
+
+int Magnificator::modeFromFlags(const ImageProcessingFlags &imageProcFlags)
+{
+    if(imageProcFlags.colorMagnifyOn)
+        return MAGNIFY_COLOR;
+    if(imageProcFlags.laplaceMagnifyOn)
+        return MAGNIFY_LAPLACE;
+    if(imageProcFlags.rieszMagnifyOn)
+        return MAGNIFY_RIESZ;
+    if(imageProcFlags.waveletMagnifyOn)
+        return MAGNIFY_WAVELET;
+    return MAGNIFY_NONE;
+}
+
+MagnifyCounters Magnificator::getCounters(int magnifyMode)
+{
+    if(magnifyMode < 0 || magnifyMode >= MAGNIFY_MODES)
+        return MagnifyCounters();
+    return counters[magnifyMode];
+}
+
 int Magnificator::calculateMaxLevels(QRect r)
 {
     Size s = Size(r.width(),r.height());
@@ -67,360 +147,366 @@ int Magnificator::calculateMaxLevels(Size s)
 ////////////////////////
 ///Magnification ///////
 ////////////////////////
-void Magnificator:: colorMagnify() {
-    int pBufferElements = processingBuffer->size();
-    // Magnify only when processing buffer holds new images
-    if(currentFrame >= pBufferElements)
+void Magnificator::colorMagnify(Mat &frame)
+{
+    // The ideal filter maps frequencies to the window, nothing to do without a framerate
+    if(imgProcSettings.framerate <= 0)
         return;
-    // Number of levels in pyramid
-    //levels = DEFAULT_COL_MAG_LEVELS;
-    levels = imgProcSettings->levels;
-    Mat input, output, color, filteredFrame, downSampledFrame, filteredMat;
-    std::vector<Mat> inputFrames, inputPyramid;
-
-    int offset = 0;
-    int pChannels;
-
-    // Process every frame in buffer that wasn't magnified yet
-    while(currentFrame < pBufferElements) {
-        // Grab oldest frame from processingBuffer and delete it to save memory
-        input = processingBuffer->front().clone();
-        processingBuffer->erase(processingBuffer->begin());
-
-        // Convert input image to 32bit float
-        pChannels = input.channels();
-        if(!(imgProcFlags->grayscaleOn || pChannels <= 2))
-            input.convertTo(input, CV_32FC1);
-        else
-            input.convertTo(input, CV_32FC3);
-
-        // Save input frame to add motion later
-        inputFrames.push_back(input);
-
-        /* 1. SPATIAL FILTER, BUILD GAUSS PYRAMID */
-        buildGaussPyrFromImg(input, levels, inputPyramid);
-
-        /* 2. CONCAT EVERY SMALLEST FRAME FROM PYRAMID IN ONE LARGE MAT, 1COL = 1FRAME */
-        downSampledFrame = inputPyramid.at(levels-1);
-        img2tempMat(downSampledFrame, downSampledMat, getOptimalBufferSize(imgProcSettings->framerate));
-
-        // Save how many frames we've currently downsampled
-        ++currentFrame;
-        ++offset;
-    }
 
-    /* 3. TEMPORAL FILTER */
-    idealFilter(downSampledMat, filteredMat, imgProcSettings->coLow, imgProcSettings->coHigh, imgProcSettings->framerate);
-
-    /* 4. AMPLIFY */
-    amplifyGaussian(filteredMat, filteredMat);
-
-    // Add amplified image (color) to every frame
-    for (int i = currentFrame-offset; i < currentFrame; ++i) {
-
-        /* 5. DE-CONCAT 1COL TO DOWNSAMPLED COLOR IMAGE */
-        tempMat2img(filteredMat, i, downSampledFrame.size(), filteredFrame);
-
-        /* 6. RECONSTRUCT COLOR IMAGE FROM PYRAMID */
-        buildImgFromGaussPyr(filteredFrame, levels, color, input.size());
-
-        /* 7. ADD COLOR IMAGE TO ORIGINAL IMAGE */
-        output = inputFrames.front()+color;
+    Mat input, color, filteredFrame;
+
+    // Convert input image to 32bit float, keep the channels
+    frame.convertTo(input, CV_32F);
+
+    /* 1. SPATIAL FILTER, BUILD GAUSS PYRAMID */
+    pyramid.configure(input.size(), input.type(), levels);
+    pyramid.buildGauss(input);
+
+    /* 2. TEMPORAL FILTER, SLIDING WINDOW OVER THE SMALLEST FRAME FROM PYRAMID */
+    // The framerate is measured and jitters, around 16/32/64 fps the optimal window would flip between two
+    // sizes and every resize drops the window. Keep it per stream, a new one is only picked when the
+    // optimal window is at least 4 times larger or smaller (two power of 2 steps)
+    const int optimalWindow = getOptimalBufferSize(imgProcSettings.framerate);
+    if(colorWindow == 0 || optimalWindow >= 4 * colorWindow || 4 * optimalWindow <= colorWindow)
+        colorWindow = optimalWindow;
+    colorFilter.configure(imgProcSettings.coLow, imgProcSettings.coHigh, imgProcSettings.framerate,
+                          colorWindow,
+                          temporalStorageDepth(imgProcSettings.temporalStorage));
+    colorFilter.filter(pyramid.gauss.at(levels-1), filteredFrame);
+
+    /* 3. AMPLIFY */
+    amplifyGaussian(filteredFrame, filteredFrame);
+
+    /* 4. RECONSTRUCT COLOR IMAGE FROM PYRAMID */
+    pyramid.collapseGauss(filteredFrame, color);
+
+    /* 5. ADD COLOR IMAGE TO ORIGINAL IMAGE */
+    input += color;
+
+    // Scale output image and convert back to 8bit unsigned, straight into the frame
+    double min,max;
+    minMaxLoc(input, &min, &max);
+    if(max > min)
+        input.convertTo(frame, frame.type(), 255.0/(max-min), -min * 255.0/(max-min));
+}
 
-        // Scale output image an convert back to 8bit unsigned
-        double min,max;
-        minMaxLoc(output, &min, &max);
-        if(!(imgProcFlags->grayscaleOn || pChannels <= 2)) {
-            output.convertTo(output, CV_8UC1, 255.0/(max-min), -min * 255.0/(max-min));
-        } else {
-            output.convertTo(output, CV_8UC3, 255.0/(max-min), -min * 255.0/(max-min));
+void Magnificator::laplaceMagnify(Mat &frame)
+{
+    Mat input, motion;
+    bool color = frame.channels() > 2;
+
+    // Convert input image to 32bit float
+    frame.convertTo(input, CV_32F, 1.0/255.0f);
+    // Convert color images to YCrCb
+    if(color)
+        cvtColor(input, input, cv::COLOR_BGR2YCrCb);
+
+    /* 1. SPATIAL FILTER, BUILD LAPLACE PYRAMID */
+    pyramid.configure(input.size(), input.type(), levels);
+    pyramid.buildLaplace(input);
+    const vector<Mat> &inputPyramid = pyramid.laplace;
+    const int stateType = CV_MAKETYPE(temporalStorageDepth(imgProcSettings.temporalStorage), input.channels());
+
+    // If first frame of the stream, save unfiltered pyramid and pass the frame through
+    if(lowpassHi.size() != inputPyramid.size()
+            || lowpassHi.front().size() != inputPyramid.front().size()
+            || lowpassHi.front().type() != stateType) {
+        lowpassHi.resize(inputPyramid.size());
+        lowpassLo.resize(inputPyramid.size());
+        motionPyramid.resize(inputPyramid.size());
+        for (size_t curLevel = 0; curLevel < inputPyramid.size(); ++curLevel) {
+            // Lowpass states are updated in place, they must not share data
+            inputPyramid.at(curLevel).convertTo(lowpassHi.at(curLevel), stateType);
+            inputPyramid.at(curLevel).convertTo(lowpassLo.at(curLevel), stateType);
+            // Highest resolution and lowpassed top level are never amplified, they stay 0
+            motionPyramid.at(curLevel) = Mat::zeros(inputPyramid.at(curLevel).size(), inputPyramid.at(curLevel).type());
         }
-
-        // Fill internal buffer with magnified image
-        magnifiedBuffer.push_back(output);
-        // Delete the currently processed input image
-        inputFrames.erase(inputFrames.begin());
+        return;
     }
-}
 
-void Magnificator::laplaceMagnify() {
-    int pBufferElements = processingBuffer->size();
-    // Magnify only when processing buffer holds new images
-    if(currentFrame >= pBufferElements)
-        return;
-    // Number of levels in pyramid
-//    levels = DEFAULT_LAP_MAG_LEVELS;
-    levels = imgProcSettings->levels;
-
-    Mat input, output, motion;
-    vector<Mat> inputPyramid;
-    int pChannels;
-
-    // Process every frame in buffer that wasn't magnified yet
-    while(currentFrame < pBufferElements) {
-        // Grab oldest frame from processingBuffer and delete it to save memory
-        input = processingBuffer->front().clone();
-        if(currentFrame > 0)
-            processingBuffer->erase(processingBuffer->begin());
-
-        // Convert input image to 32bit float
-        pChannels = input.channels();
-        if(!(imgProcFlags->grayscaleOn || pChannels <= 2)) {
-            // Convert color images to YCrCb
-            input.convertTo(input, CV_32FC3, 1.0/255.0f);
-            cvtColor(input, input, cv::COLOR_BGR2YCrCb);
-        }
-        else
-            input.convertTo(input, CV_32FC1, 1.0/255.0f);
-
-        /* 1. SPATIAL FILTER, BUILD LAPLACE PYRAMID */
-        buildLaplacePyrFromImg(input, levels, inputPyramid);
-
-        // If first frame ever, save unfiltered pyramid
-        if(currentFrame == 0) {
-            lowpassHi = inputPyramid;
-            lowpassLo = inputPyramid;
-            motionPyramid = inputPyramid;
-        } else {
-            /* 2. TEMPORAL FILTER EVERY LEVEL OF LAPLACE PYRAMID */
-            for (int curLevel = 0; curLevel < levels; ++curLevel) {
-                iirFilter(inputPyramid.at(curLevel), motionPyramid.at(curLevel), lowpassHi.at(curLevel), lowpassLo.at(curLevel),
-                          imgProcSettings->coLow, imgProcSettings->coHigh);
-            }
+    int w = input.size().width;
+    int h = input.size().height;
 
-            int w = input.size().width;
-            int h = input.size().height;
+    // Amplification variable
+    delta = imgProcSettings.coWavelength / (8.0 * (1.0 + imgProcSettings.amplification));
 
-            // Amplification variable
-            delta = imgProcSettings->coWavelength / (8.0 * (1.0 + imgProcSettings->amplification));
+    // Amplification Booster for better visualization
+    exaggeration_factor = DEFAULT_LAP_MAG_EXAGGERATION;
 
-            // Amplification Booster for better visualization
-            exaggeration_factor = DEFAULT_LAP_MAG_EXAGGERATION;
+    // compute representative wavelength, lambda
+    // reduces for every pyramid level
+    lambda = sqrt(w*w + h*h)/3.0;
 
-            // compute representative wavelength, lambda
-            // reduces for every pyramid level
-            lambda = sqrt(w*w + h*h)/3.0;
+    // Chroma attenuation (if not grayscale), folded into the level kernel: reconstruction is linear per channel
+    float chromGain = color ? static_cast<float>(imgProcSettings.chromAttenuation) : 1.f;
 
-            /* 3. AMPLIFY EVERY LEVEL OF LAPLACE PYRAMID */
-            for (int curLevel = levels; curLevel >= 0; --curLevel) {
-                amplifyLaplacian(motionPyramid.at(curLevel), motionPyramid.at(curLevel), curLevel);
-                lambda /= 2.0;
-            }
+    /* 2.-4. TEMPORAL FILTER, AMPLIFY AND ATTENUATE EVERY LEVEL OF LAPLACE PYRAMID IN ONE PASS */
+    for (int curLevel = levels; curLevel >= 0; --curLevel) {
+        // Level 0 and the top level have gain 0, their lowpass states are never needed
+        if(curLevel < levels && curLevel > 0) {
+            iirBandAmplify(inputPyramid.at(curLevel), motionPyramid.at(curLevel), lowpassHi.at(curLevel), lowpassLo.at(curLevel),
+                           imgProcSettings.coLow, imgProcSettings.coHigh, amplifyLaplacian(curLevel), chromGain);
         }
+        lambda /= 2.0;
+    }
 
-        /* 4. RECONSTRUCT MOTION IMAGE FROM PYRAMID */
-        buildImgFromLaplacePyr(motionPyramid, levels, motion);
-
-        /* 5. ATTENUATE (if not grayscale) */
-        attenuate(motion, motion);
-        /* 6. ADD MOTION TO ORIGINAL IMAGE */
-        if(currentFrame > 0)
-            output = input+motion;
-        else
-            output = input;
-
-        // Scale output image an convert back to 8bit unsigned
-        if(!(imgProcFlags->grayscaleOn || pChannels <= 2)) {
-            // Convert YCrCb image back to BGR
-            cvtColor(output, output, cv::COLOR_YCrCb2BGR);
-            output.convertTo(output, CV_8UC3, 255.0, 1.0/255.0);
-        }
-        else
-            output.convertTo(output, CV_8UC1, 255.0, 1.0/255.0);
+    /* 5. RECONSTRUCT MOTION IMAGE FROM PYRAMID */
+    pyramid.collapseLaplace(motionPyramid, motion);
 
-        // Fill internal buffer with magnified image
-        magnifiedBuffer.push_back(output);
-        ++currentFrame;
-    }
+    /* 6. ADD MOTION TO ORIGINAL IMAGE */
+    input += motion;
+
+    // Scale output image and convert back to 8bit unsigned, straight into the frame
+    if(color)
+        cvtColor(input, input, cv::COLOR_YCrCb2BGR);
+    input.convertTo(frame, frame.type(), 255.0, 1.0/255.0);
 }
 
-void Magnificator::rieszMagnify()
+void Magnificator::rieszMagnify(Mat &frame)
 {
-    int pBufferElements = static_cast<int>(processingBuffer->size());
-    // Magnify only when processing buffer holds new images
-    if(currentFrame >= pBufferElements)
+    // Butterworth coefficients need a framerate
+    if(imgProcSettings.framerate <= 0)
         return;
-    // Number of levels in pyramid
-    levels = imgProcSettings->levels;
 
     Mat buffer_in, input, magnified, output;
     std::vector<cv::Mat> channels;
-    int pChannels;
+    bool color = frame.channels() > 2;
     static const double PI_PERCENT = M_PI / 100.0;
 
-    // Process every frame in buffer that wasn't magnified yet
-    while(currentFrame < pBufferElements)
+    // Convert input image to 32bit float
+    if(color)
     {
-        // Grab oldest frame from processingBuffer and delete it to save memory
-        buffer_in = processingBuffer->front().clone();
-        if(currentFrame > 0)
-        {
-            processingBuffer->erase(processingBuffer->begin());
-        }
+        // Convert color images to YCrCb
+        frame.convertTo(buffer_in, CV_32FC3, 1.0/255.0);
+        cvtColor(buffer_in, buffer_in, COLOR_BGR2YCrCb);
+        cv::split(buffer_in, channels);
+        input = channels[0];
+    }
+    else
+    {
+        frame.convertTo(input, CV_32FC1, 1.0/255.0);
+    }
 
-        // Convert input image to 32bit float
-        pChannels = buffer_in.channels();
-        if(!(imgProcFlags->grayscaleOn || pChannels <= 2))
-        {
-            // Convert color images to YCrCb
-            buffer_in.convertTo(buffer_in, CV_32FC3, 1.0/255.0);
-            cvtColor(buffer_in, buffer_in, COLOR_BGR2YCrCb);
-            cv::split(buffer_in, channels);
-            input = channels[0];
-        }
-        else
-        {
-            buffer_in.convertTo(input, CV_32FC1, 1.0/255.0);
-        }
+    // If first frame of the stream (or the frame layout changed), init pointer and init class,
+    // pass the frame through
+    if( !(curPyr && oldPyr && loCutoff && hiCutoff)
+            || curPyr->numLevels != levels
+            || curPyr->pyrLevels.front().itsLp.size() != input.size() )
+    {
+        // Pyramids
+        curPyr = std::shared_ptr<RieszPyramid>(new RieszPyramid());
+        oldPyr = std::shared_ptr<RieszPyramid>(new RieszPyramid());
+        curPyr->filterRank = imgProcSettings.rieszFilterRank;
+        oldPyr->filterRank = imgProcSettings.rieszFilterRank;
+        curPyr->trigAccuracy = imgProcSettings.rieszTrigAccuracy;
+        oldPyr->trigAccuracy = imgProcSettings.rieszTrigAccuracy;
+        curPyr->init(input, levels);
+        oldPyr->init(input, levels);
+        // Temporal Bandpass Filters, low and highpass (Butterworth)
+        loCutoff = std::shared_ptr<RieszTemporalFilter>(new RieszTemporalFilter(imgProcSettings.coLow, imgProcSettings.framerate));
+        hiCutoff = std::shared_ptr<RieszTemporalFilter>(new RieszTemporalFilter(imgProcSettings.coHigh, imgProcSettings.framerate));
+        loCutoff->computeCoefficients();
+        hiCutoff->computeCoefficients();
+        return;
+    }
 
-        // If first frame ever, init pointer and init class
-        if( !(curPyr && oldPyr && loCutoff && hiCutoff) )
-        {
-            curPyr.reset();
-            oldPyr.reset();
-            loCutoff.reset();
-            hiCutoff.reset();
-            // Pyramids
-            curPyr = std::shared_ptr<RieszPyramid>(new RieszPyramid());
-            oldPyr = std::shared_ptr<RieszPyramid>(new RieszPyramid());
-            curPyr->init(input, levels);
-            oldPyr->init(input, levels);
-            // Temporal Bandpass Filters, low and highpass (Butterworth)
-            loCutoff = std::shared_ptr<RieszTemporalFilter>(new RieszTemporalFilter(imgProcSettings->coLow, imgProcSettings->framerate));
-            hiCutoff = std::shared_ptr<RieszTemporalFilter>(new RieszTemporalFilter(imgProcSettings->coHigh, imgProcSettings->framerate));
-            loCutoff->computeCoefficients();
-            hiCutoff->computeCoefficients();
-        }
-        else
-        {
-            // Check if temporal filter setting was updated
-            // Update low and highpass butterworth filter coefficients if changed in GUI
-            if(loCutoff->itsFrequency != imgProcSettings->coLow)
-            {
-                loCutoff->updateFrequency(imgProcSettings->coLow);
-            }
-            if(hiCutoff->itsFrequency != imgProcSettings->coHigh)
-            {
-                hiCutoff->updateFrequency(imgProcSettings->coHigh);
-            }
+    // Check if temporal filter setting was updated
+    // Update low and highpass butterworth filter coefficients if changed in GUI
+    if(loCutoff->itsFrequency != imgProcSettings.coLow)
+    {
+        loCutoff->updateFrequency(imgProcSettings.coLow);
+    }
+    if(hiCutoff->itsFrequency != imgProcSettings.coHigh)
+    {
+        hiCutoff->updateFrequency(imgProcSettings.coHigh);
+    }
 
-            /* 1. BUILD RIESZ PYRAMID */
-            curPyr->buildPyramid(input);
-            /* 2. UNWRAPE PHASE TO GET HORIZ&VERTICAL / SIN&COS */
-            curPyr->unwrapOrientPhase(*oldPyr);
-            // 3. BANDPASS FILTER ON EACH LEVEL
-            for (int lvl = 0; lvl < curPyr->numLevels-1; ++lvl) {
-                loCutoff->pass(curPyr->pyrLevels[lvl].itsImagPass,
-                              curPyr->pyrLevels[lvl].itsPhase,
-                              oldPyr->pyrLevels[lvl].itsPhase);
-
-                hiCutoff->pass(curPyr->pyrLevels[lvl].itsRealPass,
-                              curPyr->pyrLevels[lvl].itsPhase,
-                              oldPyr->pyrLevels[lvl].itsPhase);
-            }
-            // Shift current to prior for next iteration
-            *oldPyr = *curPyr;
-            // 4. AMPLIFY MOTION
-            curPyr->amplify(imgProcSettings->amplification, imgProcSettings->coWavelength*PI_PERCENT);
-        }
+    /* 1. BUILD RIESZ PYRAMID */
+    curPyr->filterRank = imgProcSettings.rieszFilterRank;
+    curPyr->trigAccuracy = imgProcSettings.rieszTrigAccuracy;
+    curPyr->buildPyramid(input);
+    /* 2. UNWRAPE PHASE TO GET HORIZ&VERTICAL / SIN&COS */
+    curPyr->unwrapOrientPhase(*oldPyr);
+    // 3. BANDPASS FILTER ON EACH LEVEL
+    for (int lvl = 0; lvl < curPyr->numLevels-1; ++lvl) {
+        loCutoff->pass(curPyr->pyrLevels[lvl].itsImagPass,
+                      curPyr->pyrLevels[lvl].itsPhase,
+                      oldPyr->pyrLevels[lvl].itsPhase,
+                      oldPyr->pyrLevels[lvl].itsImagPass);
+
+        hiCutoff->pass(curPyr->pyrLevels[lvl].itsRealPass,
+                      curPyr->pyrLevels[lvl].itsPhase,
+                      oldPyr->pyrLevels[lvl].itsPhase,
+                      oldPyr->pyrLevels[lvl].itsRealPass);
+    }
+    // 4. AMPLIFY MOTION
+    curPyr->amplify(imgProcSettings.amplification, imgProcSettings.coWavelength*PI_PERCENT);
 
-        /* 6. ADD MOTION TO ORIGINAL IMAGE */
-        if(currentFrame > 0)
-        {
-            magnified = curPyr->collapsePyramid();
-        }
-        else
-        {
-            magnified = input;
-        }
+    /* 5. COLLAPSE PYRAMID TO MAGNIFIED IMAGE */
+    magnified = curPyr->collapsePyramid();
 
-        // Scale output image and convert back to 8bit unsigned
-        if(!(imgProcFlags->grayscaleOn || pChannels <= 2))
-        {
-            // Convert YCrCb image back to BGR
-            channels[0] = magnified;
-            cv::merge(channels, output);
-            cvtColor(output, output, COLOR_YCrCb2BGR);
-            output.convertTo(output, CV_8UC3, 255.0, 1.0/255.0);
-        }
-        else
-        {
-            magnified.convertTo(output, CV_8UC1, 255.0, 1.0/255.0);
-        }
+    // Current becomes prior for next iteration, the old levels get rebuilt in place
+    std::swap(curPyr, oldPyr);
 
-        // Fill internal buffer with magnified image
-        magnifiedBuffer.push_back(output);
-        ++currentFrame;
+    // Scale output image and convert back to 8bit unsigned, straight into the frame
+    if(color)
+    {
+        // Convert YCrCb image back to BGR
+        channels[0] = magnified;
+        cv::merge(channels, output);
+        cvtColor(output, output, COLOR_YCrCb2BGR);
+        output.convertTo(frame, frame.type(), 255.0, 1.0/255.0);
+    }
+    else
+    {
+        magnified.convertTo(frame, frame.type(), 255.0, 1.0/255.0);
     }
 }
 
-////////////////////////
-///Magnified Buffer ////
-////////////////////////
-Mat Magnificator::getFrameLast()
-{
-    // Take newest image
-    Mat img = this->magnifiedBuffer.back().clone();
-    // Delete the oldest picture
-    this->magnifiedBuffer.erase(magnifiedBuffer.begin());
-    currentFrame = magnifiedBuffer.size();
-
-    return img;
-}
-
-Mat Magnificator::getFrameFirst()
+void Magnificator::waveletMagnify(Mat &frame)
 {
-    // Take oldest image
-    Mat img = this->magnifiedBuffer.front().clone();
-    // Delete the oldest picture
-    this->magnifiedBuffer.erase(magnifiedBuffer.begin());
-    currentFrame = magnifiedBuffer.size();
-
-    return img;
-}
+    Mat buffer_in, input, magnified, output;
+    std::vector<cv::Mat> channels;
+    bool color = frame.channels() > 2;
 
-Mat Magnificator::getFrameAt(int n)
-{
-    int mLength = magnifiedBuffer.size();
-    Mat img;
+    // Convert input image to 32bit float, luminance only for color images
+    if(color)
+    {
+        frame.convertTo(buffer_in, CV_32FC3, 1.0/255.0);
+        cvtColor(buffer_in, buffer_in, COLOR_BGR2YCrCb);
+        cv::split(buffer_in, channels);
+        input = channels[0];
+    }
+    else
+    {
+        frame.convertTo(input, CV_32FC1, 1.0/255.0);
+    }
 
-    if(n < mLength-1)
-        img = this->magnifiedBuffer.at(n).clone();
-    else {
-        img = getFrameLast();
+    /* 1. SPATIAL FILTER, HAAR DWT */
+    const int shrinkType = imgProcSettings.waveletShrinkType;
+    const float shrinkT = static_cast<float>(imgProcSettings.waveletShrinkThreshold);
+    wavelet.build(input, levels, shrinkType, shrinkT);
+    const int stateType = temporalStorageDepth(imgProcSettings.temporalStorage);
+
+    // If first frame of the stream, save unfiltered details and pass the frame through
+    if(waveletLowpassHi.size() != wavelet.pyr.size()
+            || waveletLowpassHi.front().front().size() != wavelet.pyr.front().front().size()
+            || waveletLowpassHi.front().front().type() != stateType) {
+        waveletLowpassHi.resize(wavelet.pyr.size());
+        waveletLowpassLo.resize(wavelet.pyr.size());
+        waveletMotion.resize(wavelet.pyr.size());
+        for (size_t curLevel = 0; curLevel < wavelet.pyr.size(); ++curLevel) {
+            waveletLowpassHi.at(curLevel).resize(3);
+            waveletLowpassLo.at(curLevel).resize(3);
+            for (int dir = 0; dir < 3; ++dir) {
+                // Lowpass states are updated in place, they must not share data
+                wavelet.pyr.at(curLevel).at(dir).convertTo(waveletLowpassHi.at(curLevel).at(dir), stateType);
+                wavelet.pyr.at(curLevel).at(dir).convertTo(waveletLowpassLo.at(curLevel).at(dir), stateType);
+            }
+        }
+        return;
     }
-    // Delete the oldest picture
-    currentFrame = magnifiedBuffer.size();
 
-    return img;
-}
+    int w = input.size().width;
+    int h = input.size().height;
+
+    // Amplification variable and wavelength per level, as for the Laplace pyramid
+    delta = imgProcSettings.coWavelength / (8.0 * (1.0 + imgProcSettings.amplification));
+    exaggeration_factor = DEFAULT_LAP_MAG_EXAGGERATION;
+    lambda = sqrt(w*w + h*h)/3.0;
+
+    /* 2.-3. TEMPORAL FILTER AND AMPLIFY THE DETAILS OF EVERY LEVEL */
+    for (int curLevel = levels; curLevel >= 0; --curLevel) {
+        // Finest details and the downsampled top image are not amplified
+        if(curLevel < levels && curLevel > 0) {
+            iirWaveletFilter(wavelet.pyr.at(curLevel), waveletMotion.at(curLevel),
+                             waveletLowpassHi.at(curLevel), waveletLowpassLo.at(curLevel),
+                             imgProcSettings.coLow, imgProcSettings.coHigh);
+            const float gain = amplifyLaplacian(curLevel);
+            for (int dir = 0; dir < 3; ++dir)
+                scaleAdd(waveletMotion.at(curLevel).at(dir), gain, wavelet.pyr.at(curLevel).at(dir), wavelet.pyr.at(curLevel).at(dir));
+        }
+        lambda /= 2.0;
+    }
 
-bool Magnificator::hasFrame()
-{
-    return !this->magnifiedBuffer.empty();
-}
+    /* 4. RECONSTRUCT MAGNIFIED IMAGE FROM DWT */
+    wavelet.collapse(magnified, shrinkType, shrinkT);
 
-int Magnificator::getBufferSize()
-{
-    return magnifiedBuffer.size();
+    // Scale output image and convert back to 8bit unsigned, straight into the frame
+    if(color)
+    {
+        channels[0] = magnified;
+        cv::merge(channels, output);
+        cvtColor(output, output, COLOR_YCrCb2BGR);
+        output.convertTo(frame, frame.type(), 255.0, 1.0/255.0);
+    }
+    else
+    {
+        magnified.convertTo(frame, frame.type(), 255.0, 1.0/255.0);
+    }
 }
 
 void Magnificator::clearBuffer()
 {
     // Clear internal cache
-    this->magnifiedBuffer.clear();
     this->lowpassHi.clear();
     this->lowpassLo.clear();
     this->motionPyramid.clear();
-    this->downSampledMat = Mat();
-    this->currentFrame = 0;
+    this->waveletLowpassHi.clear();
+    this->waveletLowpassLo.clear();
+    this->waveletMotion.clear();
+    this->colorFilter.reset();
+    this->colorWindow = 0;
+    this->frameCount = 0;
     oldPyr.reset();
     curPyr.reset();
     loCutoff.reset();
     hiCutoff.reset();
 }
 
-
+void Magnificator::measureState(MagnifyCounters &c)
+{
+    c.stateBytes = 0;
+    c.trafficBytes = 0;
+    switch(mode) {
+    case MAGNIFY_COLOR:
+        c.stateBytes = colorFilter.stateBytes();
+        c.trafficBytes = colorFilter.trafficBytes();
+        break;
+    case MAGNIFY_LAPLACE:
+        for (size_t curLevel = 0; curLevel < lowpassHi.size(); ++curLevel) {
+            const size_t bytes = matBytes(lowpassHi[curLevel]) + matBytes(lowpassLo[curLevel]);
+            c.stateBytes += bytes;
+            // Only the amplified levels are filtered, their states are read and written once
+            if(curLevel > 0 && curLevel < static_cast<size_t>(levels))
+                c.trafficBytes += 2 * bytes;
+        }
+        break;
+    case MAGNIFY_WAVELET:
+        for (size_t curLevel = 0; curLevel < waveletLowpassHi.size(); ++curLevel) {
+            size_t bytes = 0;
+            for (size_t dir = 0; dir < waveletLowpassHi[curLevel].size(); ++dir)
+                bytes += matBytes(waveletLowpassHi[curLevel][dir]) + matBytes(waveletLowpassLo[curLevel][dir]);
+            c.stateBytes += bytes;
+            if(curLevel > 0 && curLevel < static_cast<size_t>(levels))
+                c.trafficBytes += 2 * bytes;
+        }
+        break;
+    case MAGNIFY_RIESZ:
+        // Prior phase and filter state, kept as 32bit float in the pyramid pair
+        if(oldPyr) {
+            for (size_t lvl = 0; lvl < oldPyr->pyrLevels.size(); ++lvl) {
+                const RieszPyramidLevel &l = oldPyr->pyrLevels[lvl];
+                const size_t bytes = matBytes(l.itsPhase.first) + matBytes(l.itsPhase.second)
+                        + matBytes(l.itsRealPass.first) + matBytes(l.itsRealPass.second)
+                        + matBytes(l.itsImagPass.first) + matBytes(l.itsImagPass.second);
+                c.stateBytes += bytes;
+                c.trafficBytes += 2 * bytes;
+            }
+        }
+        break;
+    }
+}
 
 int Magnificator::getOptimalBufferSize(int fps)
 {
@@ -441,29 +527,16 @@ int Magnificator::getOptimalBufferSize(int fps)
 ////////////////////////
 ///Postprocessing //////
 ////////////////////////
-void Magnificator::amplifyLaplacian(const Mat &src, Mat &dst, int currentLevel)
+float Magnificator::amplifyLaplacian(int currentLevel)
 {
     float currAlpha = (lambda/(delta*8.0) - 1.0) * exaggeration_factor;
     // Set lowpassed&downsampled image and difference image with highest resolution to 0,
     // amplify every other level
-    dst = (currentLevel == levels || currentLevel == 0) ? src * 0
-                                                        : src * std::min((float)imgProcSettings->amplification, currAlpha);
-}
-
-void Magnificator::attenuate(const Mat &src, Mat &dst)
-{
-    // Attenuate only if image is not grayscale
-    if(src.channels() > 2)
-    {
-        Mat planes[3];
-        split(src, planes);
-        planes[1] = planes[1] * imgProcSettings->chromAttenuation;
-        planes[2] = planes[2] * imgProcSettings->chromAttenuation;
-        merge(planes, 3, dst);
-    }
+    return (currentLevel == levels || currentLevel == 0) ? 0.f
+                                                         : std::min((float)imgProcSettings.amplification, currAlpha);
 }
 
 void Magnificator::amplifyGaussian(const Mat &src, Mat &dst)
 {
-    dst = src * imgProcSettings->amplification;
+    dst = src * imgProcSettings.amplification;
 }
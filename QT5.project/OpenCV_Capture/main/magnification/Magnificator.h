@@ -25,8 +25,7 @@
 #ifndef MAGNIFICATOR_H
 #define MAGNIFICATOR_H
 // Qt
-#include "QList"
-#include "QTime"
+#include "QRect"
 #include <qdebug.h>
 // OpenCV
 #include "opencv2/opencv.hpp"
@@ -42,123 +41,144 @@
 // C++
 #include "cmath"
 #include "math.h"
+#include <memory>
 
+#ifndef M_PI
 #define M_PI 3.14159265358979323846264338327950288
+#endif
 
 using namespace cv;
 using namespace std;
+
+/*!
+ * \brief Magnification modes, same numbering as DEFAULT_MAGNIFY_TYPE and the MagnifyOptions combobox.
+ */
+enum MagnifyMode {
+    MAGNIFY_NONE = 0,
+    MAGNIFY_COLOR = 1,
+    MAGNIFY_LAPLACE = 2,
+    MAGNIFY_RIESZ = 3,
+    MAGNIFY_WAVELET = 4,
+    MAGNIFY_MODES = 5
+};
+
+/*!
+ * \brief The MagnifyCounters struct Performance counters of one magnification mode.
+ */
+struct MagnifyCounters {
+    int frames;         // frames magnified since start
+    double lastMs;      // time for the last frame
+    double averageMs;   // running average over roughly PIPELINE_TIMING_SMOOTHING frames
+    double maxMs;       // slowest frame since start
+    size_t stateBytes;  // temporal filter state held between frames
+    size_t trafficBytes;// temporal filter state read and written for the last frame
+
+    MagnifyCounters() : frames(0), lastMs(0.0), averageMs(0.0), maxMs(0.0), stateBytes(0), trafficBytes(0) { }
+};
+
 /*!
- * \brief The Magnificator class Handles the motion and color magnification. The class also holds
- *  a Buffer with magnified images and variables describing the inner status of the magnification
- *  process, like the current level we are processing in our image pyramid.
+ * \brief The Magnificator class Handles the motion and color magnification as a stream: every call to
+ *  process() takes one frame and magnifies it in place. Laplace and Riesz magnification keep their temporal
+ *  filter state between frames and add no latency, color magnification keeps a sliding DFT over a window of
+ *  the downsampled frames and magnifies the newest one.
  */
 class Magnificator
 {
 public:
-    //////////////////////// 
-    ///Magnification /////// 
-    //////////////////////// 
-    /*!
-     * \brief Magnificator Constructor for this class.
-     * \param pBuffer Pointer to a processing buffer (preferably with
-     *  - colorMagnification: the size of a power of 2 , near twice the framerate
-     *  - motionMagnification: the size 2)
-     *  of the video that is magnified.
-     * \param imageProcFlags Pointer to the flags, yet only used to indicate using grayscale images
-     * \param imageProcSettings Pointer to the Settings for magnification. These settings can be changed during
-     *  the magnification process
-     */
-    Magnificator(vector<Mat> *pBuffer = 0,
-                 struct ImageProcessingFlags *imageProcFlags = 0,
-                 struct ImageProcessingSettings *imageProcSettings = 0);
+    ////////////////////////
+    ///Magnification ///////
+    ////////////////////////
+    Magnificator();
     ~Magnificator();
+    /*!
+     * \brief configure Takes over mode and settings. Filter state is dropped if the mode, the number of
+     *  levels, grayscale or the temporal storage changes.
+     * \param imageProcFlags Flags, selects the mode (colorMagnifyOn, laplaceMagnifyOn, rieszMagnifyOn, waveletMagnifyOn).
+     * \param imageProcSettings Settings for magnification, can change while streaming.
+     * \return True if a magnification mode is selected.
+     */
+    bool configure(const ImageProcessingFlags &imageProcFlags, const ImageProcessingSettings &imageProcSettings);
+    /*!
+     * \brief process Magnifies one frame in place with the configured mode.
+     * \param frame 8 bit frame with 1 or 3 channels.
+     */
+    void process(Mat &frame);
+    /*!
+     * \brief getMode Currently configured mode.
+     */
+    int getMode();
+    /*!
+     * \brief modeFromFlags Mode selected by the flags, the first one set wins.
+     * \return One of MagnifyMode.
+     */
+    static int modeFromFlags(const ImageProcessingFlags &imageProcFlags);
     /*!
      * \brief calculateMaxLevels Maximum levels an image pyramid can hold.
      * \return Maximum level.
      */
-    int calculateMaxLevels();
-    int calculateMaxLevels(Size s);
-    int calculateMaxLevels(QRect r);
-
+    static int calculateMaxLevels(Size s);
+    static int calculateMaxLevels(QRect r);
     /*!
-     * \brief laplaceMagnify Motion magnification. You can find detailed step by step description in .cpp
+     * \brief clearBuffer Deletes the sliding window, lowpass pyramids and Riesz filter state.
      */
-    void laplaceMagnify();
+    void clearBuffer();
     /*!
-     * \brief colorMagnify Color magnification. You can find detailed step by step description in .cpp
+     * \brief getCounters Performance counters of a mode.
+     * \param magnifyMode One of MagnifyMode.
      */
-    void colorMagnify();
+    MagnifyCounters getCounters(int magnifyMode);
     /*!
-     * \brief waveletMagnify Haar Wavelet magnification. You can find detailed step by step description in .cpp
+     * \brief getOptimalBufferSize Used to calculate the window size for color magnification.
+     *  Best results with ~2 seconds film material and a size that is a power of 2.
+     * \param fps Framerate to calculate how many frames are 2 seconds of film material.
+     * \return Int, power of 2, minimum 16.
      */
-    void rieszMagnify();
+    static int getOptimalBufferSize(int fps);
 
+private:
+    ////////////////////////
+    ///Streaming ///////////
     ////////////////////////
-    ///Magnified Buffer ///
-    //////////////////////// 
-    /*!
-     * \brief getFrameLast Returns the last/newest magnified image. After that, the first/oldest frame is deleted.
-     * \return A Mat with the same size like the images in the provided processingBuffer.
-     */
-    Mat getFrameLast();
     /*!
-     * \brief getFrameFirst Returns the first/oldest magnified image. After that, this frame will be deleted.
-     * \return A Mat with the same size like the images in the provided processingBuffer.
+     * \brief colorMagnify Color magnification of one frame. You can find detailed step by step description in .cpp
      */
-    Mat getFrameFirst();
+    void colorMagnify(Mat &frame);
     /*!
-     * \brief getFrameAt Returns a magnified image on a specified position in the internal buffer.
-     * \param n Position with 0 <= n < buffersize.
-     * \return A Mat with the same size like the images in the provided processingBuffer.
+     * \brief laplaceMagnify Motion magnification of one frame. You can find detailed step by step description in .cpp
      */
-    Mat getFrameAt(int n);
+    void laplaceMagnify(Mat &frame);
     /*!
-     * \brief getBufferSize Size of the internal Buffer, holding the magnified images.
-     * \return Int with Size < processingBuffer that is provided.
+     * \brief rieszMagnify Phase based motion magnification of one frame. You can find detailed step by step description in .cpp
      */
-    int getBufferSize();
+    void rieszMagnify(Mat &frame);
     /*!
-     * \brief clearBuffer Cleans buffer with magnified images, deletes lowpass pyramids, temporal buffer,
+     * \brief waveletMagnify Motion magnification on the Haar DWT of the luminance. You can find detailed step by step description in .cpp
      */
-    void clearBuffer();
-
-    bool hasFrame();
-
-    //////////////////////// 
-    ///Processing Buffer // 
-    //////////////////////// 
+    void waveletMagnify(Mat &frame);
     /*!
-     * \brief getOptimalBufferSize Used to calculate buffer and cache size for color magnification.
-     *  Best results with ~2 seconds film material and a size that is a power of 2.
-     * \param fps Framerate to calculate how many frames are 2 seconds of film material.
-     * \return Int, power of 2, minimum 16.
+     * \brief measureState Fills memory and bandwidth of the temporal filter state of the current mode into c.
      */
-    int getOptimalBufferSize(int fps);
+    void measureState(MagnifyCounters &c);
 
-private:
+    ////////////////////////
+    ///External Settings ///
+    ////////////////////////
     /*!
-     * \brief processingBuffer Pointer to processing buffer, given in constructor. Holds images that have to
-     *  be processed (important for playing videos). Is either 2 or a power of two (see getOptimalBufferSize())
+     * \brief imgProcSettings Copy of the settings given to configure().
      */
-    vector<Mat> *processingBuffer;
-
-    //////////////////////// 
-    ///External Settings // 
-    //////////////////////// 
+    ImageProcessingSettings imgProcSettings;
     /*!
-     * \brief imgProcFlags Pointer to processing flags, given in constructor. Effectively used to
-     *  indicate grayscale mode.
+     * \brief grayscale Grayscale flag given to configure().
      */
-    ImageProcessingFlags *imgProcFlags;
+    bool grayscale;
     /*!
-     * \brief imgProcSettings Pointer to processing settings, given in constructor. Can change dynamically
-     *  while runtime.
+     * \brief mode Selected MagnifyMode.
      */
-    ImageProcessingSettings *imgProcSettings;
+    int mode;
 
-    //////////////////////// 
-    ///Internal Settings // 
-    //////////////////////// 
+    ////////////////////////
+    ///Internal Settings ///
+    ////////////////////////
     /*!
      * \brief delta (Motion magnification) Calculated by cutoff wavelength and amplification.
      */
@@ -174,24 +194,33 @@ private:
      */
     float lambda;
     /*!
-     * \brief currentFrame Current image that is written in magnified buffer.
-     *  0 <= currentFrame < magnifiedBuffer.size().
+     * \brief frameCount Frames streamed since the last clearBuffer().
+     */
+    int frameCount;
+    /*!
+     * \brief colorWindow (Color magnification) Window size of colorFilter, fixed per stream (0 until the
+     *  first frame with a framerate).
      */
-    int currentFrame;
+    int colorWindow;
     /*!
-     * \brief levels Number of levels for Laplace/Gauss Pyramid.
+     * \brief levels Number of levels for Laplace/Gauss Pyramid, limited to the frame size.
      */
     int levels;
+    /*!
+     * \brief counters Performance counters, one per MagnifyMode.
+     */
+    MagnifyCounters counters[MAGNIFY_MODES];
 
-    //////////////////////// 
-    ///Cache ///////// /////// 
-    //////////////////////// 
+    ////////////////////////
+    ///Cache ///////////////
+    ////////////////////////
     /*!
-     * \brief magnifiedBuffer (Both) Holds magnified images, that are not yet given to the GUI.
+     * \brief pyramid (Color and motion magnification) Gauss/Laplace pyramid of the current frame, levels
+     *  stay allocated while frame size and level count do not change.
      */
-    vector<Mat> magnifiedBuffer;
+    PyramidWorkspace pyramid;
     /*!
-     * \brief tempBuffer (Motion magnification) Holds image pyramid with the difference of two
+     * \brief motionPyramid (Motion magnification) Holds image pyramid with the difference of two
      *  filtered images from lowpassHi & lowpassLo on each level. The upsampled pyramid is a motion
      *  image that will be added to the original image.
      */
@@ -207,32 +236,43 @@ private:
      */
     vector<Mat> lowpassLo;
     /*!
-     * \brief downSampledMat (Color magnification) Holds 2*fps rounded to next power of 2
-     *  downsampled and to 1 column reshaped images.
+     * \brief colorFilter (Color magnification) Ideal bandpass over a sliding window of the last 2*fps
+     *  (rounded to next power of 2) downsampled frames.
      */
-    Mat downSampledMat;
+    SlidingIdealFilter colorFilter;
+
+    /*!
+     * \brief wavelet (Wavelet magnification) DWT of the current frame, buffers kept between frames.
+     */
+    WaveletPyramid wavelet;
+    /*!
+     * \brief waveletLowpassHi (Wavelet magnification) Lowpassed detail images per level with high cutoff.
+     */
+    vector< vector<Mat> > waveletLowpassHi;
+    /*!
+     * \brief waveletLowpassLo (Wavelet magnification) Lowpassed detail images per level with low cutoff.
+     */
+    vector< vector<Mat> > waveletLowpassLo;
+    /*!
+     * \brief waveletMotion (Wavelet magnification) Bandpassed detail images per level.
+     */
+    vector< vector<Mat> > waveletMotion;
 
     std::shared_ptr<RieszPyramid> oldPyr;
     std::shared_ptr<RieszPyramid> curPyr;
     std::shared_ptr<RieszTemporalFilter> loCutoff;
     std::shared_ptr<RieszTemporalFilter> hiCutoff;
 
-    //////////////////////// 
+    ////////////////////////
     ///Postprocessing //////
-    //////////////////////// 
+    ////////////////////////
     /*!
-     * \brief amplifyLaplacian (Motion magnification) Amplifies a Laplacian image pyramid.
-     * \param src Source image.
-     * \param dst Destination image.
+     * \brief amplifyLaplacian (Motion magnification) Amplification of one level of a Laplacian image pyramid,
+     *  depends on lambda of that level.
      * \param currentLevel Level of image pyramid that is amplified.
+     * \return Gain for iirBandAmplify, 0 for the highest resolution and the lowpassed top level.
      */
-    void amplifyLaplacian(const Mat &src, Mat &dst, int currentLevel);
-    /*!
-     * \brief attenuate (Motion magnification) Attenuates the 2 last channels of a Lab-image.
-     * \param src Source image.
-     * \param dst Destination image.
-     */
-    void attenuate(const Mat &src, Mat &dst);
+    float amplifyLaplacian(int currentLevel);
     /*!
      * \brief amplifyGaussian (Color magnification) Amplifies a Gaussian image pyramid.
      * \param src Source image.
@@ -3,6 +3,114 @@
 ///
 #include "RieszPyramid.h"
 
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/core/hal/intrin.hpp>
+
+////////////////////////
+// Phase math kernels //
+////////////////////////
+
+// acos(|x|) ~ sqrt(1-|x|) * P(|x|), Abramowitz & Stegun 4.4.45 (fast) and 4.4.46 (precise)
+static const float acosFast[] = { 1.5707288f, -0.2121144f, 0.0742610f, -0.0187293f };
+static const float acosPrecise[] = { 1.5707963050f, -0.2145988016f, 0.0889789874f, -0.0501743046f,
+                                     0.0308918810f, -0.0170881256f, 0.0066700901f, -0.0012624911f };
+// sin/cos on [-pi/4, pi/4]: cephes sinf/cosf (precise), least squares fit (fast)
+static const float sinFast[] = { -0.16662756f, 0.0081515894f };
+static const float cosFast[] = { -0.49977258f, 0.040481993f };
+static const float sinPrecise[] = { -1.6666654611e-1f, 8.3321608736e-3f, -1.9515295891e-4f };
+static const float cosPrecise[] = { -0.5f, 4.166664568298827e-2f, -1.388731625493765e-3f, 2.443315711809948e-5f };
+// pi/2 split in three for the range reduction (Cody-Waite)
+static const float halfPi1 = 1.5703125f;
+static const float halfPi2 = 4.837512969970703125e-4f;
+static const float halfPi3 = 7.54978995489188216e-8f;
+
+static inline float acosScalar(float x, int accuracy)
+{
+    const float ax = std::min(std::fabs(x), 1.f);
+    if(accuracy == RIESZ_TRIG_EXACT)
+        return std::acos(x < 0 ? -ax : ax);
+    const bool fast = accuracy == RIESZ_TRIG_FAST;
+    const float *c = fast ? acosFast : acosPrecise;
+    int n = fast ? 4 : 8;
+    float p = c[--n];
+    while (n-- > 0)
+        p = p * ax + c[n];
+    const float r = std::sqrt(1.f - ax) * p;
+    return x < 0 ? static_cast<float>(CV_PI) - r : r;
+}
+
+static inline void sinCosScalar(float x, float &s, float &c, int accuracy)
+{
+    if(accuracy == RIESZ_TRIG_EXACT) {
+        s = std::sin(x);
+        c = std::cos(x);
+        return;
+    }
+    // x = q*pi/2 + r, |r| <= pi/4
+    const int q = cvRound(x * static_cast<float>(2.0 / CV_PI));
+    const float fq = static_cast<float>(q);
+    const float r = ((x - fq * halfPi1) - fq * halfPi2) - fq * halfPi3;
+    const float r2 = r * r;
+    float ps, pc;
+    if(accuracy == RIESZ_TRIG_FAST) {
+        ps = r + r * r2 * (sinFast[0] + r2 * sinFast[1]);
+        pc = 1.f + r2 * (cosFast[0] + r2 * cosFast[1]);
+    }else {
+        ps = r + r * r2 * (sinPrecise[0] + r2 * (sinPrecise[1] + r2 * sinPrecise[2]));
+        pc = 1.f + r2 * (cosPrecise[0] + r2 * (cosPrecise[1] + r2 * (cosPrecise[2] + r2 * cosPrecise[3])));
+    }
+    // Quadrant: odd swaps sin and cos, then the signs follow q and q+1
+    if(q & 1)
+        std::swap(ps, pc);
+    s = (q & 2) ? -ps : ps;
+    c = ((q + 1) & 2) ? -pc : pc;
+}
+
+#if CV_SIMD128
+static inline cv::v_float32x4 v_acos(const cv::v_float32x4 &x, bool fast)
+{
+    const cv::v_float32x4 one = cv::v_setall_f32(1.f);
+    const cv::v_float32x4 ax = cv::v_min(cv::v_abs(x), one);
+    const float *c = fast ? acosFast : acosPrecise;
+    int n = fast ? 4 : 8;
+    cv::v_float32x4 p = cv::v_setall_f32(c[--n]);
+    while (n-- > 0)
+        p = cv::v_muladd(p, ax, cv::v_setall_f32(c[n]));
+    const cv::v_float32x4 r = cv::v_sqrt(one - ax) * p;
+    return cv::v_select(x < cv::v_setzero_f32(), cv::v_setall_f32(static_cast<float>(CV_PI)) - r, r);
+}
+
+static inline void v_sincos(const cv::v_float32x4 &x, cv::v_float32x4 &s, cv::v_float32x4 &c, bool fast)
+{
+    const cv::v_int32x4 q = cv::v_round(x * cv::v_setall_f32(static_cast<float>(2.0 / CV_PI)));
+    const cv::v_float32x4 fq = cv::v_cvt_f32(q);
+    cv::v_float32x4 r = x - fq * cv::v_setall_f32(halfPi1);
+    r = r - fq * cv::v_setall_f32(halfPi2);
+    r = r - fq * cv::v_setall_f32(halfPi3);
+    const cv::v_float32x4 r2 = r * r;
+    cv::v_float32x4 ps, pc;
+    if(fast) {
+        ps = cv::v_muladd(cv::v_setall_f32(sinFast[1]), r2, cv::v_setall_f32(sinFast[0]));
+        pc = cv::v_muladd(cv::v_setall_f32(cosFast[1]), r2, cv::v_setall_f32(cosFast[0]));
+    }else {
+        ps = cv::v_muladd(cv::v_setall_f32(sinPrecise[2]), r2, cv::v_setall_f32(sinPrecise[1]));
+        ps = cv::v_muladd(ps, r2, cv::v_setall_f32(sinPrecise[0]));
+        pc = cv::v_muladd(cv::v_setall_f32(cosPrecise[3]), r2, cv::v_setall_f32(cosPrecise[2]));
+        pc = cv::v_muladd(pc, r2, cv::v_setall_f32(cosPrecise[1]));
+        pc = cv::v_muladd(pc, r2, cv::v_setall_f32(cosPrecise[0]));
+    }
+    ps = cv::v_muladd(r * r2, ps, r);
+    pc = cv::v_muladd(r2, pc, cv::v_setall_f32(1.f));
+    // Quadrant: odd swaps sin and cos, then flip the sign bits from q and q+1
+    const cv::v_int32x4 one = cv::v_setall_s32(1), two = cv::v_setall_s32(2);
+    const cv::v_float32x4 swap = cv::v_reinterpret_as_f32((q & one) == one);
+    s = cv::v_select(swap, pc, ps) ^ cv::v_reinterpret_as_f32((q & two) << 30);
+    c = cv::v_select(swap, ps, pc) ^ cv::v_reinterpret_as_f32(((q + one) & two) << 30);
+}
+#endif
+
 /////////////////////
 // Riesz Pyr Level //
 /////////////////////
@@ -35,122 +143,252 @@ void RieszPyramidLevel::build(const cv::Mat &octave) {
     // This is the Riesz Band Filter, sometimes defined as [-0.5, 0 , 0.5], [-0.2,-0.48, 0, 0.48,0.2], [[-0.12,0,0.12],[-0.34, 0, 0.34],[-0.12,0,0.12]]
     static const cv::Mat realK = (cv::Mat_<float>(1, 3) << -0.49, 0, 0.49);
     static const cv::Mat imagK = realK.t();
-    itsLp = octave;
+    if(octave.data != itsLp.data)
+        octave.copyTo(itsLp);
     cv::filter2D(itsLp, real(itsR), itsLp.depth(), realK, cv::Point(-1,-1), 0, cv::BORDER_REFLECT_101);
     cv::filter2D(itsLp, imag(itsR), itsLp.depth(), imagK, cv::Point(-1,-1), 0, cv::BORDER_REFLECT_101);
 }
 
 // Write into result the element-wise inverse cosine of X.
-void RieszPyramidLevel::arcCosX(const cv::Mat &X, cv::Mat &result) {
-    assert(X.isContinuous() && result.isContinuous());
-    const float *const pX =      X.ptr<float>(0);
-    float *const pResult  = result.ptr<float>(0);
-    const int count = X.rows * X.cols;
-
-    for (int i = 0; i < count; ++i)
-    {
-        pResult[i] = acos(pX[i]);
+void RieszPyramidLevel::arcCosX(const cv::Mat &X, cv::Mat &result, int accuracy) {
+    CV_Assert(X.type() == CV_32F);
+    result.create(X.size(), CV_32F);
+    for (int y = 0; y < X.rows; ++y) {
+        const float *pX = X.ptr<float>(y);
+        float *pResult  = result.ptr<float>(y);
+        int i = 0;
+#if CV_SIMD128
+        if(accuracy != RIESZ_TRIG_EXACT) {
+            const bool fast = accuracy == RIESZ_TRIG_FAST;
+            for (; i <= X.cols - 4; i += 4)
+                cv::v_store(pResult + i, v_acos(cv::v_load(pX + i), fast));
+        }
+#endif
+        for (; i < X.cols; ++i)
+            pResult[i] = acosScalar(pX[i], accuracy);
     }
 }
 
 // This calculates movements separated by edges.
 // Cos (itsPhase.first) are vertical edges
 // Sin (itsPhase.second) are horizontal edges
-void RieszPyramidLevel::unwrapOrientPhase(const RieszPyramidLevel &prior) {
-    cv::Mat temp1
-        =      itsLp.mul(prior.itsLp)
-        + real(itsR).mul(real(prior.itsR))
-        + imag(itsR).mul(imag(prior.itsR));
-    cv::Mat temp2
-        =       real(itsR).mul(prior.itsLp)
-        - real(prior.itsR).mul(itsLp);
-    cv::Mat temp3
-        =       imag(itsR).mul(prior.itsLp)
-        - imag(prior.itsR).mul(itsLp);
-    cv::Mat tempP  = temp2.mul(temp2) + temp3.mul(temp3);
-    cv::Mat phi    = tempP            + temp1.mul(temp1);
-    cv::sqrt(phi, phi);
-    cv::divide(temp1, phi, temp1);
-    cv::patchNaNs(temp1, 0.0);
-    arcCosX(temp1, phi);
-    cv::sqrt(tempP, tempP);
-    cv::divide(temp2, tempP, temp2);
-    cv::patchNaNs(temp2, 0.0);
-    cv::divide(temp3, tempP, temp3);
-    cv::patchNaNs(temp3, 0.0);
-    cos(itsPhase) = temp2.mul(phi);
-    sin(itsPhase) = temp3.mul(phi);
+void RieszPyramidLevel::unwrapOrientPhase(const RieszPyramidLevel &prior, int accuracy) {
+    const cv::Size size = itsLp.size();
+    cos(itsPhase).create(size, CV_32F);
+    sin(itsPhase).create(size, CV_32F);
+
+    for (int y = 0; y < size.height; ++y) {
+        const float *lp  = itsLp.ptr<float>(y);
+        const float *re  = real(itsR).ptr<float>(y);
+        const float *im  = imag(itsR).ptr<float>(y);
+        const float *pLp = prior.itsLp.ptr<float>(y);
+        const float *pRe = real(prior.itsR).ptr<float>(y);
+        const float *pIm = imag(prior.itsR).ptr<float>(y);
+        float *pCos = cos(itsPhase).ptr<float>(y);
+        float *pSin = sin(itsPhase).ptr<float>(y);
+        int x = 0;
+#if CV_SIMD128
+        if(accuracy != RIESZ_TRIG_EXACT) {
+            const bool fast = accuracy == RIESZ_TRIG_FAST;
+            const cv::v_float32x4 zero = cv::v_setzero_f32();
+            for (; x <= size.width - 4; x += 4) {
+                const cv::v_float32x4 a = cv::v_load(lp + x), b = cv::v_load(re + x), c = cv::v_load(im + x);
+                const cv::v_float32x4 pa = cv::v_load(pLp + x), pb = cv::v_load(pRe + x), pc = cv::v_load(pIm + x);
+                const cv::v_float32x4 temp1 = a * pa + b * pb + c * pc;
+                const cv::v_float32x4 temp2 = b * pa - pb * a;
+                const cv::v_float32x4 temp3 = c * pa - pc * a;
+                const cv::v_float32x4 tempP = temp2 * temp2 + temp3 * temp3;
+                const cv::v_float32x4 phi = cv::v_sqrt(tempP + temp1 * temp1);
+                const cv::v_float32x4 angle = v_acos(cv::v_select(phi > zero, temp1 / phi, zero), fast);
+                const cv::v_float32x4 norm = cv::v_sqrt(tempP);
+                const cv::v_float32x4 scale = cv::v_select(norm > zero, angle / norm, zero);
+                cv::v_store(pCos + x, temp2 * scale);
+                cv::v_store(pSin + x, temp3 * scale);
+            }
+        }
+#endif
+        for (; x < size.width; ++x) {
+            const float temp1 = lp[x] * pLp[x] + re[x] * pRe[x] + im[x] * pIm[x];
+            const float temp2 = re[x] * pLp[x] - pRe[x] * lp[x];
+            const float temp3 = im[x] * pLp[x] - pIm[x] * lp[x];
+            const float tempP = temp2 * temp2 + temp3 * temp3;
+            const float phi = std::sqrt(tempP + temp1 * temp1);
+            const float angle = acosScalar(phi > 0.f ? temp1 / phi : 0.f, accuracy);
+            const float norm = std::sqrt(tempP);
+            const float scale = norm > 0.f ? angle / norm : 0.f;
+            pCos[x] = temp2 * scale;
+            pSin[x] = temp3 * scale;
+        }
+    }
 }
 
 // Write into result the element-wise cosines and sines of X.
-void RieszPyramidLevel::cosSinX(const cv::Mat &X, CompExpMat &result)
+void RieszPyramidLevel::cosSinX(const cv::Mat &X, CompExpMat &result, int accuracy)
 {
-    assert(X.isContinuous());
-    cos(result) = cv::Mat::zeros(X.size(), CV_32F);
-    sin(result) = cv::Mat::zeros(X.size(), CV_32F);
-    assert(cos(result).isContinuous() && sin(result).isContinuous());
-    const float *const pX =           X.ptr<float>(0);
-    float *const pCosX    = cos(result).ptr<float>(0);
-    float *const pSinX    = sin(result).ptr<float>(0);
-    const int count = X.rows * X.cols;
-    for (int i = 0; i < count; ++i) {
-        pCosX[i] = cos(pX[i]);
-        pSinX[i] = sin(pX[i]);
+    CV_Assert(X.type() == CV_32F);
+    cos(result).create(X.size(), CV_32F);
+    sin(result).create(X.size(), CV_32F);
+    for (int y = 0; y < X.rows; ++y) {
+        const float *pX = X.ptr<float>(y);
+        float *pCosX    = cos(result).ptr<float>(y);
+        float *pSinX    = sin(result).ptr<float>(y);
+        int i = 0;
+#if CV_SIMD128
+        if(accuracy != RIESZ_TRIG_EXACT) {
+            const bool fast = accuracy == RIESZ_TRIG_FAST;
+            for (; i <= X.cols - 4; i += 4) {
+                cv::v_float32x4 s, c;
+                v_sincos(cv::v_load(pX + i), s, c, fast);
+                cv::v_store(pCosX + i, c);
+                cv::v_store(pSinX + i, s);
+            }
+        }
+#endif
+        for (; i < X.cols; ++i)
+            sinCosScalar(pX[i], pSinX[i], pCosX[i], accuracy);
     }
 }
 
-cv::Mat RieszPyramidLevel::rms() {
-    cv::Mat result = square(itsR) + itsLp.mul(itsLp);
-    cv::sqrt(result, result);
-    return result;
-}
-
-// Normalize the phase change of this level into result.
-void RieszPyramidLevel::normalize(CompExpMat &result) {
+// Weight the phase change of this level by the amplitude and blur it together with the amplitude.
+void RieszPyramidLevel::normalize() {
     static const double sigma = 3.0;
     static const int aperture = static_cast<int>(1.0 + 4.0 * sigma);
     static const cv::Mat kernel
         = cv::getGaussianKernel(aperture, sigma, CV_32F);
-    cv::Mat amplitude = rms();
-    const CompExpMat change = itsRealPass - itsImagPass;
-    cos(result) = cos(change).mul(amplitude);
-    sin(result) = sin(change).mul(amplitude);
-    cv::sepFilter2D(cos(result), cos(result), -1, kernel, kernel, cv::Point(-1,-1), 0, cv::BORDER_REFLECT_101);
-    cv::sepFilter2D(sin(result), sin(result), -1, kernel, kernel, cv::Point(-1,-1), 0, cv::BORDER_REFLECT_101);
-    cv::Mat temp;
-    cv::sepFilter2D(amplitude, temp, -1, kernel, kernel, cv::Point(-1,-1), 0, cv::BORDER_REFLECT_101);
-    cv::divide(cos(result), temp, cos(result));
-    cv::patchNaNs(cos(result), 0.0);
-    cv::divide(sin(result), temp, sin(result));
-    cv::patchNaNs(sin(result), 0.0);
+    const cv::Size size = itsLp.size();
+    itsWeighted.create(size, CV_32FC3);
+
+    for (int y = 0; y < size.height; ++y) {
+        const float *lp = itsLp.ptr<float>(y);
+        const float *re = real(itsR).ptr<float>(y);
+        const float *im = imag(itsR).ptr<float>(y);
+        const float *realCos = cos(itsRealPass).ptr<float>(y);
+        const float *realSin = sin(itsRealPass).ptr<float>(y);
+        const float *imagCos = cos(itsImagPass).ptr<float>(y);
+        const float *imagSin = sin(itsImagPass).ptr<float>(y);
+        float *w = itsWeighted.ptr<float>(y);
+        int x = 0;
+#if CV_SIMD128
+        for (; x <= size.width - 4; x += 4) {
+            const cv::v_float32x4 a = cv::v_load(lp + x), b = cv::v_load(re + x), c = cv::v_load(im + x);
+            const cv::v_float32x4 amplitude = cv::v_sqrt(a * a + b * b + c * c);
+            cv::v_store_interleave(w + 3 * x,
+                                   (cv::v_load(realCos + x) - cv::v_load(imagCos + x)) * amplitude,
+                                   (cv::v_load(realSin + x) - cv::v_load(imagSin + x)) * amplitude,
+                                   amplitude);
+        }
+#endif
+        for (; x < size.width; ++x) {
+            const float amplitude = std::sqrt(lp[x] * lp[x] + re[x] * re[x] + im[x] * im[x]);
+            w[3 * x]     = (realCos[x] - imagCos[x]) * amplitude;
+            w[3 * x + 1] = (realSin[x] - imagSin[x]) * amplitude;
+            w[3 * x + 2] = amplitude;
+        }
+    }
+    // One blur for the three planes
+    cv::sepFilter2D(itsWeighted, itsWeighted, -1, kernel, kernel, cv::Point(-1,-1), 0, cv::BORDER_REFLECT_101);
 }
 
 // Multipy the phase difference in this level by alpha but only up to
 // some ceiling threshold.
-void RieszPyramidLevel::amplify(double alpha, double threshold) {
-    CompExpMat temp;
-    normalize(temp);
-
-    cv::Mat MagV = square(temp);
-    cv::sqrt(MagV, MagV);
-    cv::Mat MagV2 = MagV * alpha;
-    cv::threshold(MagV2, MagV2, threshold, 0, cv::THRESH_TRUNC);
-    CompExpMat phaseDiff;
-    cosSinX(MagV2, phaseDiff);
-    cv::Mat pair = real(itsR).mul(cos(temp)) + imag(itsR).mul(sin(temp));
-    cv::divide(pair, MagV, pair);
-    cv::patchNaNs(pair, 0.0);
-    itsLp = itsLp.mul(cos(phaseDiff)) - pair.mul(sin(phaseDiff));
+void RieszPyramidLevel::amplify(double alpha, double threshold, int accuracy) {
+    normalize();
+
+    const cv::Size size = itsLp.size();
+    const float fAlpha = static_cast<float>(alpha);
+    const float fThreshold = static_cast<float>(threshold);
+    itsMagnified.create(size, CV_32F);
+
+    for (int y = 0; y < size.height; ++y) {
+        const float *w  = itsWeighted.ptr<float>(y);
+        const float *lp = itsLp.ptr<float>(y);
+        const float *re = real(itsR).ptr<float>(y);
+        const float *im = imag(itsR).ptr<float>(y);
+        float *out = itsMagnified.ptr<float>(y);
+        int x = 0;
+#if CV_SIMD128
+        if(accuracy != RIESZ_TRIG_EXACT) {
+            const bool fast = accuracy == RIESZ_TRIG_FAST;
+            const cv::v_float32x4 zero = cv::v_setzero_f32(), one = cv::v_setall_f32(1.f);
+            const cv::v_float32x4 vAlpha = cv::v_setall_f32(fAlpha), vThreshold = cv::v_setall_f32(fThreshold);
+            for (; x <= size.width - 4; x += 4) {
+                cv::v_float32x4 wc, ws, wa;
+                cv::v_load_deinterleave(w + 3 * x, wc, ws, wa);
+                // Normalized phase change
+                const cv::v_float32x4 inv = cv::v_select(wa > zero, one / wa, zero);
+                const cv::v_float32x4 nc = wc * inv, ns = ws * inv;
+                const cv::v_float32x4 magV = cv::v_sqrt(nc * nc + ns * ns);
+                cv::v_float32x4 sinDiff, cosDiff;
+                v_sincos(cv::v_min(magV * vAlpha, vThreshold), sinDiff, cosDiff, fast);
+                const cv::v_float32x4 pair = cv::v_select(magV > zero,
+                        (cv::v_load(re + x) * nc + cv::v_load(im + x) * ns) / magV, zero);
+                cv::v_store(out + x, cv::v_load(lp + x) * cosDiff - pair * sinDiff);
+            }
+        }
+#endif
+        for (; x < size.width; ++x) {
+            const float inv = w[3 * x + 2] > 0.f ? 1.f / w[3 * x + 2] : 0.f;
+            const float nc = w[3 * x] * inv, ns = w[3 * x + 1] * inv;
+            const float magV = std::sqrt(nc * nc + ns * ns);
+            float sinDiff, cosDiff;
+            sinCosScalar(std::min(magV * fAlpha, fThreshold), sinDiff, cosDiff, accuracy);
+            const float pair = magV > 0.f ? (re[x] * nc + im[x] * ns) / magV : 0.f;
+            out[x] = lp[x] * cosDiff - pair * sinDiff;
+        }
+    }
 }
 
 
 /////////////////
 // Riesz Pyr  //
 ////////////////
-RieszPyramid::RieszPyramid()
+
+// 9x9 Lowpass and Highpass filter for pyramid construction/collapse, used before phase unwrapping.
+// Kept as the dense kernel plus its SVD terms: kernel = sum_r cols[r] * rows[r]
+struct RieszKernel {
+    cv::Mat dense;
+    std::vector<cv::Mat> cols;
+    std::vector<cv::Mat> rows;
+};
+
+struct RieszFilterBank {
+    RieszKernel lowPass;              // already scaled by 2 to make up for the subsampling
+    RieszKernel highPass;
+    RieszKernel lowPassPhase[2][2];   // taps of lowPass that hit the even samples, per [row][col] parity
+    double errorBound[10];            // L1 norm of the dropped SVD terms, per rank
+};
+
+// Every other element of a kernel vector, starting at parity
+static cv::Mat everyOther(const cv::Mat &v, int parity)
+{
+    const int n = static_cast<int>(v.total());
+    cv::Mat_<float> result((n - parity + 1) / 2, 1);
+    for (int i = parity, j = 0; i < n; i += 2, ++j)
+        result(j) = v.at<float>(i);
+    return v.rows == 1 ? cv::Mat(result.t()) : cv::Mat(result);
+}
+
+static void decomposeKernel(const cv::Mat &dense, RieszKernel &kernel, double errorBound[10])
 {
-    // Init low and highpass filter for pyramid construction/collapse
-    this->lowPassFilter = (cv::Mat_<float>(9,9)<< -0.0001,   -0.0007,  -0.0023,  -0.0046,  -0.0057,  -0.0046,  -0.0023,  -0.0007,  -0.0001,
+    cv::Mat w, u, vt;
+    cv::SVD::compute(dense, w, u, vt);
+    cv::Mat residual = dense.clone();
+    kernel.dense = dense;
+    errorBound[0] = 0.0;
+    for (int r = 0; r < w.rows; ++r) {
+        const float s = std::sqrt(w.at<float>(r));
+        kernel.cols.push_back(cv::Mat(u.col(r) * s));
+        kernel.rows.push_back(cv::Mat(vt.row(r) * s));
+        residual -= kernel.cols.back() * kernel.rows.back();
+        errorBound[r+1] = std::max(errorBound[r+1], cv::norm(residual, cv::NORM_L1));
+    }
+    // Rank 9 falls back to the exact dense kernel
+    errorBound[w.rows] = 0.0;
+}
+
+static RieszFilterBank buildFilterBank()
+{
+    const cv::Mat lowPassFilter = (cv::Mat_<float>(9,9)<< -0.0001,   -0.0007,  -0.0023,  -0.0046,  -0.0057,  -0.0046,  -0.0023,  -0.0007,  -0.0001,
                                             -0.0007,   -0.0030,  -0.0047,  -0.0025,  -0.0003,  -0.0025,  -0.0047,  -0.0030,  -0.0007,
                                             -0.0023,   -0.0047,   0.0054,   0.0272,   0.0387,   0.0272,   0.0054,  -0.0047,  -0.0023,
                                             -0.0046,   -0.0025,   0.0272,   0.0706,   0.0910,   0.0706,   0.0272,  -0.0025,  -0.0046,
@@ -160,7 +398,7 @@ RieszPyramid::RieszPyramid()
                                             -0.0007,   -0.0030,  -0.0047,  -0.0025,  -0.0003,  -0.0025,  -0.0047,  -0.0030,  -0.0007,
                                             -0.0001,   -0.0007,  -0.0023,  -0.0046,  -0.0057,  -0.0046,  -0.0023,  -0.0007,  -0.0001);
 
-    this->highPassFilter= (cv::Mat_<float>(9,9)<<  0.0000,    0.0003,   0.0011,   0.0022,   0.0027,   0.0022,   0.0011,   0.0003,   0.0000,
+    const cv::Mat highPassFilter= (cv::Mat_<float>(9,9)<<  0.0000,    0.0003,   0.0011,   0.0022,   0.0027,   0.0022,   0.0011,   0.0003,   0.0000,
                                              0.0003,    0.0020,   0.0059,   0.0103,   0.0123,   0.0103,   0.0059,   0.0020,   0.0003,
                                              0.0011,    0.0059,   0.0151,   0.0249,   0.0292,   0.0249,   0.0151,   0.0059,   0.0011,
                                              0.0022,    0.0103,   0.0249,   0.0402,   0.0469,   0.0402,   0.0249,   0.0103,   0.0022,
@@ -169,14 +407,74 @@ RieszPyramid::RieszPyramid()
                                              0.0011,    0.0059,   0.0151,   0.0249,   0.0292,   0.0249,   0.0151,   0.0059,   0.0011,
                                              0.0003,    0.0020,   0.0059,   0.0103,   0.0123,   0.0103,   0.0059,   0.0020,   0.0003,
                                              0.0000,    0.0003,   0.0011,   0.0022,   0.0027,   0.0022,   0.0011,   0.0003,   0.0000);
+
+    RieszFilterBank bank;
+    std::fill(bank.errorBound, bank.errorBound + 10, 0.0);
+    decomposeKernel(2.0 * lowPassFilter, bank.lowPass, bank.errorBound);
+    decomposeKernel(highPassFilter, bank.highPass, bank.errorBound);
+
+    // Polyphase parts: rows/cols 0,2,..,8 for even outputs, 1,3,..,7 for odd ones
+    for (int py = 0; py < 2; ++py) {
+        for (int px = 0; px < 2; ++px) {
+            RieszKernel &phase = bank.lowPassPhase[py][px];
+            cv::Mat dense(py ? 4 : 5, px ? 4 : 5, CV_32F);
+            for (int y = 0; y < dense.rows; ++y)
+                for (int x = 0; x < dense.cols; ++x)
+                    dense.at<float>(y, x) = bank.lowPass.dense.at<float>(2*y + py, 2*x + px);
+            phase.dense = dense;
+            for (size_t r = 0; r < bank.lowPass.cols.size(); ++r) {
+                phase.cols.push_back(everyOther(bank.lowPass.cols[r], py));
+                phase.rows.push_back(everyOther(bank.lowPass.rows[r], px));
+            }
+        }
+    }
+    return bank;
+}
+
+static const RieszFilterBank &filterBank()
+{
+    static const RieszFilterBank bank = buildFilterBank();
+    return bank;
+}
+
+// Dense filter2D, or the sum of the first rank separable terms
+static void applyKernel(const cv::Mat &img, cv::Mat &result, const RieszKernel &kernel,
+                        int rank, cv::Point anchor, int border)
+{
+    if(rank <= 0 || rank >= static_cast<int>(kernel.cols.size())) {
+        cv::filter2D(img, result, CV_32F, kernel.dense, anchor, 0, border);
+        return;
+    }
+    cv::Mat term;
+    cv::sepFilter2D(img, result, CV_32F, kernel.rows[0], kernel.cols[0], anchor, 0, border);
+    for (int r = 1; r < rank; ++r) {
+        cv::sepFilter2D(img, term, CV_32F, kernel.rows[r], kernel.cols[r], anchor, 0, border);
+        result += term;
+    }
+}
+
+double RieszPyramid::filterErrorBound(int rank)
+{
+    if(rank <= 0 || rank > 9)
+        return 0.0;
+    return filterBank().errorBound[rank];
+}
+
+RieszPyramid::RieszPyramid() :
+    numLevels(0),
+    filterRank(DEFAULT_RIESZ_FILTER_RANK),
+    trigAccuracy(DEFAULT_RIESZ_TRIG_ACCURACY)
+{
+    // Build the shared low and highpass filters on first use
+    filterBank();
 }
 RieszPyramid::~RieszPyramid() { }
 RieszPyramid::RieszPyramid(const RieszPyramid& other)
 {
     this->numLevels = other.numLevels;
+    this->filterRank = other.filterRank;
+    this->trigAccuracy = other.trigAccuracy;
     this->pyrLevels.resize(other.pyrLevels.size());
-    other.lowPassFilter.copyTo(this->lowPassFilter);
-    other.highPassFilter.copyTo(this->highPassFilter);
     for (int i = 0; i < this->numLevels; ++i)
     {
         this->pyrLevels[i] = other.pyrLevels[i];
@@ -187,9 +485,9 @@ RieszPyramid& RieszPyramid::operator=(const RieszPyramid& other)
     if(this != &other)
     {
         this->numLevels = other.numLevels;
+        this->filterRank = other.filterRank;
+        this->trigAccuracy = other.trigAccuracy;
         this->pyrLevels.resize(other.pyrLevels.size());
-        other.lowPassFilter.copyTo(this->lowPassFilter);
-        other.highPassFilter.copyTo(this->highPassFilter);
         for (int i = 0; i < this->numLevels; ++i)
         {
             this->pyrLevels[i] = other.pyrLevels[i];
@@ -223,14 +521,15 @@ void RieszPyramid::buildPyramid(const cv::Mat &frame) {
     cv::Mat octave = frame;
 
     for (int i = 0; i < max; ++i) {
-        cv::Mat hp, lp, down;
+        cv::Mat lp;
 
-        // Highpass undergoes riesz transform
-        cv::filter2D(octave, hp, CV_32F, highPassFilter, cv::Point(-1,-1), 0, cv::BORDER_REFLECT_101);
+        // Highpass undergoes riesz transform, straight into the level's buffer
+        cv::Mat &hp = pyrLevels[i].itsLp;
+        applyKernel(octave, hp, filterBank().highPass, filterRank, cv::Point(-1,-1), cv::BORDER_REFLECT_101);
         pyrLevels[i].build(hp);
 
         // Lowpass is passed onto the next level
-        cv::filter2D(octave, lp, CV_32F, 2.0*lowPassFilter, cv::Point(-1,-1), 0, cv::BORDER_REFLECT_101);
+        applyKernel(octave, lp, filterBank().lowPass, filterRank, cv::Point(-1,-1), cv::BORDER_REFLECT_101);
         octave = subsample(lp);
     }
 
@@ -242,7 +541,7 @@ void RieszPyramid::unwrapOrientPhase(const RieszPyramid &prior) {
 
     for (RieszPyramid::size_type i = 0; i < max; ++i)
     {
-        pyrLevels[i].unwrapOrientPhase(prior.pyrLevels[i]);
+        pyrLevels[i].unwrapOrientPhase(prior.pyrLevels[i], trigAccuracy);
     }
 }
 
@@ -250,7 +549,7 @@ void RieszPyramid::unwrapOrientPhase(const RieszPyramid &prior) {
 void RieszPyramid::amplify(double alpha, double threshold)
 {
     for(int i = this->numLevels-1; i >= 0; i--) {
-        pyrLevels[i].amplify(alpha, threshold);
+        pyrLevels[i].amplify(alpha, threshold, trigAccuracy);
     }
 }
 
@@ -280,49 +579,68 @@ const cv::Mat RieszPyramid::subsample(cv::Mat &img) {
     return tmp.clone();
 }
 
-const cv::Mat RieszPyramid::injectZerosEven(cv::Mat &img) {
+// Upsampling injects zeros on 3 of 4 pixels in every 2x2 neighborhood before the lowpass.
+// Each output parity only sees the taps that land on the even (non-zero) samples, so the
+// 9x9 filter on the zero-stuffed image is the same as 4 small filters on img, interleaved.
+void RieszPyramid::upsample(const cv::Mat &img, const cv::Size &size, cv::Mat &result) const {
     // accept only grayscale float type matrices
     CV_Assert(img.depth() == CV_32F);
     CV_Assert(img.channels() == 1);
-    CV_Assert(img.isContinuous());
-
-    int nRows = img.rows;
-    int nCols = img.cols;
-
-    cv::Mat tmp = cv::Mat::zeros(nRows, nCols, CV_32F);
-
-    float *p = img.ptr<float>(0);
-    float *tmp_p = tmp.ptr<float>(0);
-
-    for (int y = 0; y < nRows; y += 2) {
-        for (int x = 0; x < nCols; x += 2) {
+    CV_Assert(img.rows == (size.height + 1) / 2 && img.cols == (size.width + 1) / 2);
+
+    // Pad img by 2 samples the way BORDER_REFLECT_101 pads the zero-stuffed image of size:
+    // reflection keeps the parity, so every even index maps back onto a sample of img
+    cv::Mat padded(img.rows + 4, img.cols + 4, CV_32F);
+    std::vector<int> colMap(padded.cols);
+    for (int x = 0; x < padded.cols; ++x)
+        colMap[x] = cv::borderInterpolate(2 * (x - 2), size.width, cv::BORDER_REFLECT_101) / 2;
+    for (int y = 0; y < padded.rows; ++y) {
+        const float *src = img.ptr<float>(cv::borderInterpolate(2 * (y - 2), size.height, cv::BORDER_REFLECT_101) / 2);
+        float *dst = padded.ptr<float>(y);
+        for (int x = 0; x < padded.cols; ++x)
+            dst[x] = src[colMap[x]];
+    }
 
-            int idx = x + y*nCols;
-            tmp_p[idx] = p[idx];
+    // Phase (py,px) at padded (i+2,j+2) is the output at (2i+py, 2j+px).
+    // Even phases have taps at offsets -2..2, odd ones at -1..2
+    cv::Mat phase[2][2];
+    for (int py = 0; py < 2; ++py)
+        for (int px = 0; px < 2; ++px)
+            applyKernel(padded, phase[py][px], filterBank().lowPassPhase[py][px], filterRank,
+                        cv::Point(px ? 1 : 2, py ? 1 : 2), cv::BORDER_REPLICATE);
+
+    // Interleave
+    result.create(size, CV_32F);
+    for (int y = 0; y < size.height; ++y) {
+        const float *even = phase[y & 1][0].ptr<float>(y/2 + 2) + 2;
+        const float *odd  = phase[y & 1][1].ptr<float>(y/2 + 2) + 2;
+        float *dst = result.ptr<float>(y);
+        int x = 0;
+        for (; x + 1 < size.width; x += 2) {
+            dst[x]     = even[x/2];
+            dst[x + 1] = odd[x/2];
         }
+        if(x < size.width)
+            dst[x] = even[x/2];
     }
-
-    return tmp.clone();
 }
 
 // Return the frame resulting from the collapse of this pyramid.
 //
 const cv::Mat RieszPyramid::collapsePyramid() {
     const int count = pyrLevels.size() - 1;
-    cv::Mat result = pyrLevels[count].itsLp;
+    cv::Mat result = pyrLevels[count].itsMagnified;
 
     for (int i = count - 1; i >= 0; --i) {
-       const cv::Mat &octave = pyrLevels[i].itsLp;
-        cv::Mat lp, hp, up, up_zero;
+       const cv::Mat &octave = pyrLevels[i].itsMagnified;
+        cv::Mat lp, hp;
 
-        // Upsample with image without interpolation (= inject zeros on 3 of 4 pixels in every 4x4 neighborhood)
-        // Filter with lowpass after upsampling (2.0*lpFilter) to make up for energy lost during upsampling
-        cv::resize(result, up, octave.size(), 0, 0, cv::INTER_NEAREST);
-        up_zero = injectZerosEven(up);
-        cv::filter2D(up_zero, lp, CV_32F, 2.0*lowPassFilter, cv::Point(-1,-1), 0, cv::BORDER_REFLECT_101);
+        // Upsample without interpolation (= inject zeros on 3 of 4 pixels in every 2x2 neighborhood)
+        // and filter with lowpass (2.0*lpFilter) to make up for energy lost during upsampling
+        upsample(result, octave.size(), lp);
 
         // Highpass on current levels img
-        cv::filter2D(octave, hp, CV_32F, highPassFilter, cv::Point(-1,-1), 0, cv::BORDER_REFLECT_101);
+        applyKernel(octave, hp, filterBank().highPass, filterRank, cv::Point(-1,-1), cv::BORDER_REFLECT_101);
 
         // Reconstruct image adding LP and HP
         result = lp + hp;
@@ -6,10 +6,18 @@
 #define RIESZPYRAMID_H
 
 #include "main/helper/ComplexMat.h"
+#include "main/other/Config.h"
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 
+// Accuracy of the acos/cos/sin kernels in the phase math
+enum RieszTrigAccuracy {
+    RIESZ_TRIG_EXACT = 0,   // scalar libm calls
+    RIESZ_TRIG_PRECISE = 1, // SIMD polynomials, float rounding level (~1e-7)
+    RIESZ_TRIG_FAST = 2     // SIMD polynomials, max abs error 7e-5 (acos), 1.3e-5 (cos/sin)
+};
+
 class RieszPyramidLevel {
 
 public:
@@ -21,32 +29,34 @@ public:
     cv::Mat itsLp;                     // the frame scaled to this octave
     ComplexMat itsR;                   // the transform
     CompExpMat itsPhase;               // the amplified result
-    CompExpMat itsRealPass;            // per-level filter state maintained
-    CompExpMat itsImagPass;            // across frames
+    CompExpMat itsRealPass;            // per-level filter state, the prior
+    CompExpMat itsImagPass;            // pyramid holds the previous frame's
+    cv::Mat itsMagnified;              // itsLp with the amplified motion, collapsed into the output
+    cv::Mat itsWeighted;               // blurred [cos, sin] change * amplitude and the amplitude
 
-    // Octave is a laplace pyr level. This applies x and yKernel
+    // Octave is a laplace pyr level. This applies x and yKernel.
+    // The level's buffers are reused when octave is already itsLp.
     void build(const cv::Mat &octave);
 
     // Write into result the element-wise inverse cosine of X.
-    static void arcCosX(const cv::Mat &X, cv::Mat &result);
+    static void arcCosX(const cv::Mat &X, cv::Mat &result, int accuracy = RIESZ_TRIG_PRECISE);
 
     // This calculates movements separated by edges.
     // Cos (itsPhase.first) are vertical edges
     // Sin (itsPhase.second) are horizontal edges
-    void unwrapOrientPhase(const RieszPyramidLevel &prior);
+    // One pass per pixel, 0/0 divisions give 0.
+    void unwrapOrientPhase(const RieszPyramidLevel &prior, int accuracy = RIESZ_TRIG_PRECISE);
 
     // Write into result the element-wise cosines and sines of X.
-    static void cosSinX(const cv::Mat &X, CompExpMat &result);
-
-    // Used to get amplitude. Square sin&cos of phase, add lowpass, square resulting mat
-    cv::Mat rms();
+    static void cosSinX(const cv::Mat &X, CompExpMat &result, int accuracy = RIESZ_TRIG_PRECISE);
 
-    // Normalize the phase change of this level into result.
-    void normalize(CompExpMat &result);
+    // Weight the phase change of this level by the amplitude (rms of lowpass and transform)
+    // and blur it together with the amplitude into itsWeighted. amplify() divides it out.
+    void normalize();
 
     // Multipy the phase difference in this level by alpha but only up to
-    // some ceiling threshold.
-    void amplify(double alpha, double threshold);
+    // some ceiling threshold. Writes itsMagnified, itsLp stays the prior for the next frame.
+    void amplify(double alpha, double threshold, int accuracy = RIESZ_TRIG_PRECISE);
 };
 
 
@@ -64,15 +74,19 @@ public:
     RieszPyramid &operator=(const RieszPyramid& other);
 
     int numLevels;
+    // 0: dense 9x9 filters, N: sum of the first N separable (SVD) terms of each filter
+    int filterRank;
+    // RieszTrigAccuracy of the phase math
+    int trigAccuracy;
     // Vector of Pyramid Levels
     std::vector<RieszPyramidLevel> pyrLevels;
 
     // Initialize filter and levels
     void init(cv::Mat &frame, int levels);
 
-    // This builds a Riesz pyramid
+    // This builds a Riesz pyramid, reusing the level buffers of the frame before last
     void buildPyramid(const cv::Mat &frame);
-    // Return the frame resulting from the collapse of this pyramid.
+    // Return the frame resulting from the collapse of the magnified levels.
     const cv::Mat collapsePyramid();
 
     // This calculates movements separated by edges.
@@ -83,14 +97,15 @@ public:
     // Amplify motion by alpha up to threshold using filtered phase data.
     void amplify(double alpha, double threshold);
 
+    // Worst case absolute error of one filter pass at the given rank, relative to max|input|.
+    // This is the L1 norm of the dropped SVD terms, e.g. 0.656 (rank 1), 0.020 (rank 2),
+    // 0.0083 (rank 3) for inputs scaled to [0,1]; 0 for the dense filters. Shown with the ranks in MagnifyOptions.
+    static double filterErrorBound(int rank);
+
 private:
-    // 9x9 Lowpass and Highpass filter for pyramid construction
-    // Used before phase unwrapping
-    cv::Mat lowPassFilter;
-    cv::Mat highPassFilter;
     // Neeed to collapse te Pyramid.
-    // Upsample without interpolation
-    const cv::Mat injectZerosEven(cv::Mat &img);
+    // Upsample to size and lowpass in one go, without building the zero-stuffed image
+    void upsample(const cv::Mat &img, const cv::Size &size, cv::Mat &result) const;
     // Subsample image without interpolation
     const cv::Mat subsample(cv::Mat &img);
 };
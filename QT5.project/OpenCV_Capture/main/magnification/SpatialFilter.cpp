@@ -24,201 +24,372 @@
 
 #include "main/magnification/SpatialFilter.h"
 
+#include <algorithm>
+
+#include <opencv2/core/hal/intrin.hpp>
+
 ////////////////////////
-/// Downsampling ///////
+/// Workspace //////////
 ////////////////////////
-void buildGaussPyrFromImg(const Mat &img, const int levels, vector<Mat> &pyr)
+// dst = base + sign * pyrUp(small) in one pass. pyrUp filters the zero-stuffed image with the 5x5 Gaussian
+// (BORDER_REFLECT_101 on twice the small size), so per dimension even outputs are (s[i-1] + 6*s[i] + s[i+1])/8
+// and odd ones (s[i] + s[i+1])/2, with s[-1] = s[1] and s[n] = s[n-1].
+static void pyrUpAdd(const Mat &small, const Mat &base, Mat &dst, float sign)
 {
-    pyr.clear();
-    Mat currentLevel = img;
+    CV_Assert(small.depth() == CV_32F && small.type() == base.type());
+    CV_Assert(base.rows <= 2*small.rows && base.cols <= 2*small.cols);
+    dst.create(base.size(), base.type());
+
+    const int cn = small.channels();
+    const int sw = small.cols, sh = small.rows;
+    const int n = sw * cn;
+    parallel_for_(Range(0, base.rows), [&](const Range &range) {
+        // Vertically filtered small row, padded by one pixel on both sides
+        vector<float> vrow(n + 2*cn);
+        float *v = &vrow[cn];
+        for (int y = range.start; y < range.end; y++) {
+            const int i = y/2;
+            const float *r0 = small.ptr<float>(i);
+            const float *rn = small.ptr<float>(std::min(i+1, sh-1));
+            if(y & 1) {
+                for (int k = 0; k < n; k++)
+                    v[k] = (r0[k] + rn[k]) * 0.5f;
+            }else {
+                const float *rp = small.ptr<float>(i > 0 ? i-1 : std::min(1, sh-1));
+                for (int k = 0; k < n; k++)
+                    v[k] = (rp[k] + 6.f*r0[k] + rn[k]) * 0.125f;
+            }
+            for (int c = 0; c < cn; c++) {
+                v[c - cn] = v[std::min(1, sw-1)*cn + c];
+                v[n + c] = v[n - cn + c];
+            }
+
+            const float *b = base.ptr<float>(y);
+            float *d = dst.ptr<float>(y);
+            const int evenCols = base.cols/2;
+            int j = 0;
+            for (; j < evenCols; j++) {
+                for (int c = 0; c < cn; c++) {
+                    const int k = j*cn + c;
+                    d[2*j*cn + c]      = b[2*j*cn + c]      + sign * (v[k-cn] + 6.f*v[k] + v[k+cn]) * 0.125f;
+                    d[(2*j+1)*cn + c]  = b[(2*j+1)*cn + c]  + sign * (v[k] + v[k+cn]) * 0.5f;
+                }
+            }
+            // Odd width, last even column
+            if(2*j < base.cols) {
+                for (int c = 0; c < cn; c++) {
+                    const int k = j*cn + c;
+                    d[2*j*cn + c] = b[2*j*cn + c] + sign * (v[k-cn] + 6.f*v[k] + v[k+cn]) * 0.125f;
+                }
+            }
+        }
+    });
+}
+
+PyramidWorkspace::PyramidWorkspace() :
+    frameType(-1),
+    numLevels(0)
+{
+}
+
+bool PyramidWorkspace::configure(Size size, int type, int levels)
+{
+    if(size == frameSize && type == frameType && levels == numLevels)
+        return false;
 
+    frameSize = size;
+    frameType = type;
+    numLevels = levels;
+
+    // Level sizes as pyrDown rounds them
+    sizes.resize(levels+1);
+    sizes[0] = size;
+    for (int level = 1; level <= levels; ++level)
+        sizes[level] = Size((sizes[level-1].width+1)/2, (sizes[level-1].height+1)/2);
+
+    gauss.resize(levels);
+    laplace.resize(levels+1);
+    recon.resize(levels);
     for (int level = 0; level < levels; ++level) {
-        Mat down;
-        pyrDown(currentLevel, down);
-        pyr.push_back(down);
-        currentLevel = down;
+        gauss[level].create(sizes[level+1], type);
+        laplace[level].create(sizes[level], type);
+        // Level 0 is collapsed straight into the destination
+        if(level > 0)
+            recon[level].create(sizes[level], type);
     }
+    laplace[levels] = gauss.empty() ? Mat() : gauss[levels-1];
+    return true;
 }
 
-
-void buildLaplacePyrFromImg(const Mat &img, const int levels, vector<Mat> &pyr)
+void PyramidWorkspace::buildGauss(const Mat &img)
 {
-    pyr.clear();
+    CV_Assert(img.size() == frameSize && img.type() == frameType);
     Mat currentLevel = img;
 
-    for (int level = 0; level < levels; ++level) {
-        Mat down,up;
-        pyrDown(currentLevel, down);
-        pyrUp(down, up, currentLevel.size());
-        Mat laplace = currentLevel - up;
-        pyr.push_back(laplace);
-        currentLevel = down;
+    for (int level = 0; level < numLevels; ++level) {
+        pyrDown(currentLevel, gauss[level], sizes[level+1]);
+        currentLevel = gauss[level];
     }
-    pyr.push_back(currentLevel);
 }
 
-void buildWaveletPyrFromImg(const Mat &img, const int levels, vector<vector<Mat> > &pyr, int SHRINK_TYPE, float SHRINK_T)
+void PyramidWorkspace::buildLaplace(const Mat &img)
 {
-    float c,dh,dv,dd;
-    vector<Mat> levelVector;
-    int width = img.cols;
-    int height = img.rows;
-    Mat curFrame = img.clone();
-    pyr = vector< vector<Mat> >(levels);
+    CV_Assert(img.size() == frameSize && img.type() == frameType);
+    Mat currentLevel = img;
 
+    for (int level = 0; level < numLevels; ++level) {
+        pyrDown(currentLevel, gauss[level], sizes[level+1]);
+        // laplace = current - pyrUp(down)
+        pyrUpAdd(gauss[level], currentLevel, laplace[level], -1.f);
+        currentLevel = gauss[level];
+    }
+    // Smallest image, shares the last gauss level
+    laplace[numLevels] = currentLevel;
+}
 
-    for (int lvl=0;lvl<levels;lvl++)
-    {
-        //Adjust size for this iteration
-        height = height/2;
-        width = width/2;
-
-        // Delete downsampled image from last iteration
-        if(lvl > 0) {
-            levelVector.clear();
-            pyr[lvl-1].pop_back();
-        }
-        // Create new Mats to write DWT into
-        for(int dir = 0; dir < 4; dir++) {
-            levelVector.push_back(Mat::zeros(height,width,CV_32F));
-        }
+void PyramidWorkspace::collapseGauss(const Mat &src, Mat &dst)
+{
+    Mat currentLevel = src;
 
-        for (int y=0;y<height;y++)
-        {
-            for (int x=0; x<width;x++)
-            {
-                // DWT
-                c=(curFrame.at<float>(2*y,2*x)+curFrame.at<float>(2*y,2*x+1)+curFrame.at<float>(2*y+1,2*x)+curFrame.at<float>(2*y+1,2*x+1))*0.5;
-                dh=(curFrame.at<float>(2*y,2*x)+curFrame.at<float>(2*y+1,2*x)-curFrame.at<float>(2*y,2*x+1)-curFrame.at<float>(2*y+1,2*x+1))*0.5;
-                dv=(curFrame.at<float>(2*y,2*x)+curFrame.at<float>(2*y,2*x+1)-curFrame.at<float>(2*y+1,2*x)-curFrame.at<float>(2*y+1,2*x+1))*0.5;
-                dd=(curFrame.at<float>(2*y,2*x)-curFrame.at<float>(2*y,2*x+1)-curFrame.at<float>(2*y+1,2*x)+curFrame.at<float>(2*y+1,2*x+1))*0.5;
-
-                // Shrinkage
-                switch(SHRINK_TYPE)
-                {
-                case HARD:
-                    dh=wl_hard_shrink(dh,SHRINK_T);
-                    dv=wl_hard_shrink(dv,SHRINK_T);
-                    dd=wl_hard_shrink(dd,SHRINK_T);
-                    break;
-                case SOFT:
-                    dh=wl_soft_shrink(dh,SHRINK_T);
-                    dv=wl_soft_shrink(dv,SHRINK_T);
-                    dd=wl_soft_shrink(dd,SHRINK_T);
-                    break;
-                case GARROT:
-                    dh=wl_garrot_shrink(dh,SHRINK_T);
-                    dv=wl_garrot_shrink(dv,SHRINK_T);
-                    dd=wl_garrot_shrink(dd,SHRINK_T);
-                    break;
-                }
+    for (int level = numLevels-1; level >= 0; --level) {
+        Mat &up = (level == 0) ? dst : recon[level];
+        pyrUp(currentLevel, up, sizes[level]);
+        currentLevel = up;
+    }
+    if(numLevels == 0)
+        src.copyTo(dst);
+}
 
-                // Save downsampled image on last position in vector
-                levelVector[3].at<float>(y,x)=c;
-                // Save dHorizontal, dVertical and dDiagonal
-                levelVector[0].at<float>(y,x)=dh;
-                levelVector[1].at<float>(y,x)=dv;
-                levelVector[2].at<float>(y,x)=dd;
-                }
-        }
-        // Update current image that is going to be downsampled
-        levelVector[3].copyTo(curFrame);
-        // Save current Vector in output pyramid
-        pyr[lvl] = levelVector;
+void PyramidWorkspace::collapseLaplace(const vector<Mat> &pyr, Mat &dst)
+{
+    CV_Assert(static_cast<int>(pyr.size()) > numLevels);
+    Mat currentLevel = pyr[numLevels];
+
+    for (int level = numLevels-1; level >= 0; --level) {
+        Mat &up = (level == 0) ? dst : recon[level];
+        // up = pyrUp(current) + difference of this level
+        pyrUpAdd(currentLevel, pyr[level], up, 1.f);
+        currentLevel = up;
     }
+    if(numLevels == 0)
+        currentLevel.copyTo(dst);
 }
 
 ////////////////////////
-/// Upsampling /////////
+/// Wavelet engine /////
 ////////////////////////
-void buildImgFromGaussPyr(const Mat &pyr, const int levels, Mat &dst, Size size)
+// Output rows per parallel block
+static const int waveletBlockRows = 16;
+
+// Shrinkage of one detail coefficient, picked at compile time
+template<int SHRINK_TYPE> struct WaveletShrink {
+    static inline float apply(float d, float) { return d; }
+#if CV_SIMD128
+    static inline v_float32x4 apply(const v_float32x4 &d, const v_float32x4 &) { return d; }
+#endif
+};
+template<> struct WaveletShrink<HARD> {
+    static inline float apply(float d, float T) { return wl_hard_shrink(d, T); }
+#if CV_SIMD128
+    static inline v_float32x4 apply(const v_float32x4 &d, const v_float32x4 &T) {
+        return v_select(v_abs(d) > T, d, v_setzero_f32());
+    }
+#endif
+};
+template<> struct WaveletShrink<SOFT> {
+    static inline float apply(float d, float T) { return wl_soft_shrink(d, T); }
+#if CV_SIMD128
+    static inline v_float32x4 apply(const v_float32x4 &d, const v_float32x4 &T) {
+        const v_float32x4 zero = v_setzero_f32();
+        return v_select(v_abs(d) > T, d - v_select(d > zero, T, zero - T), zero);
+    }
+#endif
+};
+template<> struct WaveletShrink<GARROT> {
+    static inline float apply(float d, float T) { return wl_garrot_shrink(d, T); }
+#if CV_SIMD128
+    static inline v_float32x4 apply(const v_float32x4 &d, const v_float32x4 &T) {
+        return v_select(v_abs(d) > T, d - T * T / d, v_setzero_f32());
+    }
+#endif
+};
+
+// DWT of the output rows [y0, y1) of one level, each from the input rows 2y and 2y+1
+template<int SHRINK_TYPE>
+static void dwtRows(const Mat &src, vector<Mat> &level, float T, int y0, int y1)
 {
-    Mat currentLevel = pyr.clone();
+    typedef WaveletShrink<SHRINK_TYPE> Shrink;
+    const int width = level[0].cols;
+    for (int y = y0; y < y1; y++) {
+        const float *r0 = src.ptr<float>(2*y);
+        const float *r1 = src.ptr<float>(2*y+1);
+        float *dh = level[0].ptr<float>(y);
+        float *dv = level[1].ptr<float>(y);
+        float *dd = level[2].ptr<float>(y);
+        float *c = level[3].ptr<float>(y);
+        int x = 0;
+#if CV_SIMD128
+        const v_float32x4 half = v_setall_f32(0.5f), vT = v_setall_f32(T);
+        for (; x <= width - 4; x += 4) {
+            // a b (row 2y), e f (row 2y+1)
+            v_float32x4 a, b, e, f;
+            v_load_deinterleave(r0 + 2*x, a, b);
+            v_load_deinterleave(r1 + 2*x, e, f);
+            const v_float32x4 s0 = a + b, d0 = a - b, s1 = e + f, d1 = e - f;
+            v_store(c + x, (s0 + s1) * half);
+            v_store(dh + x, Shrink::apply((d0 + d1) * half, vT));
+            v_store(dv + x, Shrink::apply((s0 - s1) * half, vT));
+            v_store(dd + x, Shrink::apply((d0 - d1) * half, vT));
+        }
+#endif
+        for (; x < width; x++) {
+            const float a = r0[2*x], b = r0[2*x+1], e = r1[2*x], f = r1[2*x+1];
+            c[x] = (a + b + e + f) * 0.5f;
+            dh[x] = Shrink::apply((a + e - b - f) * 0.5f, T);
+            dv[x] = Shrink::apply((a + b - e - f) * 0.5f, T);
+            dd[x] = Shrink::apply((a - b - e + f) * 0.5f, T);
+        }
+    }
+}
 
-    for (int level = 0; level < levels; ++level) {
-        Mat up;
-        pyrUp(currentLevel, up);
-        currentLevel = up;
+// iDWT of the input rows [y0, y1) of one level into the rows 2y and 2y+1 of dst
+template<int SHRINK_TYPE>
+static void idwtRows(const Mat &approx, const vector<Mat> &level, Mat &dst, float T, int y0, int y1)
+{
+    typedef WaveletShrink<SHRINK_TYPE> Shrink;
+    const int width = level[0].cols;
+    for (int y = y0; y < y1; y++) {
+        const float *c = approx.ptr<float>(y);
+        const float *dh = level[0].ptr<float>(y);
+        const float *dv = level[1].ptr<float>(y);
+        const float *dd = level[2].ptr<float>(y);
+        float *r0 = dst.ptr<float>(2*y);
+        float *r1 = dst.ptr<float>(2*y+1);
+        int x = 0;
+#if CV_SIMD128
+        const v_float32x4 half = v_setall_f32(0.5f), vT = v_setall_f32(T);
+        for (; x <= width - 4; x += 4) {
+            const v_float32x4 vc = v_load(c + x);
+            const v_float32x4 vh = Shrink::apply(v_load(dh + x), vT);
+            const v_float32x4 vv = Shrink::apply(v_load(dv + x), vT);
+            const v_float32x4 vd = Shrink::apply(v_load(dd + x), vT);
+            const v_float32x4 p = vc + vv, m = vc - vv, q = vh + vd, r = vh - vd;
+            v_store_interleave(r0 + 2*x, (p + q) * half, (p - q) * half);
+            v_store_interleave(r1 + 2*x, (m + r) * half, (m - r) * half);
+        }
+#endif
+        for (; x < width; x++) {
+            const float h = Shrink::apply(dh[x], T), v = Shrink::apply(dv[x], T), d = Shrink::apply(dd[x], T);
+            r0[2*x]   = 0.5f*(c[x]+h+v+d);
+            r0[2*x+1] = 0.5f*(c[x]-h+v-d);
+            r1[2*x]   = 0.5f*(c[x]+h-v-d);
+            r1[2*x+1] = 0.5f*(c[x]-h-v+d);
+        }
     }
-    // Resize the image to comprehend errors due to rounding
-    resize(currentLevel,currentLevel,size);
-    currentLevel.copyTo(dst);
 }
 
-void buildImgFromLaplacePyr(const vector<Mat> &pyr, const int levels, Mat &dst)
+template<int SHRINK_TYPE>
+static void dwtLevel(const Mat &src, vector<Mat> &level, float T)
+{
+    const int height = level[0].rows;
+    parallel_for_(Range(0, height), [&](const Range &range) {
+        dwtRows<SHRINK_TYPE>(src, level, T, range.start, range.end);
+    }, std::max(1, height / waveletBlockRows));
+}
+
+template<int SHRINK_TYPE>
+static void idwtLevel(const Mat &approx, const vector<Mat> &level, Mat &dst, float T)
+{
+    const int height = level[0].rows;
+    parallel_for_(Range(0, height), [&](const Range &range) {
+        idwtRows<SHRINK_TYPE>(approx, level, dst, T, range.start, range.end);
+    }, std::max(1, height / waveletBlockRows));
+}
+
+WaveletPyramid::WaveletPyramid()
 {
-    Mat currentLevel = pyr[levels];
+}
+
+void WaveletPyramid::build(const Mat &img, int levels, int SHRINK_TYPE, float SHRINK_T)
+{
+    // Work on 32bit float, without a copy if img already is
+    if(img.type() == CV_32FC1)
+        input = img;
+    else
+        img.convertTo(input, CV_32F);
+    origSize = input.size();
 
-    for (int level = levels-1; level >= 0; --level) {
-        Mat up;
-        pyrUp(currentLevel, up, pyr[level].size());
-        currentLevel = up+pyr[level];
+    pyr.resize(levels);
+    Mat curFrame = input;
+    for (int lvl = 0; lvl < levels; lvl++)
+    {
+        // Buffers of the last frame are reused if the size did not change
+        pyr[lvl].resize(4);
+        for(int dir = 0; dir < 4; dir++)
+            pyr[lvl][dir].create(curFrame.rows/2, curFrame.cols/2, CV_32F);
+
+        switch(SHRINK_TYPE)
+        {
+        case HARD:
+            dwtLevel<HARD>(curFrame, pyr[lvl], SHRINK_T);
+            break;
+        case SOFT:
+            dwtLevel<SOFT>(curFrame, pyr[lvl], SHRINK_T);
+            break;
+        case GARROT:
+            dwtLevel<GARROT>(curFrame, pyr[lvl], SHRINK_T);
+            break;
+        default:
+            dwtLevel<NONE>(curFrame, pyr[lvl], SHRINK_T);
+            break;
+        }
+        // Downsampled image is the input of the next level
+        curFrame = pyr[lvl][3];
     }
-    dst = currentLevel.clone();
 }
 
-void buildImgFromWaveletPyr(const vector<vector<Mat> > &pyr, Mat &dst, Size origSize, int SHRINK_TYPE, float SHRINK_T)
+void WaveletPyramid::collapse(Mat &dst, int SHRINK_TYPE, float SHRINK_T)
 {
-    int levels = pyr.size();
-    float c,dh,dv,dd;
-    Mat tmp;
-    int width,height;
+    const int levels = pyr.size();
+    recon.resize(levels);
 
     // First picture that will be upsampled is beeing hold in pyramid
     Mat currentRecon = pyr[levels-1][3];
-    currentRecon.convertTo(currentRecon,CV_32FC1);
 
     // For every level, beginning from the last one
-    for (int lvl=levels-1;lvl>=0;lvl--)
+    for (int lvl = levels-1; lvl >= 0; lvl--)
     {
         // Adjust size to next level
         Size size = (lvl == 0) ? origSize : pyr[lvl-1][0].size();
-        height = size.height;
-        width = size.width;
+        Mat &out = (lvl == 0) ? dst : recon[lvl];
+        out.create(size, CV_32F);
 
-        // Calculate image for next level
-        tmp = Mat::zeros(height, width, CV_32FC1);
-        for (int y=0;y<height/2;y++)
+        switch(SHRINK_TYPE)
         {
-            for (int x=0; x<width/2;x++)
-            {
-                c=currentRecon.at<float>(y,x);
-                dh=pyr[lvl][0].at<float>(y,x);
-                dv=pyr[lvl][1].at<float>(y,x);
-                dd=pyr[lvl][2].at<float>(y,x);
-
-                // Shrinkage
-                switch(SHRINK_TYPE)
-                {
-                case HARD:
-                    dh=wl_hard_shrink(dh,SHRINK_T);
-                    dv=wl_hard_shrink(dv,SHRINK_T);
-                    dd=wl_hard_shrink(dd,SHRINK_T);
-                    break;
-                case SOFT:
-                    dh=wl_soft_shrink(dh,SHRINK_T);
-                    dv=wl_soft_shrink(dv,SHRINK_T);
-                    dd=wl_soft_shrink(dd,SHRINK_T);
-                    break;
-                case GARROT:
-                    dh=wl_garrot_shrink(dh,SHRINK_T);
-                    dv=wl_garrot_shrink(dv,SHRINK_T);
-                    dd=wl_garrot_shrink(dd,SHRINK_T);
-                    break;
-                }
-
-                // iDWT
-                tmp.at<float>(y*2,x*2)=0.5*(c+dh+dv+dd);
-                tmp.at<float>(y*2,x*2+1)=0.5*(c-dh+dv-dd);
-                tmp.at<float>(y*2+1,x*2)=0.5*(c+dh-dv-dd);
-                tmp.at<float>(y*2+1,x*2+1)=0.5*(c-dh-dv+dd);
-            }
+        case HARD:
+            idwtLevel<HARD>(currentRecon, pyr[lvl], out, SHRINK_T);
+            break;
+        case SOFT:
+            idwtLevel<SOFT>(currentRecon, pyr[lvl], out, SHRINK_T);
+            break;
+        case GARROT:
+            idwtLevel<GARROT>(currentRecon, pyr[lvl], out, SHRINK_T);
+            break;
+        default:
+            idwtLevel<NONE>(currentRecon, pyr[lvl], out, SHRINK_T);
+            break;
         }
+
+        // Odd sizes: the DWT dropped the last column/row, repeat the reconstructed one
+        const int evenCols = pyr[lvl][0].cols * 2, evenRows = pyr[lvl][0].rows * 2;
+        if(size.width > evenCols)
+            out(Rect(evenCols-1, 0, 1, evenRows)).copyTo(out(Rect(evenCols, 0, 1, evenRows)));
+        if(size.height > evenRows)
+            out.row(evenRows-1).copyTo(out.row(evenRows));
+
         // Next picture that will be upsampled
-        tmp.copyTo(currentRecon);
+        currentRecon = out;
     }
-    // Final output
-    dst = currentRecon.clone();
 }
 
 ////////////////////////
@@ -42,64 +42,114 @@ using namespace cv;
 #define SOFT 2  // soft shrinkage
 #define GARROT 3  // garrot filter
 
-//////////////////////// 
-/// Downsampling ///////
-//////////////////////// 
-/*!
- * \brief buildGaussPyrFromImg Builds a Gauss Pyramid from given image and saves every
- *  level of the pyramid in a vector.
- * \param img Source image.
- * \param levels Number of times the image is downsampled.
- * \param pyr Vector that holds every level of the pyramid. Last element is smallest image.
- */
-void buildGaussPyrFromImg(const Mat &img, const int levels, vector<Mat> &pyr);
-/*!
- * \brief buildLaplacePyrFromImg Builds a Laplace Pyramid from given image and saves
- *  every level of the pyramid in a vector (remember: a LaplacePyr saves the difference of
- *  a resolution downsampled image p-1 and its origin p, both having the size of p).
- * \param img Source image.
- * \param levels Number of times the image is downsampled.
- * \param pyr Vector that holds every level of the pyramid. Last element is smallest image (not the difference).
- */
-void buildLaplacePyrFromImg(const Mat &img, const int levels, vector<Mat> &pyr);
+////////////////////////
+/// Workspace //////////
+////////////////////////
 /*!
- * \brief buildWaveletPyrFromImg Computes the discrete wavelet transform (DWT) with a Haar Wavelet as base.
- * \param img Source image.
- * \param levels Numbers of transformations that is done.
- * \param pyr The DWT Pyramid, holding the different levels on the 1st dimension, and for each three images of the details/coeeficients
- *  on the 2nd dimension
- * \param SHRINK_TYPE Noise reduction type.
- * \param SHRINK_T Noise reduction value.
+ * \brief The PyramidWorkspace class Gauss and Laplace pyramids with every level preallocated for one frame
+ *  size and type. Levels are only reallocated when the size, type or number of levels changes.
  */
-void buildWaveletPyrFromImg(const Mat &img, const int levels, vector< vector<Mat> > &pyr, int SHRINK_TYPE=0, float SHRINK_T=10.f);
+class PyramidWorkspace {
 
-//////////////////////// 
-/// Upsampling /////////
-//////////////////////// 
-/*!
- * \brief buildImgFromGaussPyr Reconstructs an image from a given Gauss Pyramid.
- * \param pyr Vector that holds the image levels of the Pyramid.
- * \param levels Number of levels that are used to reconstruct the image. Should be < pyr.size.
- * \param dst Destination Mat for upsampled image.
- * \param size Destination size of upsampled image.
- */
-void buildImgFromGaussPyr(const Mat &pyr, const int levels, Mat &dst, Size size);
-/*!
- * \brief buildImgFromLaplacePyr Reconstructs an image from a given Laplace Pyramid.
- * \param pyr Vector that holds the image levels of the Pyramid.
- * \param levels Number of levels that are used to reconstruct the image. Should be < pyr.size.
- * \param dst Destination Mat for upsampled image.
- */
-void buildImgFromLaplacePyr(const vector<Mat> &pyr, const int levels, Mat &dst);
+    PyramidWorkspace &operator=(const PyramidWorkspace &);
+    PyramidWorkspace(const PyramidWorkspace &);
+
+public:
+    PyramidWorkspace();
+    /*!
+     * \brief configure Preallocates every level for frames of the given size and type.
+     * \param size Frame size (e.g. of the ROI).
+     * \param type 32bit float type with 1 or 3 channels.
+     * \param levels Number of times the image is downsampled.
+     * \return True if the levels were (re)allocated.
+     */
+    bool configure(Size size, int type, int levels);
+    /*!
+     * \brief buildGauss Builds the Gauss pyramid of img into gauss, every level is a pyrDown of the one before.
+     * \param img Source image of the configured size and type.
+     */
+    void buildGauss(const Mat &img);
+    /*!
+     * \brief buildLaplace Builds the Laplace pyramid of img into laplace: every level holds the difference of a
+     *  level and its upsampled downsampled version, the last one the smallest image. pyrUp and the difference are
+     *  done in one pass per level.
+     * \param img Source image of the configured size and type.
+     */
+    void buildLaplace(const Mat &img);
+    /*!
+     * \brief collapseGauss Upsamples src level by level to the exact level sizes, no resize needed.
+     * \param src Image of the size of the smallest level.
+     * \param dst Destination Mat of the frame size.
+     */
+    void collapseGauss(const Mat &src, Mat &dst);
+    /*!
+     * \brief collapseLaplace Reconstructs an image from a Laplace pyramid, pyrUp and the sum in one pass per level.
+     * \param pyr Pyramid with the layout of laplace.
+     * \param dst Destination Mat of the frame size.
+     */
+    void collapseLaplace(const vector<Mat> &pyr, Mat &dst);
+    /*!
+     * \brief gauss Gauss pyramid of the last buildGauss(), last element is smallest image.
+     */
+    vector<Mat> gauss;
+    /*!
+     * \brief laplace Laplace pyramid of the last buildLaplace(), last element is the smallest image (not the difference).
+     */
+    vector<Mat> laplace;
+
+private:
+    Size frameSize;
+    int frameType;
+    int numLevels;
+    vector<Size> sizes;
+    vector<Mat> recon;
+};
+
+////////////////////////
+/// Wavelet engine /////
+////////////////////////
 /*!
- * \brief buildImgFromWaveletPyr Reconstructs an image from a DWT.
- * \param pyr The pyramid, holding the levels on the 1st dimension and coefficients on the 2nd dimension.
- * \param dst Destination Mat for upsampled image.
- * \param origSize Destination size of upsampled image.
- * \param SHRINK_TYPE Noise reduction type.
- * \param SHRINK_T Noise reduction value.
+ * \brief The WaveletPyramid class Haar DWT and inverse DWT of a 32bit float, 1 channel image. The shrinkage
+ *  type is a template parameter of the row kernels, so the inner loops have no switch. Every output row reads
+ *  two input rows with direct pointers (SIMD where available), row blocks run in parallel, and the level
+ *  buffers are kept between frames.
  */
-void buildImgFromWaveletPyr(const vector<vector<Mat> > &pyr, Mat &dst, Size origSize, int SHRINK_TYPE=0, float SHRINK_T=10.f);
+class WaveletPyramid {
+
+    WaveletPyramid &operator=(const WaveletPyramid &);
+    WaveletPyramid(const WaveletPyramid &);
+
+public:
+    WaveletPyramid();
+    /*!
+     * \brief build Computes the DWT of img into pyr.
+     * \param img Source image, converted to 32bit float 1 channel if needed.
+     * \param levels Numbers of transformations that is done.
+     * \param SHRINK_TYPE Noise reduction type.
+     * \param SHRINK_T Noise reduction value.
+     */
+    void build(const Mat &img, int levels, int SHRINK_TYPE=NONE, float SHRINK_T=10.f);
+    /*!
+     * \brief collapse Reconstructs the image from pyr. Odd sized levels repeat their last row/column.
+     * \param dst Destination Mat, size of the image given to build().
+     * \param SHRINK_TYPE Noise reduction type.
+     * \param SHRINK_T Noise reduction value.
+     */
+    void collapse(Mat &dst, int SHRINK_TYPE=NONE, float SHRINK_T=10.f);
+    /*!
+     * \brief pyr Levels on the 1st dimension; dHorizontal, dVertical, dDiagonal and the downsampled image
+     *  on the 2nd. The downsampled image of a level is the input of the next one.
+     */
+    vector< vector<Mat> > pyr;
+    /*!
+     * \brief origSize Size of the image given to build().
+     */
+    Size origSize;
+
+private:
+    Mat input;
+    vector<Mat> recon;
+};
 
 ////////////////////////
 /// Helper /////////////
@@ -24,27 +24,98 @@
 
 #include "main/magnification/TemporalFilter.h"
 
+int temporalStorageDepth(int storage)
+{
+    return storage == TEMPORAL_STORAGE_FLOAT16 ? CV_16F : CV_32F;
+}
+
+size_t matBytes(const Mat &m)
+{
+    return m.total() * m.elemSize();
+}
+
 ////////////////////////
 ///Filter //////////////
 ////////////////////////
-void iirFilter(const Mat &src, Mat &dst, Mat &lowpassHi, Mat &lowpassLo,
-               double cutoffLo, double cutoffHi)
+// Lowpass state is kept as float or cv::float16_t, loads widen to float and stores narrow back
+#if CV_SIMD128
+static inline v_float32x4 v_load_state(const float *ptr) { return v_load(ptr); }
+static inline v_float32x4 v_load_state(const cv::float16_t *ptr) { return v_load_expand(ptr); }
+static inline void v_store_state(float *ptr, const v_float32x4 &v) { v_store(ptr, v); }
+static inline void v_store_state(cv::float16_t *ptr, const v_float32x4 &v) { v_pack_store(ptr, v); }
+#endif
+
+template<typename T>
+static void iirBandAmplifyRows(const Mat &src, Mat &dst, Mat &lowpassHi, Mat &lowpassLo, float cHi, float cLo,
+                               const float *g)
+{
+    int rows = src.rows;
+    int cols = src.cols * src.channels();
+    if(src.isContinuous() && dst.isContinuous() && lowpassHi.isContinuous() && lowpassLo.isContinuous()) {
+        cols *= rows;
+        rows = 1;
+    }
+
+    for (int y = 0; y < rows; ++y) {
+        const float *s = src.ptr<float>(y);
+        T *hi = lowpassHi.ptr<T>(y);
+        T *lo = lowpassLo.ptr<T>(y);
+        float *d = dst.ptr<float>(y);
+        int x = 0;
+#if CV_SIMD128
+        v_float32x4 vcHi = v_setall_f32(cHi), vcLo = v_setall_f32(cLo);
+        v_float32x4 vg[3] = { v_load(g), v_load(g + 4), v_load(g + 8) };
+        for (; x <= cols - 12; x += 12) {
+            for (int j = 0; j < 3; ++j) {
+                v_float32x4 vs = v_load(s + x + 4*j);
+                v_float32x4 vhi = v_load_state(hi + x + 4*j);
+                v_float32x4 vlo = v_load_state(lo + x + 4*j);
+                // lowpass = (1-c)*lowpass + c*src
+                vhi = vhi + vcHi * (vs - vhi);
+                vlo = vlo + vcLo * (vs - vlo);
+                v_store_state(hi + x + 4*j, vhi);
+                v_store_state(lo + x + 4*j, vlo);
+                v_store(d + x + 4*j, (vhi - vlo) * vg[j]);
+            }
+        }
+#endif
+        for (; x < cols; ++x) {
+            float h = hi[x], l = lo[x];
+            h += cHi * (s[x] - h);
+            l += cLo * (s[x] - l);
+            hi[x] = T(h);
+            lo[x] = T(l);
+            d[x] = (h - l) * g[x % 12];
+        }
+    }
+}
+
+void iirBandAmplify(const Mat &src, Mat &dst, Mat &lowpassHi, Mat &lowpassLo, double cutoffLo, double cutoffHi,
+                    float gain, float chromGain)
 {
+    const int stateDepth = lowpassHi.depth();
+    CV_Assert(src.depth() == CV_32F && (stateDepth == CV_32F || stateDepth == CV_16F));
+    CV_Assert(lowpassLo.type() == lowpassHi.type() && lowpassHi.channels() == src.channels());
+    CV_Assert(lowpassHi.size() == src.size() && lowpassLo.size() == src.size());
+
     // Set minimum for cutoff, so low cutoff gets faded out
     if(cutoffLo == 0)
         cutoffLo = 0.01;
 
-    /* The higher cutoff*, the faster the lowpass* image of the lowpass* pyramid gets faded out.
-     * That means, a high cutoff weights new images (= \param src)
-     * more than the old ones (= \param lowpass*), so long lasting movements are faded out fast.
-     * The other way, a low cutoff evens out fast movements ocurring only in a few number of src images. */
+    dst.create(src.size(), src.type());
 
-    Mat tmp1 = (1-cutoffHi)*lowpassHi + cutoffHi*src;
-    Mat tmp2 = (1-cutoffLo)*lowpassLo + cutoffLo*src;
-    lowpassHi = tmp1;
-    lowpassLo = tmp2;
+    // Gain per float, 12 floats are 4 pixels with 3 channels or 12 with 1 channel
+    const int cn = src.channels();
+    float g[12];
+    for (int i = 0; i < 12; ++i)
+        g[i] = (cn == 3 && i % 3 != 0) ? gain * chromGain : gain;
 
-    dst = lowpassHi - lowpassLo;
+    const float cHi = static_cast<float>(cutoffHi);
+    const float cLo = static_cast<float>(cutoffLo);
+    if(stateDepth == CV_16F)
+        iirBandAmplifyRows<cv::float16_t>(src, dst, lowpassHi, lowpassLo, cHi, cLo, g);
+    else
+        iirBandAmplifyRows<float>(src, dst, lowpassHi, lowpassLo, cHi, cLo, g);
 }
 
 void iirWaveletFilter(const vector<Mat> &src, vector<Mat> &dst, vector<Mat> &lowpassHi, vector<Mat> &lowpassLo,
@@ -59,116 +130,204 @@ void iirWaveletFilter(const vector<Mat> &src, vector<Mat> &dst, vector<Mat> &low
      * more than the old ones (= \param lowpass*), so long lasting movements are faded out fast.
      * The other way, a low cutoff evens out fast movements ocurring only in a few number of src images. */
 
-    // Do this for every detail/coefficient image
-    for(int dims = 0; dims < 3; dims++) {
-        Mat tmp1 = (1-cutoffHi)*lowpassHi[dims] + cutoffHi*src[dims];
-        Mat tmp2 = (1-cutoffLo)*lowpassLo[dims] + cutoffLo*src[dims];
-        lowpassHi[dims] = tmp1;
-        lowpassLo[dims] = tmp2;
+    // Do this for every detail/coefficient image, the lowpass states (32 or 16bit float) are updated in place
+    dst.resize(3);
+    for(int dims = 0; dims < 3; dims++)
+        iirBandAmplify(src[dims], dst[dims], lowpassHi[dims], lowpassLo[dims], cutoffLo, cutoffHi, 1.f, 1.f);
+}
 
-        dst[dims] = lowpassHi[dims] - lowpassLo[dims];
-    }
+SlidingIdealFilter::SlidingIdealFilter() :
+    windowSize(0),
+    storageDepth(CV_32F),
+    head(0),
+    loBin(0.0),
+    hiBin(0.0)
+{
+}
+
+void SlidingIdealFilter::reset()
+{
+    ring.clear();
+    bins.clear();
+    binRe.clear();
+    binIm.clear();
+    binCos.clear();
+    binSin.clear();
+    binGain.clear();
+    outLow.clear();
+    outHigh.clear();
+    head = 0;
 }
 
-void idealFilter(const Mat &src, Mat &dst , double cutoffLo, double cutoffHi, double framerate)
+void SlidingIdealFilter::configure(double cutoffLo, double cutoffHi, double framerate, int windowSize, int storageDepth)
 {
     if(cutoffLo == 0.00)
         cutoffLo += 0.01;
 
-    int channelNrs = src.channels();
-    Mat *channels = new Mat[channelNrs];
-    split(src, channels);
-
-    // Apply filter on each channel individually
-    for (int curChannel = 0; curChannel < channelNrs; ++curChannel) {
-        Mat current = channels[curChannel];
-        Mat tempImg;
-
-        int width = current.cols;
-        int height = getOptimalDFTSize(current.rows);
-
-        copyMakeBorder(current, tempImg,
-                       0, height - current.rows,
-                       0, width - current.cols,
-                       BORDER_CONSTANT, Scalar::all(0));
-
-        // DFT
-        dft(tempImg, tempImg, DFT_ROWS | DFT_SCALE);
-
-        // construct Filter
-        Mat filter = tempImg.clone();
-        createIdealBandpassFilter(filter, cutoffLo, cutoffHi, framerate);
-
-        // apply
-        mulSpectrums(tempImg, filter, tempImg, DFT_ROWS);
-
-        // inverse
-        idft(tempImg, tempImg, DFT_ROWS | DFT_SCALE);
-
-        tempImg(Rect(0, 0, current.cols, current.rows)).copyTo(channels[curChannel]);
+    if(windowSize != this->windowSize || storageDepth != this->storageDepth) {
+        reset();
+        this->windowSize = windowSize;
+        this->storageDepth = storageDepth;
+    }
+    if(framerate <= 0 || windowSize < 2)
+        return;
+
+    // Bin k of a N-frame window holds frequency k*framerate/N
+    loBin = cutoffLo * windowSize / framerate;
+    hiBin = cutoffHi * windowSize / framerate;
+
+    vector<int> newBins;
+    for (int k = std::max(1, static_cast<int>(std::ceil(loBin))); k <= windowSize/2 && k <= hiBin; ++k)
+        newBins.push_back(k);
+    if(newBins == bins)
+        return;
+
+    // Keep the terms of bins that stay in the passband, compute the new ones from the ring
+    vector<Mat> newRe(newBins.size()), newIm(newBins.size());
+    for (size_t i = 0; i < newBins.size(); ++i) {
+        vector<int>::iterator it = std::find(bins.begin(), bins.end(), newBins[i]);
+        if(it != bins.end()) {
+            newRe[i] = binRe[it - bins.begin()];
+            newIm[i] = binIm[it - bins.begin()];
+        }
+    }
+    bins = newBins;
+    binRe = newRe;
+    binIm = newIm;
+
+    // Rotation w_k and output gain per bin, fixed until the passband or the window changes
+    binCos.resize(bins.size());
+    binSin.resize(bins.size());
+    binGain.resize(bins.size());
+    for (size_t i = 0; i < bins.size(); ++i) {
+        const int k = bins[i];
+        binCos[i] = std::cos(2.0 * M_PI * k / windowSize);
+        binSin[i] = std::sin(2.0 * M_PI * k / windowSize);
+        // Real signal: bin k and its mirror N-k add up to 2*Re(Y_k), Nyquist bin is its own mirror
+        binGain[i] = (2 * k == windowSize) ? 1.0 / windowSize : 2.0 / windowSize;
+    }
+    if(!ring.empty()) {
+        for (size_t i = 0; i < bins.size(); ++i) {
+            if(binRe[i].empty())
+                initBin(static_cast<int>(i));
+        }
     }
-    merge(channels, channelNrs, dst);
-
-    normalize(dst, dst, 0, 1, cv::NORM_MINMAX);
-    delete [] channels;
 }
 
-void createIdealBandpassFilter(Mat &filter, double cutoffLo, double cutoffHi, double framerate)
+void SlidingIdealFilter::initBin(int i)
 {
-    float width = filter.cols;
-    float height = filter.rows;
-
-    // Calculate frequencies according to framerate and size
-    double fl = 2 * cutoffLo * width / framerate;
-    double fh = 2 * cutoffHi * width / framerate;
-
-    double response;
-
-    // Create the filtermask, looks like the quarter of a circle
-    for(int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            if(x >= fl && x <= fh)
-                response = 1.0f;
-            else
-                response = 0.0f;
-
-            filter.at<float>(y,x) = response;
-        }
+    // Y_k = sum over the ring of x(age m) * e^(j*2*pi*k*m/N), m = 0 is the newest frame
+    const int k = bins[i];
+    binRe[i] = Mat::zeros(ring.front().size(), CV_MAKETYPE(CV_64F, ring.front().channels()));
+    binIm[i] = Mat::zeros(ring.front().size(), CV_MAKETYPE(CV_64F, ring.front().channels()));
+    for (int m = 0; m < windowSize; ++m) {
+        const Mat &x = ring[(head + windowSize - 1 - m) % windowSize];
+        double phi = 2.0 * M_PI * k * m / windowSize;
+        x.convertTo(term, binRe[i].type());
+        scaleAdd(term, std::cos(phi), binRe[i], binRe[i]);
+        scaleAdd(term, std::sin(phi), binIm[i], binIm[i]);
     }
 }
 
-////////////////////////
-///Helper //////////////
-////////////////////////
-void img2tempMat(const Mat &frame, Mat &dst, int maxImages)
+void SlidingIdealFilter::filter(const Mat &frame, Mat &dst)
 {
-    // Reshape in 1 column
-    Mat reshaped = frame.reshape(frame.channels(), frame.cols*frame.rows).clone();
+    // Window holds frames of another size or type, start over
+    if(!ring.empty() && (ring.front().size() != frame.size()
+                         || ring.front().type() != CV_MAKETYPE(storageDepth, frame.channels())))
+        reset();
+
+    // First frame, fill the whole window with it: only the DC term is non-zero, which is never in the passband
+    if(ring.empty()) {
+        ring.resize(windowSize);
+        for (int m = 0; m < windowSize; ++m)
+            frame.convertTo(ring[m], storageDepth);
+        head = 0;
+        for (size_t i = 0; i < bins.size(); ++i) {
+            binRe[i] = Mat::zeros(frame.size(), CV_MAKETYPE(CV_64F, frame.channels()));
+            binIm[i] = Mat::zeros(frame.size(), CV_MAKETYPE(CV_64F, frame.channels()));
+        }
+        outLow.assign(windowSize, 0.0);
+        outHigh.assign(windowSize, 0.0);
+    }
 
-    if(frame.channels() == 1)
-        reshaped.convertTo(reshaped, CV_32FC1);
+    // x_new - x_old, the oldest frame leaves the window. x_new is taken as stored, so a 16bit ring
+    // subtracts exactly what it added and the terms do not drift
+    ring[head].convertTo(older, CV_MAKETYPE(CV_64F, frame.channels()));
+    frame.convertTo(ring[head], storageDepth);
+    ring[head].convertTo(diff, older.type());
+    diff -= older;
+    head = (head + 1) % windowSize;
+
+    // Y_k = w_k * Y_k + (x_new - x_old), the newest frame is the sum of the passband terms.
+    // One pass per row updates every term and the sum while the row is in cache, rows run in parallel
+    sum.create(frame.size(), diff.type());
+    rowLow.resize(frame.rows);
+    rowHigh.resize(frame.rows);
+    const int nBins = static_cast<int>(bins.size());
+    const int cols = frame.cols * frame.channels();
+    parallel_for_(Range(0, frame.rows), [&](const Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const double *d = diff.ptr<double>(y);
+            double *s = sum.ptr<double>(y);
+            std::fill(s, s + cols, 0.0);
+            for (int i = 0; i < nBins; ++i) {
+                double *re = binRe[i].ptr<double>(y);
+                double *im = binIm[i].ptr<double>(y);
+                const double c = binCos[i], sn = binSin[i], g = binGain[i];
+                int x = 0;
+#if CV_SIMD128_64F
+                const v_float64x2 vc = v_setall_f64(c), vsn = v_setall_f64(sn), vg = v_setall_f64(g);
+                for (; x <= cols - 2; x += 2) {
+                    v_float64x2 vre = v_load(re + x), vim = v_load(im + x);
+                    v_float64x2 vr = vc * vre - vsn * vim + v_load(d + x);
+                    v_store(im + x, vsn * vre + vc * vim);
+                    v_store(re + x, vr);
+                    v_store(s + x, v_load(s + x) + vg * vr);
+                }
+#endif
+                for (; x < cols; ++x) {
+                    const double r = c * re[x] - sn * im[x] + d[x];
+                    im[x] = sn * re[x] + c * im[x];
+                    re[x] = r;
+                    s[x] += g * r;
+                }
+            }
+            const std::pair<const double*, const double*> mm = std::minmax_element(s, s + cols);
+            rowLow[y] = *mm.first;
+            rowHigh[y] = *mm.second;
+        }
+    });
+
+    // Normalize to [0,1] over the extrema of the window
+    double min = *std::min_element(rowLow.begin(), rowLow.end());
+    double max = *std::max_element(rowHigh.begin(), rowHigh.end());
+    outLow[head] = min;
+    outHigh[head] = max;
+    min = *std::min_element(outLow.begin(), outLow.end());
+    max = *std::max_element(outHigh.begin(), outHigh.end());
+    if(max > min)
+        sum.convertTo(dst, frame.type(), 1.0/(max-min), -min/(max-min));
     else
-        reshaped.convertTo(reshaped, CV_32FC3);
-
-    // First frame
-    if(dst.cols == 0) {
-        reshaped.copyTo(dst);
-    }
-    // Later frames
-    else {
-        hconcat(dst,reshaped,dst);
-    }
+        dst = Mat::zeros(frame.size(), frame.type());
+}
 
-    // If dst reaches maximum, delete the first column (eg the oldest image)
-    if(dst.cols > maxImages && maxImages != 0) {
-        dst.colRange(1,dst.cols).copyTo(dst);
-    }
+size_t SlidingIdealFilter::stateBytes() const
+{
+    size_t bytes = 0;
+    for (size_t m = 0; m < ring.size(); ++m)
+        bytes += matBytes(ring[m]);
+    for (size_t i = 0; i < binRe.size(); ++i)
+        bytes += matBytes(binRe[i]) + matBytes(binIm[i]);
+    return bytes;
 }
 
-void tempMat2img(const Mat &src, int position, const Size &frameSize, Mat &frame)
+size_t SlidingIdealFilter::trafficBytes() const
 {
-    Mat line = src.col(position).clone();
-    frame = line.reshape(line.channels(), frameSize.height).clone();
+    // One ring slot is read and rewritten, every passband term is read and rewritten
+    size_t bytes = ring.empty() ? 0 : 2 * matBytes(ring.front());
+    for (size_t i = 0; i < binRe.size(); ++i)
+        bytes += 2 * (matBytes(binRe[i]) + matBytes(binIm[i]));
+    return bytes;
 }
 
 ////////////////////////
@@ -437,17 +596,17 @@ void RieszTemporalFilter::computeCoefficients()
 }
 void RieszTemporalFilter::passEach(cv::Mat &result,
               const cv::Mat &phase,
-              const cv::Mat &prior) {
-    result
-        = itsB[0] * phase
-        + itsB[1] * prior
-        - itsA[1] * result;
-    result /= itsA[0];
+              const cv::Mat &prior,
+              const cv::Mat &priorResult) {
+    // result = (B0*phase + B1*prior - A1*priorResult) / A0, written into the existing buffer
+    cv::addWeighted(phase, itsB[0] / itsA[0], prior, itsB[1] / itsA[0], 0.0, result);
+    cv::scaleAdd(priorResult, -itsA[1] / itsA[0], result, result);
     cv::patchNaNs(result, 0.0);
 }
 void RieszTemporalFilter::pass(CompExpMat &result,
           const CompExpMat &phase,
-          const CompExpMat &prior) {
-    passEach(cos(result), cos(phase), cos(prior));
-    passEach(sin(result), sin(phase), sin(prior));
+          const CompExpMat &prior,
+          const CompExpMat &priorResult) {
+    passEach(cos(result), cos(phase), cos(prior), cos(priorResult));
+    passEach(sin(result), sin(phase), sin(prior), sin(priorResult));
 }
@@ -25,79 +25,141 @@
 #ifndef TEMPORALFILTER_H
 #define TEMPORALFILTER_H
 
+// C++
+#include <algorithm>
+#include <cmath>
+#include <vector>
 // Project
 #include "main/helper/ComplexMat.h"
 // OpenCV
 #include "opencv2/core/core.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/highgui/highgui.hpp"
 
+#ifndef M_PI
 #define M_PI 3.14159265358979323846264338327950288
+#endif
 
 using namespace cv;
 using namespace std;
 
-////////////////////////
-///Helper //////////////
-////////////////////////
 /*!
- * \brief img2tempMat (Color Magnification) Takes a Mat, reshapes it in 1 column with width*height rows & concatenates it
- *  on the right side of dst.
- * \param frame Input frame.
- * \param dst Matrice of concatenated reshaped frames, 1 column = 1 frame. Most right frame is most actual frame.
- * \param maxImages Maximum number of images hold in dst. If columns of dst > maxImages, the most
- *  left column is deleted. Value should be a power of 2 for fast DFT.
+ * \brief Storage of the temporal filter state kept between frames, same numbering as DEFAULT_TEMPORAL_STORAGE.
+ *  The filters always compute in 32bit float, 16bit storage halves memory and bandwidth of the state.
  */
-void img2tempMat(const Mat &frame, Mat &dst, int maxImages);
+enum TemporalStorage {
+    TEMPORAL_STORAGE_FLOAT32 = 0,
+    TEMPORAL_STORAGE_FLOAT16 = 1
+};
 /*!
- * \brief tempMat2img (Color Magnification) Takes a Mat of line-concatenated frames and reshapes 1 column back into a frame.
- * \param src Mat of concatenated frames.
- * \param position The column in src that shall get reshaped.
- * \param frameSize The destination size the reshaped frame shall have.
- * \param frame Output frame with size frameSize.
+ * \brief temporalStorageDepth Depth of the state for a TemporalStorage.
+ * \return CV_16F for TEMPORAL_STORAGE_FLOAT16, CV_32F otherwise.
  */
-void tempMat2img(const Mat &src, int position, const Size &frameSize, Mat &frame);
+int temporalStorageDepth(int storage);
 /*!
- * \brief createIdealBandpassFilter (Color Magnification) Creates a filter mask for an ideal filter.
- * \param filter Filter mask.
- * \param cutoffLo Lower cutoff frequency.
- * \param cutoffHi Upper cutoff frequency.
- * \param framerate Framerate of processed video.
+ * \brief matBytes Bytes held by the data of a Mat.
  */
-void createIdealBandpassFilter(Mat &filter, double cutoffLo, double cutoffHi, double framerate);
+size_t matBytes(const Mat &m);
 
 ////////////////////////
 ///Filter //////////////
 ////////////////////////
 /*!
- * \brief iirFilter (Euler Magnification) Applies an iirFilter (in space domain) on 1 level of a Laplace Pyramid.
- * \param src Newest input image of a level of a Laplace Pyramid.
- * \param dst Iir filtered level of a Laplace Pyramid.
- * \param lowpassHi Holding the informations about the previous (high) lowpass filtered images of a level.
- * \param lowpassLo Holding the informations about the previous (low) lowpass filtered images of a level.
+ * \brief iirBandAmplify (Euler Magnification) Fused IIR bandpass (difference of two lowpass filters), amplification
+ *  and chroma attenuation for 1 level of a Laplace Pyramid: updates both lowpass states in place and writes the
+ *  amplified band in a single pass.
+ * \param src Newest input image of a level of a Laplace Pyramid, 32bit float with 1 or 3 (YCrCb) channels.
+ * \param dst (lowpassHi - lowpassLo) * gain, chroma channels additionally * chromGain.
+ * \param lowpassHi Holding the informations about the previous (high) lowpass filtered images of a level,
+ *  32 or 16bit float with the channels of src.
+ * \param lowpassLo Holding the informations about the previous (low) lowpass filtered images of a level, same type
+ *  as lowpassHi.
  * \param cutoffLo Lower cutoff frequency.
  * \param cutoffHi Higher cutoff frequency.
+ * \param gain Amplification of the level.
+ * \param chromGain Attenuation of channel 2 and 3 of a 3 channel image.
  */
-void iirFilter(const Mat &src, Mat &dst, Mat &lowpassHi, Mat &lowpassLo, double cutoffLo, double cutoffHi);
+void iirBandAmplify(const Mat &src, Mat &dst, Mat &lowpassHi, Mat &lowpassLo, double cutoffLo, double cutoffHi,
+                    float gain, float chromGain);
 /*!
- * \brief iirWaveletFilter (Wavelet Magnification) Applies an iirFilter (in space domain) on 1 level of a DWT.
- * \param src
- * \param dst
- * \param lowpassHi
- * \param lowpassLo
- * \param cutoffLo
- * \param cutoffHi
+ * \brief iirWaveletFilter (Wavelet Magnification) Applies the IIR bandpass of iirBandAmplify on 1 level of a DWT.
+ * \param src Level of a WaveletPyramid, the first three images (dHorizontal, dVertical, dDiagonal) are filtered.
+ * \param dst lowpassHi - lowpassLo for the three detail images.
+ * \param lowpassHi Holding the informations about the previous (high) lowpass filtered details, updated in place.
+ *  32 or 16bit float, see iirBandAmplify().
+ * \param lowpassLo Holding the informations about the previous (low) lowpass filtered details, updated in place.
+ * \param cutoffLo Lower cutoff frequency.
+ * \param cutoffHi Higher cutoff frequency.
  */
 void iirWaveletFilter(const vector<Mat> &src, vector<Mat> &dst, vector<Mat> &lowpassHi, vector<Mat> &lowpassLo, double cutoffLo, double cutoffHi);
+
 /*!
- * \brief idealFilter (Color Magnification)
- * \param src
- * \param dst
- * \param cutoffLo
- * \param cutoffHi
- * \param framerate
+ * \brief The SlidingIdealFilter class (Color Magnification) Ideal bandpass over a sliding window of the last
+ *  windowSize frames, evaluated for the newest frame only. Frames are kept in a ring, and for every frequency bin in
+ *  the passband a sliding DFT term Y_k = w_k * Y_k + (x_new - x_old) with w_k = e^(j*2*pi*k/N) is kept per pixel.
+ *  A new frame costs O(pixels * passband bins) instead of a DFT/IDFT over the whole window. Rotation and gain of
+ *  every bin are computed once per passband, a frame updates all terms of a row in one pass and rows run in parallel.
  */
-void idealFilter(const Mat &src, Mat &dst, double cutoffLo, double cutoffHi, double framerate);
+class SlidingIdealFilter {
+
+    SlidingIdealFilter &operator=(const SlidingIdealFilter &);
+    SlidingIdealFilter(const SlidingIdealFilter &);
+
+public:
+    SlidingIdealFilter();
+    /*!
+     * \brief configure Sets passband and window. A new window size or storage depth drops the ring, a new
+     *  passband only recomputes the terms of bins that were not in the old passband.
+     * \param cutoffLo Lower cutoff frequency.
+     * \param cutoffHi Higher cutoff frequency.
+     * \param framerate Framerate of processed video.
+     * \param windowSize Frames in the window, see Magnificator::getOptimalBufferSize().
+     * \param storageDepth CV_32F or CV_16F, depth of the frames kept in the ring.
+     */
+    void configure(double cutoffLo, double cutoffHi, double framerate, int windowSize, int storageDepth = CV_32F);
+    /*!
+     * \brief filter Pushes a frame into the window and returns the bandpassed newest frame, normalized to [0,1]
+     *  with the extrema of the window.
+     * \param frame Newest frame, 32bit float with any number of channels. A frame of another size or type
+     *  restarts the window.
+     * \param dst Bandpassed frame, same size and type as frame.
+     */
+    void filter(const Mat &frame, Mat &dst);
+    /*!
+     * \brief reset Drops ring and DFT terms.
+     */
+    void reset();
+    /*!
+     * \brief stateBytes Memory held by ring and DFT terms.
+     */
+    size_t stateBytes() const;
+    /*!
+     * \brief trafficBytes State read and written by one filter() call.
+     */
+    size_t trafficBytes() const;
+
+private:
+    void initBin(int k);
+
+    int windowSize;
+    int storageDepth;
+    int head;                   // ring index of the oldest frame
+    double loBin;
+    double hiBin;
+    vector<Mat> ring;           // last windowSize frames, stored with storageDepth
+    vector<int> bins;           // passband bins 1 <= k <= windowSize/2
+    vector<Mat> binRe;          // per bin, sliding DFT term of every pixel (64bit, no drift over long runs)
+    vector<Mat> binIm;
+    vector<double> binCos;      // per bin, w_k = binCos + j*binSin and the gain of Re(Y_k) in the output
+    vector<double> binSin;
+    vector<double> binGain;
+    vector<double> rowLow;      // extrema per row of the newest filtered frame
+    vector<double> rowHigh;
+    vector<double> outLow;      // extrema of the last windowSize filtered frames
+    vector<double> outHigh;
+    Mat diff, older, term, sum;
+};
 
 ///
 // From https://github.com/tbl3rd/Pyramids
@@ -124,13 +186,17 @@ public:
     void updateFrequency(double f);
     void computeCoefficients();
 
+    // One IIR step: result is the new output, priorResult the output of the prior frame.
+    // result and priorResult live in the double-buffered pyramids, so no state is copied.
     void passEach(cv::Mat &result,
                   const cv::Mat &phase,
-                  const cv::Mat &prior);
+                  const cv::Mat &prior,
+                  const cv::Mat &priorResult);
 
     void pass(CompExpMat &result,
               const CompExpMat &phase,
-              const CompExpMat &prior);
+              const CompExpMat &prior,
+              const CompExpMat &priorResult);
 };
 
 #endif // TEMPORALFILTER_H
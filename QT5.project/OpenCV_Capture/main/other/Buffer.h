@@ -25,13 +25,28 @@
 #ifndef BUFFER_H
 #define BUFFER_H
 
+// C++
+#include <algorithm>
+#include <atomic>
+#include <vector>
 // Qt
 #include <QMutex>
-#include <QQueue>
-#include <QSemaphore>
-#include <QByteArray>
+#include <QWaitCondition>
 #include <QDebug>
 
+// Assumed size of a cache line, used to keep producer and consumer indices apart
+#define BUFFER_CACHE_LINE_SIZE              64
+// Upper bound for a single blocking wait, the index is re-checked afterwards
+#define BUFFER_WAIT_TIMEOUT_MS              100
+
+/*  Buffer
+ *
+ *    Bounded single-producer/single-consumer ring buffer between CaptureThread (add)
+ *    and ProcessingThread (get). Slots are preallocated, head and tail are lock-free
+ *    atomics on separate cache lines. The mutex/wait condition pair is only touched
+ *    when one side actually has to block (buffer full without dropping, or empty).
+ *
+ */
 template<class T> class Buffer
 {
 public:
@@ -45,109 +60,135 @@ public:
 	bool isEmpty();
 
 private:
-	QMutex queueProtect;
-	QQueue<T> queue;
-	QSemaphore *freeSlots;
-	QSemaphore *usedSlots;
-	QSemaphore *clearBuffer_add;
-	QSemaphore *clearBuffer_get;
+	struct PaddedIndex {
+		std::atomic<size_t> value;
+		char padding[BUFFER_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+	};
+	void discardQueued(size_t end);
+	std::vector<T> slots;
 	int bufferSize;
+	QMutex waitMutex;
+	QWaitCondition notEmpty;
+	QWaitCondition notFull;
+	std::atomic<bool> consumerWaiting;
+	std::atomic<bool> producerWaiting;
+	// Tail position (+1) up to which the next get() drops items, 0 if no clear is pending
+	std::atomic<size_t> clearEnd;
+	char padding[BUFFER_CACHE_LINE_SIZE];
+	// Written by get() only
+	PaddedIndex head;
+	// Written by add() only
+	PaddedIndex tail;
 };
 
 template<class T> Buffer<T>::Buffer(int size)
 {
 	// Save buffer size
 	bufferSize = size;
-	// Create semaphores
-	freeSlots = new QSemaphore(bufferSize);
-	usedSlots = new QSemaphore(0);
-	clearBuffer_add = new QSemaphore(1);
-	clearBuffer_get = new QSemaphore(1);
+	// Preallocate slots
+	slots.resize(bufferSize);
+	// Initialize indices and flags
+	head.value.store(0);
+	tail.value.store(0);
+	consumerWaiting.store(false);
+	producerWaiting.store(false);
+	clearEnd.store(0);
 }
 
 template<class T> void Buffer<T>::add(const T& data, bool dropIfFull)
 {
-	// Acquire semaphore
-	clearBuffer_add->acquire();
-	// If dropping is enabled, do not block if buffer is full
-	if (dropIfFull) {
-		// Try and acquire semaphore to add item
-		if (freeSlots->tryAcquire()) {
-			// Add item to queue
-			queueProtect.lock();
-			queue.enqueue(data);
-			queueProtect.unlock();
-			// Release semaphore
-			usedSlots->release();
-		}
+	size_t t = tail.value.load(std::memory_order_relaxed);
+	// Buffer is full
+	if (t - head.value.load(std::memory_order_acquire) >= (size_t)bufferSize) {
+		// If dropping is enabled, do not block
+		if (dropIfFull)
+			return;
+		// Wait for the consumer to free a slot
+		waitMutex.lock();
+		producerWaiting.store(true);
+		while (t - head.value.load() >= (size_t)bufferSize)
+			notFull.wait(&waitMutex, BUFFER_WAIT_TIMEOUT_MS);
+		producerWaiting.store(false);
+		waitMutex.unlock();
 	}
-	// If buffer is full, wait on semaphore
-	else{
-		// Acquire semaphore
-		freeSlots->acquire();
-		// Add item to queue
-		queueProtect.lock();
-		queue.enqueue(data);
-		queueProtect.unlock();
-		// Release semaphore
-		usedSlots->release();
+	// Add item to slot and publish it
+	slots[t % bufferSize] = data;
+	tail.value.store(t + 1);
+	// Wake consumer only if it is blocked
+	if (consumerWaiting.load()) {
+		waitMutex.lock();
+		notEmpty.wakeOne();
+		waitMutex.unlock();
 	}
-	// Release semaphore
-	clearBuffer_add->release();
 }
 
 template<class T> T Buffer<T>::get()
 {
 	// Local variable(s)
 	T data;
-	// Acquire semaphores
-	clearBuffer_get->acquire();
-	usedSlots->acquire();
-	// Take item from queue
-	queueProtect.lock();
-	data = queue.dequeue();
-	queueProtect.unlock();
-	// Release semaphores
-	freeSlots->release();
-	clearBuffer_get->release();
+	// Honour a pending clear() request
+	size_t end = clearEnd.exchange(0);
+	if (end != 0)
+		discardQueued(end - 1);
+	size_t h = head.value.load(std::memory_order_relaxed);
+	// Buffer is empty, wait for the producer
+	if (tail.value.load(std::memory_order_acquire) == h) {
+		waitMutex.lock();
+		consumerWaiting.store(true);
+		while (tail.value.load() == h)
+			notEmpty.wait(&waitMutex, BUFFER_WAIT_TIMEOUT_MS);
+		consumerWaiting.store(false);
+		waitMutex.unlock();
+	}
+	// Take item from slot, leave nothing referenced behind
+	data = std::move(slots[h % bufferSize]);
+	slots[h % bufferSize] = T();
+	head.value.store(h + 1);
+	// Wake producer only if it is blocked
+	if (producerWaiting.load()) {
+		waitMutex.lock();
+		notFull.wakeOne();
+		waitMutex.unlock();
+	}
 	// Return item to caller
 	return data;
 }
 
+template<class T> void Buffer<T>::discardQueued(size_t end)
+{
+	size_t h = head.value.load(std::memory_order_relaxed);
+	// Items may already have been consumed since clear() was called
+	if (end - h > (size_t)bufferSize)
+		return;
+	// Release all items that were queued when clear() was called
+	for (size_t i = h; i != end; i++)
+		slots[i % bufferSize] = T();
+	head.value.store(end);
+	// Wake producer only if it is blocked
+	if (producerWaiting.load()) {
+		waitMutex.lock();
+		notFull.wakeOne();
+		waitMutex.unlock();
+	}
+}
+
 template<class T> bool Buffer<T>::clear()
 {
 	// Check if buffer contains items
-	if (queue.size() > 0) {
-		// Stop adding items to buffer (will return false if an item is currently being added to the buffer)
-		if (clearBuffer_add->tryAcquire()) {
-			// Stop taking items from buffer (will return false if an item is currently being taken from the buffer)
-			if (clearBuffer_get->tryAcquire()) {
-				// Release all remaining slots in queue
-				freeSlots->release(queue.size());
-				// Acquire all queue slots
-				freeSlots->acquire(bufferSize);
-				// Reset usedSlots to zero
-				usedSlots->acquire(queue.size());
-				// Clear buffer
-				queue.clear();
-				// Release all slots
-				freeSlots->release(bufferSize);
-				// Allow get method to resume
-				clearBuffer_get->release();
-			}else
-				return false;
-			// Allow add method to resume
-			clearBuffer_add->release();
-			return true;
-		}else
-			return false;
+	if (size() > 0) {
+		// Only the consumer may touch the slots, so let the next get() drop everything queued by now
+		clearEnd.store(tail.value.load() + 1);
+		return true;
 	}else
 		return false;
 }
 
 template<class T> int Buffer<T>::size()
 {
-	return queue.size();
+	// Load head first: tail can only grow past it in the meantime
+	size_t h = head.value.load(std::memory_order_acquire);
+	size_t t = tail.value.load(std::memory_order_acquire);
+	return (int)std::min(t - h, (size_t)bufferSize);
 }
 
 template<class T> int Buffer<T>::maxSize()
@@ -157,12 +198,12 @@ template<class T> int Buffer<T>::maxSize()
 
 template<class T> bool Buffer<T>::isFull()
 {
-	return queue.size() == bufferSize;
+	return size() == bufferSize;
 }
 
 template<class T> bool Buffer<T>::isEmpty()
 {
-	return queue.size() == 0;
+	return size() == 0;
 }
 
 #endif // BUFFER_H
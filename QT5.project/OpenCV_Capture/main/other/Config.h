@@ -31,6 +31,18 @@
 
 // Image buffer size
 #define DEFAULT_IMAGE_BUFFER_SIZE           1
+// Frame slots in the capture pool on top of the image buffer size (frame in processing + frame being retrieved)
+#define FRAME_POOL_EXTRA_SLOTS              2
+// Native V4L2 capture with zero-copy driver buffers (Linux only, falls back to OpenCV VideoCapture)
+#define USE_V4L2_CAPTURE                    false
+// File used as fake V4L2 device if this environment variable is set (raw YUYV frames or concatenated JPEGs)
+#define V4L2_FAKE_DEVICE_ENV                "OPENCAP_V4L2_FAKE_DEVICE"
+// Driver buffers kept queued on top of the frames held by the image buffer and processing
+#define V4L2_QUEUED_BUFFERS                 2
+// GUI repaint tick, processed frames arriving faster are skipped (latest frame wins)
+#define DISPLAY_REFRESH_INTERVAL_MS         15
+// Show frames through an OpenGL texture (GLFrameView) instead of QLabel pixmaps
+#define USE_GL_FRAME_LABEL                  false
 // Drop frame if image/frame buffer is full
 #define DEFAULT_DROP_FRAMES                 false
 // Thread priorities
@@ -44,14 +56,39 @@
 #define DEFAULT_LAP_MAG_EXAGGERATION        2.0
 #define DEFAULT_LAP_MAG_LEVELS              4
 
+// Horizontal bands for the gray/flip/blur/dilate/erode prefix (-1: one per OpenCV worker thread, 0/1: serial)
+#define DEFAULT_TILE_BANDS                  -1
+// Minimum rows per band, keeps the halo rows a small overhead
+#define TILE_MIN_BAND_ROWS                  64
+// Number of frames the per-stage timing average roughly spans
+#define PIPELINE_TIMING_SMOOTHING           32
+// Grabcut: MOG2 background model runs at 1/N of the frame size, the mask is scaled back up
+#define DEFAULT_GRABCUT_DOWNSCALE           1
+// Color checker: frames between full-frame searches while tracking (0: always search the full frame)
+#define DEFAULT_COLORCHECKER_RESEARCH_INTERVAL 30
+// Color checker: padding around the last chart position, relative to its size
+#define COLORCHECKER_ROI_PADDING            0.25
+// Meanshift: window samples per frame, above it fewer convergence steps are run (0: off, the full 5 steps)
+#define DEFAULT_MEANSHIFT_SAMPLE_BUDGET     0
+
 // General Default on Startup
 #define DEFAULT_GRAYSCALE                   false
-#define DEFAULT_MAGNIFY_TYPE                0 // Options: [NONE=0,-1;COLOR=1;LAPLACE=2;RIESZ=3]
+#define DEFAULT_MAGNIFY_TYPE                0 // Options: [NONE=0,-1;COLOR=1;LAPLACE=2;RIESZ=3;WAVELET=4]
 #define DEFAULT_AMPLIFICATION               0
 #define DEFAULT_COWAVELENGTH                0
 #define DEFAULT_COLOW                       0.0
 #define DEFAULT_COHIGH                      0.0
 #define DEFAULT_CHROMATTENUATION            0
+// Riesz: pyramid filters as the sum of N separable SVD terms (0: dense 9x9, exact).
+// Selectable in MagnifyOptions, rank 3 keeps the worst case error below 0.0083 of full scale for ~2/3 of the dense cost
+#define DEFAULT_RIESZ_FILTER_RANK           0
+// Riesz: acos/cos/sin in the phase math [EXACT=0 (libm);PRECISE=1;FAST=2 (SIMD polynomials)]
+#define DEFAULT_RIESZ_TRIG_ACCURACY         1
+// Wavelet: shrinkage of the detail coefficients [NONE=0;HARD=1;SOFT=2;GARROT=3], threshold on a [0,1] luminance
+#define DEFAULT_WAVELET_SHRINK_TYPE         0
+#define DEFAULT_WAVELET_SHRINK_THRESHOLD    0.01
+// Storage of the temporal filter state (color window, lowpass pyramids) [FLOAT32=0;FLOAT16=1], computed in 32bit float. Selectable in MagnifyOptions
+#define DEFAULT_TEMPORAL_STORAGE            0
 // Default for Color Magnification
 #define DEFAULT_CM_AMPLIFICATION            100
 #define DEFAULT_CM_COWAVELENGTH             1000
@@ -0,0 +1,93 @@
+/************************************************************************************/
+/* An OpenCV/Qt based realtime application			                    */
+/*                                                                                  */
+/*                                                                                  */
+/* Based on the work of                                                             */
+/*      Joseph Pan      <https://github.com/wzpan/QtEVM>                            */
+/*      Nick D'Ademo    <https://github.com/nickdademo/qt-opencv-multithreaded>     */
+/*                                                                                  */
+/* other/FrameMailbox.h                                                             */
+/*                                                                                  */
+/* This program is free software: you can redistribute it and/or modify             */
+/* it under the terms of the GNU General Public License as published by             */
+/* the Free Software Foundation, either version 3 of the License, or                */
+/* (at your option) any later version.                                              */
+/*                                                                                  */
+/* This program is distributed in the hope that it will be useful,                  */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of                   */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    */
+/* GNU General Public License for more details.                                     */
+/*                                                                                  */
+/* You should have received a copy of the GNU General Public License                */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.            */
+/************************************************************************************/
+
+#ifndef FRAMEMAILBOX_H
+#define FRAMEMAILBOX_H
+
+// C++
+#include <atomic>
+// Qt
+#include <QImage>
+
+/*  FrameMailbox
+ *
+ *    Latest-frame-wins hand over from a processing thread to the GUI thread. put()
+ *    swaps the new frame into a single atomic slot, a frame that was still waiting
+ *    is dropped and counted as skipped. The GUI take()s on its own repaint tick, so
+ *    nothing queues up when the display is slower than the camera.
+ *
+ */
+class FrameMailbox
+{
+public:
+	FrameMailbox() : slot(NULL), skipped(0)
+	{
+	}
+
+	~FrameMailbox()
+	{
+		delete slot.exchange(NULL);
+	}
+
+	// Producer side: replace the waiting frame (if any)
+	void put(const QImage &frame)
+	{
+		QImage *previous = slot.exchange(new QImage(frame), std::memory_order_acq_rel);
+		if (previous != NULL) {
+			skipped.fetch_add(1, std::memory_order_relaxed);
+			delete previous;
+		}
+	}
+
+	// Consumer side: get the latest frame, false if nothing new arrived since the last call
+	bool take(QImage &frame)
+	{
+		QImage *latest = slot.exchange(NULL, std::memory_order_acq_rel);
+		if (latest == NULL)
+			return false;
+		frame = *latest;
+		delete latest;
+		return true;
+	}
+
+	// Frames overwritten before the consumer took them
+	int getSkipped()
+	{
+		return skipped.load(std::memory_order_relaxed);
+	}
+
+	void clear()
+	{
+		delete slot.exchange(NULL, std::memory_order_acq_rel);
+		skipped.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	FrameMailbox(const FrameMailbox&);
+	FrameMailbox& operator=(const FrameMailbox&);
+	std::atomic<QImage*> slot;
+	std::atomic<int> skipped;
+};
+
+#endif // FRAMEMAILBOX_H
@@ -0,0 +1,101 @@
+/************************************************************************************/
+/* An OpenCV/Qt based realtime application			                    */
+/*                                                                                  */
+/*                                                                                  */
+/* Based on the work of                                                             */
+/*      Joseph Pan      <https://github.com/wzpan/QtEVM>                            */
+/*      Nick D'Ademo    <https://github.com/nickdademo/qt-opencv-multithreaded>     */
+/*                                                                                  */
+/* other/FrameSlot.h                                                                */
+/*                                                                                  */
+/* This program is free software: you can redistribute it and/or modify             */
+/* it under the terms of the GNU General Public License as published by             */
+/* the Free Software Foundation, either version 3 of the License, or                */
+/* (at your option) any later version.                                              */
+/*                                                                                  */
+/* This program is distributed in the hope that it will be useful,                  */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of                   */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    */
+/* GNU General Public License for more details.                                     */
+/*                                                                                  */
+/* You should have received a copy of the GNU General Public License                */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.            */
+/************************************************************************************/
+
+#ifndef FRAMESLOT_H
+#define FRAMESLOT_H
+
+// C++
+#include <utility>
+
+/*  FrameSlot
+ *
+ *    Holds the one frame in flight between reading/magnifying and handing it on
+ *    inside a thread (not synchronized, the owner holds its own mutex). Frames are
+ *    moved in and out, so the per-frame path neither shifts a vector nor clones a
+ *    frame. push() refuses a second frame, the caller has to pop() first.
+ *
+ */
+template<class T> class FrameSlot
+{
+public:
+	FrameSlot() : filled(false)
+	{
+	}
+
+	bool push(const T& item)
+	{
+		if (filled)
+			return false;
+		slot = item;
+		filled = true;
+		return true;
+	}
+
+	bool push(T&& item)
+	{
+		if (filled)
+			return false;
+		slot = std::move(item);
+		filled = true;
+		return true;
+	}
+
+	// Move the frame out, leave nothing referenced behind
+	bool pop(T& item)
+	{
+		if (!filled)
+			return false;
+		item = std::move(slot);
+		slot = T();
+		filled = false;
+		return true;
+	}
+
+	void clear()
+	{
+		slot = T();
+		filled = false;
+	}
+
+	int size()
+	{
+		return filled ? 1 : 0;
+	}
+
+	bool isEmpty()
+	{
+		return !filled;
+	}
+
+	bool isFull()
+	{
+		return filled;
+	}
+
+private:
+	T slot;
+	bool filled;
+};
+
+#endif // FRAMESLOT_H
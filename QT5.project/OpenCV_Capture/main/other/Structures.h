@@ -27,13 +27,15 @@
 
 // Qt
 #include <QtCore/QRect>
+// Local
+#include "main/other/Config.h"
 
 struct ImageProcessingSettings {
-	//double amplification;
-	//double coWavelength;
-	//double coLow;
-	//double coHigh;
-	//double chromAttenuation;
+	double amplification;
+	double coWavelength;
+	double coLow;
+	double coHigh;
+	double chromAttenuation;
 	int frameWidth;
 	int frameHeight;
 	double framerate;
@@ -58,16 +60,35 @@ struct ImageProcessingSettings {
 	int cannyApertureSize;
 	bool cannyL2gradient;
 
+	int tileBands; //-1:Auto 0/1:Serial N:Bands for the gray/flip/blur/dilate/erode prefix
+	int colorcheckerResearchInterval; //frames between full-frame chart searches, 0:always
+	int grabcutDownscale; //MOG2 background model at 1/N resolution
+	double meanshiftSampleBudget; //window samples per frame for meanshift filtering, 0:Unlimited
+	int rieszFilterRank; //0:Dense 9x9 N:Separable SVD terms for the riesz pyramid filters
+	int rieszTrigAccuracy; //0:Exact 1:Precise 2:Fast acos/cos/sin for the riesz phase math
+	int waveletShrinkType; //0:None 1:Hard 2:Soft 3:Garrot
+	double waveletShrinkThreshold; //relative to a [0,1] luminance
+	int temporalStorage; //0:Float32 1:Float16 for the temporal filter state of color/laplace/wavelet magnification
+
 	ImageProcessingSettings() :
-	//amplification(0.0),
-	//coWavelength(0.0),
-	//coLow(0.1),
-	//coHigh(0.4),
-	//chromAttenuation(0.0),
+	amplification(0.0),
+	coWavelength(0.0),
+	coLow(0.1),
+	coHigh(0.4),
+	chromAttenuation(0.0),
 	frameWidth(0),
 	frameHeight(0),
 	framerate(0.0),
-	levels(4)
+	levels(4),
+	tileBands(DEFAULT_TILE_BANDS),
+	colorcheckerResearchInterval(DEFAULT_COLORCHECKER_RESEARCH_INTERVAL),
+	grabcutDownscale(DEFAULT_GRABCUT_DOWNSCALE),
+	meanshiftSampleBudget(DEFAULT_MEANSHIFT_SAMPLE_BUDGET),
+	rieszFilterRank(DEFAULT_RIESZ_FILTER_RANK),
+	rieszTrigAccuracy(DEFAULT_RIESZ_TRIG_ACCURACY),
+	waveletShrinkType(DEFAULT_WAVELET_SHRINK_TYPE),
+	waveletShrinkThreshold(DEFAULT_WAVELET_SHRINK_THRESHOLD),
+	temporalStorage(DEFAULT_TEMPORAL_STORAGE)
 	{
 	}
 };
@@ -86,7 +107,12 @@ struct ImageProcessingFlags {
 	bool colorcheckerOn;
 	bool grabcutOn;
 	bool meanshiftOn;
+	bool meanshiftSegmentOn;
 	bool cartoonOn;
+	bool colorMagnifyOn;
+	bool laplaceMagnifyOn;
+	bool rieszMagnifyOn;
+	bool waveletMagnifyOn;
 
 	ImageProcessingFlags() :
 		grayscaleOn(false),
@@ -102,7 +128,12 @@ struct ImageProcessingFlags {
 		colorcheckerOn(false),
 		grabcutOn(false),
 		meanshiftOn(false),
-		cartoonOn(false)
+		meanshiftSegmentOn(false),
+		cartoonOn(false),
+		colorMagnifyOn(false),
+		laplaceMagnifyOn(false),
+		rieszMagnifyOn(false),
+		waveletMagnifyOn(false)
 	{
 	}
 };
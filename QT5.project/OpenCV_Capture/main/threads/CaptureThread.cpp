@@ -26,7 +26,8 @@
 
 CaptureThread::CaptureThread(SharedImageBuffer *sharedImageBuffer, int deviceNumber,
                              bool dropFrameIfBufferFull, int width, int height, int fpsLimit)
-        : QThread(), sharedImageBuffer(sharedImageBuffer)
+        : QThread(), sharedImageBuffer(sharedImageBuffer),
+	  framePool(sharedImageBuffer->getByDeviceNumber(deviceNumber)->maxSize() + FRAME_POOL_EXTRA_SLOTS)
 {
 	// Save passed parameters
 	this->dropFrameIfBufferFull = dropFrameIfBufferFull;
@@ -64,14 +65,25 @@ void CaptureThread::run()
 		// Start timer (used to calculate capture rate)
 		t.start();
 
-		// Capture frame (if available)
-		if (!cap.grab())
-			continue;
-		// Retrieve frame
-		cap.retrieve(grabbedFrame);
-
-		// Add frame to buffer
-		sharedImageBuffer->getByDeviceNumber(deviceNumber)->add(grabbedFrame, dropFrameIfBufferFull);
+		if (v4l2Cap.isOpened()) {
+			// Capture raw frame wrapping the driver buffer (requeued once processing releases it)
+			Mat rawFrame;
+			if (!v4l2Cap.grab() || !v4l2Cap.retrieve(rawFrame))
+				continue;
+			// Add frame to buffer
+			sharedImageBuffer->getByDeviceNumber(deviceNumber)->add(rawFrame, dropFrameIfBufferFull);
+		}else {
+			// Capture frame (if available)
+			if (!cap.grab())
+				continue;
+			// Retrieve frame straight into a free pool slot
+			Mat &grabbedFrame = framePool.acquire();
+			if (!cap.retrieve(grabbedFrame))
+				continue;
+
+			// Add frame to buffer (shares the slot, no copy)
+			sharedImageBuffer->getByDeviceNumber(deviceNumber)->add(grabbedFrame, dropFrameIfBufferFull);
+		}
 
 		// Update statistics
 		updateFPS(captureTime);
@@ -79,13 +91,23 @@ void CaptureThread::run()
 		// Inform GUI of updated statistics
 		emit updateStatisticsInGUI(statsData);
 	}
-	qDebug() << "Stopping capture thread...";
+	qDebug() << "Stopping capture thread..." << framePool.getMisses() << "frame pool misses";
 }
 
 bool CaptureThread::connectToCamera()
 {
 	// Open camera
 #if defined(Q_OS_LINUX)
+	// Native V4L2 backend if enabled, or a fake device given for testing
+	QByteArray fakeDevice = qgetenv(V4L2_FAKE_DEVICE_ENV);
+	if (USE_V4L2_CAPTURE || !fakeDevice.isEmpty()) {
+		int nBuffers = sharedImageBuffer->getByDeviceNumber(deviceNumber)->maxSize() + FRAME_POOL_EXTRA_SLOTS + V4L2_QUEUED_BUFFERS;
+		bool v4l2OpenResult = fakeDevice.isEmpty() ? v4l2Cap.open(deviceNumber, width, height, fpsGoal, nBuffers)
+							   : v4l2Cap.open(fakeDevice.toStdString(), width, height, fpsGoal, nBuffers);
+		if (v4l2OpenResult)
+			return true;
+		qDebug() << "V4L2 capture failed, falling back to VideoCapture";
+	}
 	//Using Linux V4L as capture device
 	bool camOpenResult = cap.open(deviceNumber, cv::CAP_V4L);
 #else
@@ -105,8 +127,13 @@ bool CaptureThread::connectToCamera()
 
 bool CaptureThread::disconnectCamera()
 {
+	// Native V4L2 device is connected
+	if (v4l2Cap.isOpened()) {
+		v4l2Cap.release();
+		return true;
+	}
 	// Camera is connected
-	if (cap.isOpened()) {
+	else if (cap.isOpened()) {
 		// Disconnect camera
 		cap.release();
 		return true;
@@ -154,19 +181,29 @@ void CaptureThread::stop()
 
 bool CaptureThread::isCameraConnected()
 {
-	return cap.isOpened();
+	return v4l2Cap.isOpened() || cap.isOpened();
 }
 
 int CaptureThread::getInputSourceWidth()
 {
+	if (v4l2Cap.isOpened())
+		return v4l2Cap.getWidth();
 	return cap.get(cv::CAP_PROP_FRAME_WIDTH);
 }
 
 int CaptureThread::getInputSourceHeight()
 {
+	if (v4l2Cap.isOpened())
+		return v4l2Cap.getHeight();
 	return cap.get(cv::CAP_PROP_FRAME_HEIGHT);
 }
 
+unsigned int CaptureThread::getInputPixelFormat()
+{
+	// Raw frames from the native V4L2 backend still need conversion, VideoCapture delivers BGR
+	return v4l2Cap.isOpened() ? v4l2Cap.getPixelFormat() : 0;
+}
+
 VideoCapture CaptureThread::getCap()
 {
 	return cap;
@@ -32,6 +32,8 @@
 #include <opencv2/highgui/highgui.hpp>
 // Local
 #include "main/helper/SharedImageBuffer.h"
+#include "main/helper/FramePool.h"
+#include "main/helper/V4L2Capture.h"
 #include "main/other/Config.h"
 #include "main/other/Structures.h"
 
@@ -53,12 +55,14 @@ public:
 	int getInputSourceWidth();
 	int getInputSourceHeight();
 	VideoCapture getCap();
+	unsigned int getInputPixelFormat();
 
 private:
 	void updateFPS(int);
 	SharedImageBuffer *sharedImageBuffer;
 	VideoCapture cap;
-	Mat grabbedFrame;
+	V4L2Capture v4l2Cap;
+	FramePool framePool;
 	QTime t;
 	QMutex doStopMutex;
 	QQueue<int> fps;
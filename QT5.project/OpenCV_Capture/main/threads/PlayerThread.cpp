@@ -40,8 +40,7 @@ PlayerThread::PlayerThread(const std::string filepath, int width, int height, do
 	statsData.averageVidProcessingFPS = 0;
 	statsData.nFramesProcessed = 0;
 
-	originalBuffer = std::vector<Mat>();
-	processingBuffer = std::vector<Mat>();
+	processingBufferLength = 1;
 
 	imgPlayerSettings.framerate = fps;
 
@@ -49,7 +48,6 @@ PlayerThread::PlayerThread(const std::string filepath, int width, int height, do
 	fpsSum = 0;
 	fpsQueue.clear();
 
-	//this->magnificator = Magnificator(&processingBuffer, &imgProcFlags, &imgProcSettings);
 	this->cap = VideoCapture();
 	currentWriteIndex = 0;
 }
@@ -105,41 +103,34 @@ void PlayerThread::run()
 		// Start timer and capture time needed to process 1 frame here
 		if (getCurrentReadIndex() == processingBufferLength - 1)
 			mTime.start();
-		// Switch to process images on the fly instead of processing a whole buffer, reducing MEM
-		//if(imgProcFlags.colorMagnifyOn && processingBufferLength > 2 && magnificator.getBufferSize() > 2) {
-		//if (imgProcFlags.colorMagnifyOn && processingBufferLength > 2) {
-		//	processingBufferLength = 2;
-		//}
-
-
 
 		///////////////////////////////////
 		/////////// Capturing ////////////
 		/////////////////////////////////
-		// Fill buffer, check if it's the start of magnification or not
+		// Fill buffer, magnification streams frame by frame inside the pipeline
 		for (int i = processingBuffer.size(); i < processingBufferLength && getCurrentFramenumber() < lengthInFrames; i++) {
 			processingMutex.lock();
 
 			// Try to grab the next Frame
 			if (cap.read(grabbedFrame)) {
 				// Preprocessing
-				// Set ROI of frame
-				currentFrame = Mat(grabbedFrame.clone(), currentROI);
+				// Set ROI of frame (the next read refills grabbedFrame, so no copy is needed)
+				currentFrame = Mat(grabbedFrame, currentROI);
+				if (emitOriginal)
+					originalBuffer.push(currentFrame.clone());
 
 				/////////////////////////////////// //
 				//  PERFORM IMAGE PROCESSING BELOW  //
 				/////////////////////////////////// //
 
-				cvProcessFrame(&currentFrame, imgProcFlags, imgPlayerSettings);
+				pipeline.process(&currentFrame);
 
 				/////////////////////////////////// //
 				//  PERFORM IMAGE PROCESSING ABOVE  //
 				/////////////////////////////////// //
 
-				// Fill fuffer
-				processingBuffer.push_back(currentFrame);
-				if (emitOriginal)
-					originalBuffer.push_back(currentFrame.clone());
+				// Fill fuffer, the frame is moved in
+				processingBuffer.push(std::move(currentFrame));
 			}
 			// Wasn't able to grab frame, abort thread
 			else {
@@ -156,40 +147,21 @@ void PlayerThread::run()
 		}
 
 		///////////////////////////////////
-		/////////// Magnifying ///////////
+		/////////// Reading //////////////
 		/////////////////////////////////
 		processingMutex.lock();
-/*
-        if (imgProcFlags.colorMagnifyOn) {
-            magnificator.colorMagnify();
-            if (magnificator.hasFrame()) {
-                currentFrame = magnificator.getFrameFirst();
-            }
-        }else if (imgProcFlags.laplaceMagnifyOn) {
-            magnificator.laplaceMagnify();
-            if (magnificator.hasFrame()) {
-                currentFrame = magnificator.getFrameFirst();
-            }
-        }else if (imgProcFlags.rieszMagnifyOn) {
-            magnificator.rieszMagnify();
-            if (magnificator.hasFrame()) {
-                currentFrame = magnificator.getFrameFirst();
-            }
-        }else*/{
-                        // Read frames unmagnified
-                        currentFrame = processingBuffer.at(getCurrentReadIndex());
-                        // Erase to keep buffer size
-                        processingBuffer.erase(processingBuffer.begin());
-                }
-                // Increase number of frames given to GUI
-                currentWriteIndex++;
-
-		frame = MatToQImage(currentFrame);
-		if (emitOriginal) {
-			originalFrame = MatToQImage(originalBuffer.front());
-			if (!originalBuffer.empty())
-				originalBuffer.erase(originalBuffer.begin());
-		}
+		// Frames are already magnified by the pipeline, move the frame out of the slot
+		processingBuffer.pop(currentFrame);
+		// currentFrame is moved into the slot while filling, keep the shown one for snapshots
+		shownFrame = currentFrame;
+		// Increase number of frames given to GUI
+		currentWriteIndex++;
+
+		// Display sized QImage, currentFrame stays full resolution
+		frame = MatToQImage(currentFrame, displaySize, displayFrame);
+		Mat original;
+		if (emitOriginal && originalBuffer.pop(original))
+			originalFrame = MatToQImage(original, displaySize, displayFrame);
 
 		processingMutex.unlock();
 
@@ -226,6 +198,26 @@ double PlayerThread::getFPS()
 	return fps;
 }
 
+vector<StageTiming> PlayerThread::getStageTimings()
+{
+	QMutexLocker locker(&processingMutex);
+	return pipeline.getStageTimings();
+}
+
+// Copy of the last shown frame in full (ROI) resolution, for snapshots
+bool PlayerThread::getCurrentFrame(Mat &frame)
+{
+	QMutexLocker locker(&processingMutex);
+	shownFrame.copyTo(frame);
+	return !frame.empty();
+}
+
+MagnifyCounters PlayerThread::getMagnifyCounters(int mode)
+{
+	QMutexLocker locker(&processingMutex);
+	return pipeline.getMagnifyCounters(mode);
+}
+
 void PlayerThread::getOriginalFrame(bool doEmit)
 {
 	QMutexLocker locker1(&doStopMutex);
@@ -330,6 +322,12 @@ int PlayerThread::getInputSourceHeight()
 	return imgPlayerSettings.frameHeight;
 }
 
+void PlayerThread::setDisplaySize(QSize size)
+{
+	QMutexLocker locker(&processingMutex);
+	displaySize = size;
+}
+
 void PlayerThread::setROI(QRect roi)
 {
 	QMutexLocker locker1(&doStopMutex);
@@ -338,12 +336,13 @@ void PlayerThread::setROI(QRect roi)
 	currentROI.y = roi.y();
 	currentROI.width = roi.width();
 	currentROI.height = roi.height();
-	//int levels = magnificator.calculateMaxLevels(roi);
-	//magnificator.clearBuffer();
+	// Background model, tracking and magnification state belong to the old ROI
+	pipeline.reset();
+	int levels = Magnificator::calculateMaxLevels(roi);
 	locker1.unlock();
 	locker2.unlock();
 	setBufferSize();
-	//emit maxLevels(levels);
+	emit maxLevels(levels);
 }
 
 QRect PlayerThread::getCurrentROI()
@@ -371,10 +370,18 @@ void PlayerThread::updateImageProcessingFlags(struct ImageProcessingFlags flags)
 	this->imgProcFlags.colorcheckerOn = flags.colorcheckerOn;
 	this->imgProcFlags.grabcutOn = flags.grabcutOn;
 	this->imgProcFlags.meanshiftOn = flags.meanshiftOn;
+	this->imgProcFlags.meanshiftSegmentOn = flags.meanshiftSegmentOn;
 	this->imgProcFlags.cartoonOn = flags.cartoonOn;
+	this->imgProcFlags.colorMagnifyOn = flags.colorMagnifyOn;
+	this->imgProcFlags.laplaceMagnifyOn = flags.laplaceMagnifyOn;
+	this->imgProcFlags.rieszMagnifyOn = flags.rieszMagnifyOn;
+	this->imgProcFlags.waveletMagnifyOn = flags.waveletMagnifyOn;
 
 	//qDebug() << this->imgProcFlags.hsvHistogramOn;
 
+	// Rebuild processing plan
+	pipeline.update(imgProcFlags, imgPlayerSettings);
+
 	locker1.unlock();
 	locker2.unlock();
 
@@ -408,15 +415,28 @@ void PlayerThread::updateProcessingSettings(struct ImageProcessingSettings setti
 	imgPlayerSettings.cannyThreshold2 = settings.cannyThreshold2;
 	imgPlayerSettings.cannyApertureSize = settings.cannyApertureSize;
 	imgPlayerSettings.cannyL2gradient = settings.cannyL2gradient;
+
+	imgPlayerSettings.tileBands = settings.tileBands;
+	imgPlayerSettings.colorcheckerResearchInterval = settings.colorcheckerResearchInterval;
+	imgPlayerSettings.grabcutDownscale = settings.grabcutDownscale;
+	imgPlayerSettings.meanshiftSampleBudget = settings.meanshiftSampleBudget;
+	imgPlayerSettings.rieszFilterRank = settings.rieszFilterRank;
+	imgPlayerSettings.rieszTrigAccuracy = settings.rieszTrigAccuracy;
+	imgPlayerSettings.waveletShrinkType = settings.waveletShrinkType;
+	imgPlayerSettings.waveletShrinkThreshold = settings.waveletShrinkThreshold;
+	imgPlayerSettings.temporalStorage = settings.temporalStorage;
 	//qDebug() << "player updateSettings:" << settings.cannyApertureSize << settings.cannyL2gradient;
 
-	//imgPlayerSettings.amplification = imgProcessingSettings.amplification;
-	//imgPlayerSettings.coWavelength = imgProcessingSettings.coWavelength;
-	//imgPlayerSettings.coLow = imgProcessingSettings.coLow;
-	//imgPlayerSettings.coHigh = imgProcessingSettings.coHigh;
-	//imgPlayerSettings.chromAttenuation = imgProcessingSettings.chromAttenuation;
+	imgPlayerSettings.amplification = settings.amplification;
+	imgPlayerSettings.coWavelength = settings.coWavelength;
+	imgPlayerSettings.coLow = settings.coLow;
+	imgPlayerSettings.coHigh = settings.coHigh;
+	imgPlayerSettings.chromAttenuation = settings.chromAttenuation;
 	imgPlayerSettings.levels = settings.levels;
 
+	// Rebuild processing plan
+	pipeline.update(imgProcFlags, imgPlayerSettings);
+
 	if (resetBuffer) {
 		locker1.unlock();
 		locker2.unlock();
@@ -535,15 +555,15 @@ void PlayerThread::updateFPS(int timeElapsed)
 	}
 }
 
-// Magnificator
+// Buffering
 void PlayerThread::fillProcessingBuffer()
 {
-	processingBuffer.push_back(currentFrame);
+	processingBuffer.push(currentFrame);
 }
 
 bool PlayerThread::processingBufferFilled()
 {
-	return(processingBuffer.size() == processingBufferLength);
+	return processingBuffer.isFull();
 }
 
 void PlayerThread::setBufferSize()
@@ -553,17 +573,8 @@ void PlayerThread::setBufferSize()
 
 	processingBuffer.clear();
 	originalBuffer.clear();
-	//magnificator.clearBuffer();
-/*
-    if (imgProcFlags.colorMagnifyOn) {
-        processingBufferLength = magnificator.getOptimalBufferSize(imgProcSettings.framerate);
-    }else if (imgProcFlags.laplaceMagnifyOn) {
-        processingBufferLength = 2;
-    }else if (imgProcFlags.rieszMagnifyOn) {
-        processingBufferLength = 2;
-    }else */{
-                processingBufferLength = 1;
-        }
+	// Magnification keeps its own temporal state, one frame in flight is enough
+	processingBufferLength = 1;
 
 	if (cap.isOpened() || !doStop)
 		cap.set(cv::CAP_PROP_POS_FRAMES, std::max(currentWriteIndex - processingBufferLength, 0));
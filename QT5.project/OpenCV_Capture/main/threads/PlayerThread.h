@@ -40,9 +40,11 @@
 // Local
 #include "main/other/Config.h"
 #include "main/other/Structures.h"
+#include "main/other/FrameSlot.h"
 #include "main/helper/MatToQImage.h"
-//#include "main/magnification/Magnificator.h"
+#include "main/magnification/Magnificator.h"
 #include "main/helper/_ProcessingFrame.h"
+#include "main/helper/ProcessingPipeline.h"
 
 using namespace cv;
 
@@ -77,6 +79,9 @@ public:
 	double getInputTimeLength();
 	double getFPS();
 	void getOriginalFrame(bool doEmit);
+	vector<StageTiming> getStageTimings();
+	MagnifyCounters getMagnifyCounters(int mode);
+	bool getCurrentFrame(Mat &frame);
 
 private:
 	QMutex doStopMutex;
@@ -91,7 +96,7 @@ private:
 	int playedTime;
 	int width;
 	int height;
-	std::vector<Mat> originalBuffer;
+	FrameSlot<Mat> originalBuffer;
 	void setBufferSize();
 	// Process
 	// This is the current Framenr that is grabbed from magnificator is always
@@ -100,8 +105,11 @@ private:
 	double fps;
 	void updateFPS(int timeElapsed);
 	Mat currentFrame;
+	Mat shownFrame;
 	Rect currentROI;
 	QImage frame;
+	QSize displaySize;
+	Mat displayFrame;
 	QImage originalFrame;
 	// processing measurement
 	QTime t;
@@ -114,17 +122,17 @@ private:
 	Point framePoint;
 	struct ImageProcessingFlags imgProcFlags;
 	struct ImageProcessingSettings imgPlayerSettings;
+	ProcessingPipeline pipeline;
 	// Player variables
 	volatile bool doStop;
 	volatile bool doPause;
 	volatile bool doPlay;
 	bool emitOriginal;
 	void endOfFrame_action();
-	// Magnifying
+	// Buffering
 	bool processingBufferFilled();
 	void fillProcessingBuffer();
-	//Magnificator magnificator;
-	std::vector<Mat> processingBuffer;
+	FrameSlot<Mat> processingBuffer;
 	int processingBufferLength;
 
 
@@ -137,6 +145,9 @@ private slots:
 	void setROI(QRect roi);
 	void pauseThread();
 
+public slots:
+	void setDisplaySize(QSize size);
+
 signals:
 	void updateStatisticsInGUI(struct ThreadStatisticsData);
 	void newFrame(const QImage &frame);
@@ -40,9 +40,8 @@ ProcessingThread::ProcessingThread(SharedImageBuffer *sharedImageBuffer, int dev
 	statsData.averageFPS = 0;
 	statsData.nFramesProcessed = 0;
 	captureOriginal = false;
+	inputPixelFormat = 0;
 
-	this->processingBufferLength = 2;
-	//this->magnificator = Magnificator(&processingBuffer, &imgProcFlags, &imgProcSettings);
 	this->output = VideoWriter();
 }
 
@@ -54,7 +53,6 @@ ProcessingThread::~ProcessingThread()
 	if (releaseCapture())
 		qDebug() << "Released Capture";
 
-	processingBuffer.clear();
 	doStopMutex.unlock();
 	wait();
 }
@@ -97,7 +95,21 @@ void ProcessingThread::run()
 
 		processingMutex.lock();
 		// Get frame from queue, store in currentFrame, set ROI
-		currentFrame = Mat(sharedImageBuffer->getByDeviceNumber(deviceNumber)->get().clone(), currentROI);
+		// (the pool slot is owned by this thread until currentFrame is replaced, so no copy is needed)
+		Mat grabbedFrame = sharedImageBuffer->getByDeviceNumber(deviceNumber)->get();
+		// Raw V4L2 frames are converted here, which also hands the driver buffer back
+		if (inputPixelFormat != 0) {
+			bool converted = V4L2Capture::convertToBGR(grabbedFrame, convertedFrame, inputPixelFormat);
+			grabbedFrame = convertedFrame;
+			// Corrupt MJPEG data or a frame of another size: skip it
+			if (!converted || grabbedFrame.cols < currentROI.x + currentROI.width
+					|| grabbedFrame.rows < currentROI.y + currentROI.height) {
+				grabbedFrame.release();
+				processingMutex.unlock();
+				continue;
+			}
+		}
+		currentFrame = Mat(grabbedFrame, currentROI);
 		if (emitOriginal || captureOriginal)
 			originalFrame = currentFrame.clone();
 
@@ -105,14 +117,17 @@ void ProcessingThread::run()
 		//  PERFORM IMAGE PROCESSING BELOW  //
 		/////////////////////////////////// //
 
-		cvProcessFrame(&currentFrame, imgProcFlags, imgProcSettings);
+		pipeline.process(&currentFrame);
 
 		////////////////////////// ///////// //
 		// PERFORM IMAGE PROCESSING ABOVE //
 		////////////////////////// ///////// //
 
-		// Convert Mat to QImage
-		frame = MatToQImage(currentFrame);
+		// Convert Mat to display sized QImage (only the emitted one is converted),
+		// currentFrame stays full resolution for recording
+		QSize frameDisplaySize = displaySize;
+		if (!emitOriginal)
+			frame = MatToQImage(currentFrame, frameDisplaySize, displayFrame);
 
 		processingMutex.unlock();
 
@@ -135,13 +150,12 @@ void ProcessingThread::run()
 			}
 		}
 
-		// Emit the original image before frame processing
+		// Hand the original image before frame processing to the GUI
 		if (emitOriginal)
-			emit origFrame(MatToQImage(originalFrame));
+			originalFrameMailbox.put(MatToQImage(originalFrame, frameDisplaySize, displayFrame));
 		else
-			// Inform GUI thread of new frame (QImage)
-			emit newFrame(frame);
-		//emit newFrame(MatToQImage(currentFrame));
+			// Hand the new frame to the GUI (it is pulled on the GUI repaint tick)
+			frameMailbox.put(frame);
 
 		// Update statistics
 		updateFPS(processingTime);
@@ -152,14 +166,45 @@ void ProcessingThread::run()
 	qDebug() << "Stopping processing thread...";
 }
 
-void ProcessingThread::fillProcessingBuffer()
+void ProcessingThread::setInputPixelFormat(unsigned int pixelFormat)
+{
+	QMutexLocker locker(&processingMutex);
+	inputPixelFormat = pixelFormat;
+}
+
+vector<StageTiming> ProcessingThread::getStageTimings()
+{
+	QMutexLocker locker(&processingMutex);
+	return pipeline.getStageTimings();
+}
+
+MagnifyCounters ProcessingThread::getMagnifyCounters(int mode)
+{
+	QMutexLocker locker(&processingMutex);
+	return pipeline.getMagnifyCounters(mode);
+}
+
+bool ProcessingThread::takeFrame(QImage &frame)
 {
-	processingBuffer.push_back(currentFrame);
+	return frameMailbox.take(frame);
 }
 
-bool ProcessingThread::processingBufferFilled()
+bool ProcessingThread::takeOriginalFrame(QImage &frame)
 {
-	return(processingBuffer.size() == processingBufferLength && processingBuffer.size() > 0);
+	return originalFrameMailbox.take(frame);
+}
+
+// Copy of the last processed frame in full (ROI) resolution, for snapshots
+bool ProcessingThread::getCurrentFrame(Mat &frame)
+{
+	QMutexLocker locker(&processingMutex);
+	currentFrame.copyTo(frame);
+	return !frame.empty();
+}
+
+int ProcessingThread::getSkippedFrames()
+{
+	return frameMailbox.getSkipped() + originalFrameMailbox.getSkipped();
 }
 
 void ProcessingThread::getOriginalFrame(bool doEmit)
@@ -202,9 +247,11 @@ void ProcessingThread::updateFPS(int timeElapsed)
 		// Reset sample number
 		sampleNumber = 0;
 
-		// save new fps in settings and inform magnification thread about it
+		// save new fps in settings and inform magnification about it
 		// (this is important for fps based color magnification)
+		QMutexLocker locker(&processingMutex);
 		imgProcSettings.framerate = statsData.averageFPS;
+		pipeline.update(imgProcFlags, imgProcSettings);
 	}
 }
 
@@ -233,10 +280,15 @@ void ProcessingThread::updateImageProcessingFlags(struct ImageProcessingFlags fl
 	this->imgProcFlags.colorcheckerOn = flags.colorcheckerOn;
 	this->imgProcFlags.grabcutOn = flags.grabcutOn;
 	this->imgProcFlags.meanshiftOn = flags.meanshiftOn;
+	this->imgProcFlags.meanshiftSegmentOn = flags.meanshiftSegmentOn;
 	this->imgProcFlags.cartoonOn = flags.cartoonOn;
+	this->imgProcFlags.colorMagnifyOn = flags.colorMagnifyOn;
+	this->imgProcFlags.laplaceMagnifyOn = flags.laplaceMagnifyOn;
+	this->imgProcFlags.rieszMagnifyOn = flags.rieszMagnifyOn;
+	this->imgProcFlags.waveletMagnifyOn = flags.waveletMagnifyOn;
 
-	processingBuffer.clear();
-	//magnificator.clearBuffer();
+	// Rebuild processing plan
+	pipeline.update(imgProcFlags, imgProcSettings);
 }
 
 void ProcessingThread::updateProcessingSettings(struct ImageProcessingSettings settings)
@@ -256,18 +308,33 @@ void ProcessingThread::updateProcessingSettings(struct ImageProcessingSettings s
 	this->imgProcSettings.cannyL2gradient = settings.cannyL2gradient;
 
 	this->imgProcSettings.flipcode = settings.flipcode;
+	this->imgProcSettings.tileBands = settings.tileBands;
+	this->imgProcSettings.colorcheckerResearchInterval = settings.colorcheckerResearchInterval;
+	this->imgProcSettings.grabcutDownscale = settings.grabcutDownscale;
+	this->imgProcSettings.meanshiftSampleBudget = settings.meanshiftSampleBudget;
+	this->imgProcSettings.rieszFilterRank = settings.rieszFilterRank;
+	this->imgProcSettings.rieszTrigAccuracy = settings.rieszTrigAccuracy;
+	this->imgProcSettings.waveletShrinkType = settings.waveletShrinkType;
+	this->imgProcSettings.waveletShrinkThreshold = settings.waveletShrinkThreshold;
+	this->imgProcSettings.temporalStorage = settings.temporalStorage;
 	//qDebug() << "flipcode" << imgProcSettings.flipcode;
 
-	//this->imgProcSettings.amplification = imgProcessingSettings.amplification;
-	//this->imgProcSettings.coWavelength = imgProcessingSettings.coWavelength;
-	//this->imgProcSettings.coLow = imgProcessingSettings.coLow;
-	//this->imgProcSettings.coHigh = imgProcessingSettings.coHigh;
-	//this->imgProcSettings.chromAttenuation = imgProcessingSettings.chromAttenuation;
-	if (this->imgProcSettings.levels != settings.levels) {
-		processingBuffer.clear();
-		//magnificator.clearBuffer();
-	}
+	this->imgProcSettings.amplification = settings.amplification;
+	this->imgProcSettings.coWavelength = settings.coWavelength;
+	this->imgProcSettings.coLow = settings.coLow;
+	this->imgProcSettings.coHigh = settings.coHigh;
+	this->imgProcSettings.chromAttenuation = settings.chromAttenuation;
+	// Magnification drops its filter state itself when the levels change
 	this->imgProcSettings.levels = settings.levels;
+
+	// Rebuild processing plan
+	pipeline.update(imgProcFlags, imgProcSettings);
+}
+
+void ProcessingThread::setDisplaySize(QSize size)
+{
+	QMutexLocker locker(&processingMutex);
+	displaySize = size;
 }
 
 void ProcessingThread::setROI(QRect roi)
@@ -277,11 +344,11 @@ void ProcessingThread::setROI(QRect roi)
 	currentROI.y = roi.y();
 	currentROI.width = roi.width();
 	currentROI.height = roi.height();
-	processingBuffer.clear();
-	//agnificator.clearBuffer();
-	//int levels = 1;//magnificator.calculateMaxLevels(roi);
+	// Background model, tracking and magnification state belong to the old ROI
+	pipeline.reset();
+	int levels = Magnificator::calculateMaxLevels(roi);
 	locker.unlock();
-	//emit maxLevels(levels);
+	emit maxLevels(levels);
 }
 
 QRect ProcessingThread::getCurrentROI()
@@ -351,5 +418,7 @@ Mat ProcessingThread::combineFrames(Mat &frame1, Mat &frame2)
 
 void ProcessingThread::updateFramerate(double fps)
 {
+	QMutexLocker locker(&processingMutex);
 	imgProcSettings.framerate = fps;
+	pipeline.update(imgProcFlags, imgProcSettings);
 }
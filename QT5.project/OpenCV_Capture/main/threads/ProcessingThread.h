@@ -37,10 +37,13 @@
 #include "main/other/Structures.h"
 #include "main/other/Config.h"
 #include "main/other/Buffer.h"
+#include "main/other/FrameMailbox.h"
 #include "main/helper/MatToQImage.h"
 #include "main/helper/SharedImageBuffer.h"
-//#include "main/magnification/Magnificator.h"
+#include "main/helper/V4L2Capture.h"
+#include "main/magnification/Magnificator.h"
 #include "main/helper/_ProcessingFrame.h"
+#include "main/helper/ProcessingPipeline.h"
 
 using namespace cv;
 
@@ -54,6 +57,13 @@ public:
 	bool releaseCapture();
 	QRect getCurrentROI();
 	void stop();
+	void setInputPixelFormat(unsigned int pixelFormat);
+	vector<StageTiming> getStageTimings();
+	MagnifyCounters getMagnifyCounters(int mode);
+	bool takeFrame(QImage &frame);
+	bool takeOriginalFrame(QImage &frame);
+	bool getCurrentFrame(Mat &frame);
+	int getSkippedFrames();
 	void getOriginalFrame(bool doEmit);
 	bool startRecord(std::string filepath, bool captureOriginal);
 	void stopRecord();
@@ -64,31 +74,33 @@ public:
 	int writenFrames();
 private:
 	void updateFPS(int);
-	bool processingBufferFilled();
-	void fillProcessingBuffer();
-	//Magnificator magnificator;
 	SharedImageBuffer *sharedImageBuffer;
 	Mat currentFrame;
+	Mat convertedFrame;
 	Mat combinedFrame;
 	Mat originalFrame;
 	Rect currentROI;
 	QImage frame;
+	QSize displaySize;
+	Mat displayFrame;
+	FrameMailbox frameMailbox;
+	FrameMailbox originalFrameMailbox;
 	QElapsedTimer t;
 	QQueue<int> fps;
 	QMutex doStopMutex;
 	QMutex processingMutex;
 	Size frameSize;
-	std::vector<Mat> processingBuffer;
-	int processingBufferLength;
 	Point framePoint;
 	struct ImageProcessingFlags imgProcFlags;
 	struct ImageProcessingSettings imgProcSettings;
+	ProcessingPipeline pipeline;
 	struct ThreadStatisticsData statsData;
 	volatile bool doStop;
 	int processingTime;
 	int fpsSum;
 	int sampleNumber;
 	int deviceNumber;
+	unsigned int inputPixelFormat;
 	bool emitOriginal;
 	bool doRecord;
 	VideoWriter output;
@@ -105,11 +117,10 @@ public slots:
 	void updateImageProcessingFlags(struct ImageProcessingFlags);
 	void updateProcessingSettings(struct ImageProcessingSettings);
 	void setROI(QRect roi);
+	void setDisplaySize(QSize size);
 	void updateFramerate(double fps);
 
 signals:
-	void newFrame(const QImage &frame);
-	void origFrame(const QImage &frame);
 	void updateStatisticsInGUI(struct ThreadStatisticsData);
 	void frameWritten(int frames);
 	void maxLevels(int levels);
@@ -64,27 +64,26 @@ void SavingThread::run()
 		////////////////////////// ////////
 		// if at last frame, skip grabbing frames until we have processed every frame
 		if (getCurrentCaptureIndex() < videoLength) {
-			//if (imgProcFlags.colorMagnifyOn && processingBufferLength > 2 && currentWriteIndex == 1) {
-			//	processingBufferLength = 2;
-			//}
-
 			for (int i = processingBuffer.size(); i < processingBufferLength; i++) {
 				// Try to read the Frame
 				if (cap.read(grabbedFrame)) {
-					// Clone the most recent frame
-					currentFrame = Mat(grabbedFrame.clone(), ROI);
+					// Set ROI of frame (the next read refills grabbedFrame, so no copy is needed)
+					currentFrame = Mat(grabbedFrame, ROI);
 
 					// Do the PREPROCESSING
 					if (imgProcFlags.grayscaleOn && (currentFrame.channels() == 3 || currentFrame.channels() == 4)) {
 						cvtColor(currentFrame, currentFrame, cv::COLOR_BGR2GRAY, 1);
 					}
 
-					// Fill Buffer
-					processingBuffer.push_back(currentFrame);
-
-					// If capturing original, push back, too
+					// If capturing original, keep it before it is magnified
 					if (captureOriginal)
-						originalBuffer.push_back(currentFrame);
+						originalBuffer.push(currentFrame.clone());
+
+					// Magnify in place, the magnificator streams frame by frame
+					magnificator.process(currentFrame);
+
+					// Fill Buffer, the frame is moved in
+					processingBuffer.push(std::move(currentFrame));
 				}else {
 					doStop = true;
 					break;
@@ -96,31 +95,13 @@ void SavingThread::run()
 		}
 		processingMutex.lock();
 		///Process
-/*
-        if(imgProcFlags.colorMagnifyOn) {
-            magnificator.colorMagnify();
-            processedFrame = magnificator.getFrameFirst();
-        }
-        else if(imgProcFlags.laplaceMagnifyOn) {
-            magnificator.laplaceMagnify();
-            processedFrame = magnificator.getFrameFirst();
-        }
-        else if(imgProcFlags.rieszMagnifyOn) {
-            magnificator.rieszMagnify();
-            processedFrame = magnificator.getFrameFirst();
-        }
-        else */{
-                        processedFrame = processingBuffer.front();
-                        processingBuffer.erase(processingBuffer.begin());
-                }
-                currentWriteIndex++;
+		processingBuffer.pop(processedFrame);
+		currentWriteIndex++;
 
 		// Combine Frames
-		if (captureOriginal) {
-			Mat originalFrame = originalBuffer.front();
+		Mat originalFrame;
+		if (captureOriginal && originalBuffer.pop(originalFrame))
 			mergedFrame = combineFrames(processedFrame, originalFrame);
-			originalBuffer.erase(originalBuffer.begin());
-		}
 
 		processingMutex.unlock();
 
@@ -150,7 +131,8 @@ void SavingThread::resetSaver()
 	QMutexLocker locker2(&processingMutex);
 
 	processingBuffer.clear();
-	//magnificator.clearBuffer();
+	originalBuffer.clear();
+	magnificator.clearBuffer();
 	currentWriteIndex = 0;
 	releaseFile();
 	cap.set(cv::CAP_PROP_POS_FRAMES, 0);
@@ -180,18 +162,12 @@ void SavingThread::settings(ImageProcessingFlags imageProcFlags, ImageProcessing
 	this->imgProcFlags = imageProcFlags;
 	this->imgProcSettings = imageProcSettings;
 
-	//this->magnificator = Magnificator(&processingBuffer, &imgProcFlags, &imgProcSettings);
+	magnificator.configure(imgProcFlags, imgProcSettings);
 }
 
 bool SavingThread::saveFile(std::string destination, double framerate, QRect dimensions, bool captureOriginal)
-{/*
-	 if (imgProcFlags.colorMagnifyOn) {
-	    processingBufferLength = magnificator.getOptimalBufferSize(framerate);
-	 }else if (imgProcFlags.laplaceMagnifyOn) {
-	    processingBufferLength = 2;
-	 }else if (imgProcFlags.rieszMagnifyOn) {
-	    processingBufferLength = 2;
-	 }else*/
+{
+	// Magnification keeps its own temporal state, one frame in flight is enough
 	processingBufferLength = 1;
 
 	this->ROI = Rect(dimensions.x(), dimensions.y(), dimensions.width(), dimensions.height());
@@ -204,6 +180,7 @@ bool SavingThread::saveFile(std::string destination, double framerate, QRect dim
 	bool success = (out.open(destination, savingCodec, framerate, s, !(imgProcFlags.grayscaleOn)));
 	// Update the settings, to add framerate
 	imgProcSettings.framerate = framerate;
+	magnificator.configure(imgProcFlags, imgProcSettings);
 	// If succesful, indicate thread is running
 	if (success)
 		doStop = false;
@@ -228,7 +205,7 @@ int SavingThread::getCurrentCaptureIndex()
 
 bool SavingThread::processingBufferFilled()
 {
-	return(processingBuffer.size() == processingBufferLength);
+	return processingBuffer.isFull();
 }
 
 int SavingThread::getCurrentReadIndex()
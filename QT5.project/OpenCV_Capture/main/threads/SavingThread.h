@@ -33,8 +33,9 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/highgui/highgui.hpp>
 // Local
-//#include "main/magnification/Magnificator.h"
+#include "main/magnification/Magnificator.h"
 #include "main/other/Structures.h"
+#include "main/other/FrameSlot.h"
 
 using namespace cv;
 
@@ -64,8 +65,8 @@ private:
 	// Capture
 	VideoCapture cap;
 	int videoLength;
-	std::vector<Mat> processingBuffer;
-	std::vector<Mat> originalBuffer;
+	FrameSlot<Mat> processingBuffer;
+	FrameSlot<Mat> originalBuffer;
 	int processingBufferLength;
 	Rect ROI;
 	Mat grabbedFrame;
@@ -81,7 +82,7 @@ private:
 	int getCurrentReadIndex();
 	Mat combineFrames(Mat &frame1, Mat &frame2);
 	// Magnify
-	//Magnificator magnificator;
+	Magnificator magnificator;
 	ImageProcessingFlags imgProcFlags;
 	ImageProcessingSettings imgProcSettings;
 
@@ -80,6 +80,11 @@ CameraView::CameraView(QWidget *parent, int deviceNumber, SharedImageBuffer *sha
 	connect(ui->clearImageBufferButton, SIGNAL(released()), this, SLOT(clearImageBuffer()));
 	connect(ui->frameLabel->menu, SIGNAL(triggered(QAction*)), this, SLOT(handleContextMenuAction(QAction*)));
 
+	// GUI repaint tick, pulls the latest processed frame
+	displayTimer = new QTimer(this);
+	displayTimer->setInterval(DISPLAY_REFRESH_INTERVAL_MS);
+	connect(displayTimer, SIGNAL(timeout()), this, SLOT(updateDisplay()));
+
 	// Register type
 	qRegisterMetaType<struct ThreadStatisticsData>("ThreadStatisticsData");
 
@@ -97,6 +102,8 @@ CameraView::CameraView(QWidget *parent, int deviceNumber, SharedImageBuffer *sha
 CameraView::~CameraView()
 {
 	if (isCameraConnected) {
+		// Stop pulling frames
+		displayTimer->stop();
 		// Stop processing thread
 		if (processingThread->isRunning())
 			stopProcessingThread();
@@ -129,17 +136,16 @@ bool CameraView::connectToCamera(bool dropFrameIfBufferFull, int capThreadPrio,
 	if (captureThread->connectToCamera()) {
 		// Create processing thread
 		processingThread = new ProcessingThread(sharedImageBuffer, deviceNumber);
+		processingThread->setInputPixelFormat(captureThread->getInputPixelFormat());
 
-		// Create MagnifyOptions tab and set current
-		//this->magnifyOptionsTab = new MagnifyOptions(this);
-		//ui->tabWidget->insertTab(0, magnifyOptionsTab, tr("Options"));
+		// Create MagnifyOptions tab (appended, so the existing tab indices stay), keep first tab current
+		this->magnifyOptionsTab = new MagnifyOptions(this);
+		ui->tabWidget->addTab(magnifyOptionsTab, tr("Magnify"));
 		ui->tabWidget->setCurrentIndex(0);
 		ui->InfoTab->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Ignored);
 
 		// Setup signal/slot connections
 		connect(ui->tabWidget, SIGNAL(currentChanged(int)), this, SLOT(handleTabChange(int)));
-		connect(processingThread, SIGNAL(newFrame(QImage)), this, SLOT(updateFrame(QImage)));
-		connect(processingThread, SIGNAL(origFrame(QImage)), this, SLOT(updateOriginalFrame(QImage)));
 		connect(processingThread, SIGNAL(updateStatisticsInGUI(ThreadStatisticsData)), this, SLOT(updateProcessingThreadStats(ThreadStatisticsData)));
 		connect(captureThread, SIGNAL(updateStatisticsInGUI(ThreadStatisticsData)), this, SLOT(updateCaptureThreadStats(ThreadStatisticsData)));
 		connect(captureThread, SIGNAL(updateFramerate(double)), processingThread, SLOT(updateFramerate(double)));
@@ -147,26 +153,31 @@ bool CameraView::connectToCamera(bool dropFrameIfBufferFull, int capThreadPrio,
 		connect(this, SIGNAL(newProcessingSettings(ImageProcessingSettings)), processingThread, SLOT(updateProcessingSettings(ImageProcessingSettings)));
 
 		connect(this, SIGNAL(setROI(QRect)), processingThread, SLOT(setROI(QRect)));
-		//connect(processingThread, SIGNAL(maxLevels(int)), magnifyOptionsTab, SLOT(setMaxLevel(int)));
+		connect(ui->frameLabel, SIGNAL(newDisplaySize(QSize)), processingThread, SLOT(setDisplaySize(QSize)));
+		connect(processingThread, SIGNAL(maxLevels(int)), magnifyOptionsTab, SLOT(setMaxLevel(int)));
+		connect(captureThread, SIGNAL(updateFramerate(double)), magnifyOptionsTab, SLOT(setFPS(double)));
 		connect(ui->recordButton, SIGNAL(released()), this, SLOT(record()));
 		connect(ui->recordPathButton, SIGNAL(released()), this, SLOT(selectButton_action()));
 		connect(processingThread, SIGNAL(frameWritten(int)), this, SLOT(frameWritten(int)));
 
-		// Setup signal/slot connections for MagnifyOptions
-		//connect(magnifyOptionsTab, SIGNAL(newImageProcessingFlags(struct ImageProcessingFlags)), processingThread, SLOT(updateImageProcessingFlags(struct ImageProcessingFlags)));
-		//connect(magnifyOptionsTab, SIGNAL(newImageProcessingSettings(struct ImageProcessingSettings)), processingThread, SLOT(updateImageProcessingSettings(struct ImageProcessingSettings)));
+		// Setup signal/slot connections for MagnifyOptions, merged into the view's flags/settings
+		connect(magnifyOptionsTab, SIGNAL(newImageProcessingFlags(struct ImageProcessingFlags)), this, SLOT(updateMagnifyFlags(struct ImageProcessingFlags)));
+		connect(magnifyOptionsTab, SIGNAL(newImageProcessingSettings(struct ImageProcessingSettings)), this, SLOT(updateMagnifySettings(struct ImageProcessingSettings)));
 
 		connect(ui->frameLabel, SIGNAL(newMouseData(struct MouseData)), this, SLOT(newMouseData(struct MouseData)));
 		connect(originalFrame, SIGNAL(newMouseData(struct MouseData)), this, SLOT(newMouseData(struct MouseData)));
 
 		// Set initial data in processing thread
 		emit setROI(QRect(0, 0, captureThread->getInputSourceWidth(), captureThread->getInputSourceHeight()));
+		processingThread->setDisplaySize(ui->frameLabel->size());
 		emit newImageProcessingFlags(imageProcessingFlags);
 
 		// Start capturing frames from camera
 		captureThread->start((QThread::Priority)capThreadPrio);
 		// Start processing captured frames
 		processingThread->start((QThread::Priority)procThreadPrio);
+		// Start pulling processed frames
+		displayTimer->start();
 
 		// Setup imageBufferBar with minimum and maximum values
 		ui->imageBufferBar->setMinimum(0);
@@ -223,27 +234,45 @@ void CameraView::updateCaptureThreadStats(struct ThreadStatisticsData statData)
 
 void CameraView::updateProcessingThreadStats(struct ThreadStatisticsData statData)
 {
-	// Show processing rate in processingRateLabel
-	ui->processingRateLabel->setText(QString::number(statData.averageFPS) + " fps");
+	// Show processing rate in processingRateLabel, with memory and bandwidth of the magnification state
+	QString rate = QString::number(statData.averageFPS) + " fps";
+	int magnifyMode = Magnificator::modeFromFlags(imgProcFlags);
+	if (magnifyMode != MAGNIFY_NONE) {
+		MagnifyCounters counters = processingThread->getMagnifyCounters(magnifyMode);
+		rate += QString(" | ") + QString::number(counters.stateBytes / 1048576.0, 'f', 1) + tr(" MB state, ") +
+			QString::number(counters.trafficBytes / 1048576.0, 'f', 1) + tr(" MB/frame");
+	}
+	ui->processingRateLabel->setText(rate);
 	// Show ROI information in roiLabel
 	ui->roiLabel->setText(QString("(") + QString::number(processingThread->getCurrentROI().x()) + QString(",") +
 			      QString::number(processingThread->getCurrentROI().y()) + QString(") ") +
 			      QString::number(processingThread->getCurrentROI().width()) +
 			      QString("x") + QString::number(processingThread->getCurrentROI().height()));
-	// Show number of frames processed in nFramesProcessedLabel
-	ui->nFramesProcessedLabel->setText(QString("[") + QString::number(statData.nFramesProcessed) + QString("]"));
+	// Show number of frames processed and frames the display skipped (processing faster than the repaint tick) in nFramesProcessedLabel
+	ui->nFramesProcessedLabel->setText(QString("[") + QString::number(statData.nFramesProcessed) + QString("] ") +
+					   QString::number(processingThread->getSkippedFrames()) + tr(" skipped"));
+}
+
+void CameraView::updateDisplay()
+{
+	QImage frame;
+	// Only the latest frame is shown, older ones were already dropped by the mailbox
+	if (processingThread->takeFrame(frame))
+		updateFrame(frame);
+	if (processingThread->takeOriginalFrame(frame))
+		updateOriginalFrame(frame);
 }
 
 void CameraView::updateFrame(const QImage &frame)
 {
 	// Display frame
-	ui->frameLabel->setPixmap(QPixmap::fromImage(frame).scaled(ui->frameLabel->width(), ui->frameLabel->height(), Qt::KeepAspectRatio));
+	ui->frameLabel->setFrame(frame);
 }
 
 void CameraView::updateOriginalFrame(const QImage &frame)
 {
 	// Display frame
-	originalFrame->setPixmap(QPixmap::fromImage(frame).scaled(ui->frameLabel->width(), ui->frameLabel->height(), Qt::KeepAspectRatio));
+	originalFrame->setFrame(frame);
 }
 
 void CameraView::handleOriginalWindow(bool doEmit)
@@ -268,11 +297,11 @@ void CameraView::updateMouseCursorPosLabel()
 					 QString(")"));
 
 	// Show pixel cursor position if camera is connected (image is being shown)
-	if (ui->frameLabel->pixmap() != 0) {
+	if (ui->frameLabel->hasFrame()) {
 		// Scaling factor calculation depends on whether frame is scaled to fit label or not
 		if (!ui->frameLabel->hasScaledContents()) {
-			double xScalingFactor = ((double)ui->frameLabel->getMouseCursorPos().x() - ((ui->frameLabel->width() - ui->frameLabel->pixmap()->width()) / 2)) / (double)ui->frameLabel->pixmap()->width();
-			double yScalingFactor = ((double)ui->frameLabel->getMouseCursorPos().y() - ((ui->frameLabel->height() - ui->frameLabel->pixmap()->height()) / 2)) / (double)ui->frameLabel->pixmap()->height();
+			double xScalingFactor = ((double)ui->frameLabel->getMouseCursorPos().x() - ((ui->frameLabel->width() - ui->frameLabel->getFrameSize().width()) / 2)) / (double)ui->frameLabel->getFrameSize().width();
+			double yScalingFactor = ((double)ui->frameLabel->getMouseCursorPos().y() - ((ui->frameLabel->height() - ui->frameLabel->getFrameSize().height()) / 2)) / (double)ui->frameLabel->getFrameSize().height();
 
 			ui->mouseCursorPosLabel->setText(ui->mouseCursorPosLabel->text() +
 							 QString(" [") + QString::number((int)(xScalingFactor * processingThread->getCurrentROI().width())) +
@@ -305,10 +334,10 @@ void CameraView::newMouseData(struct MouseData mouseData)
 
 		// Selection box calculation depends on whether frame is scaled to fit label or not
 		if (!ui->frameLabel->hasScaledContents()) {
-			xScalingFactor = ((double)mouseData.selectionBox.x() - ((ui->frameLabel->width() - ui->frameLabel->pixmap()->width()) / 2)) / (double)ui->frameLabel->pixmap()->width();
-			yScalingFactor = ((double)mouseData.selectionBox.y() - ((ui->frameLabel->height() - ui->frameLabel->pixmap()->height()) / 2)) / (double)ui->frameLabel->pixmap()->height();
-			wScalingFactor = (double)processingThread->getCurrentROI().width() / (double)ui->frameLabel->pixmap()->width();
-			hScalingFactor = (double)processingThread->getCurrentROI().height() / (double)ui->frameLabel->pixmap()->height();
+			xScalingFactor = ((double)mouseData.selectionBox.x() - ((ui->frameLabel->width() - ui->frameLabel->getFrameSize().width()) / 2)) / (double)ui->frameLabel->getFrameSize().width();
+			yScalingFactor = ((double)mouseData.selectionBox.y() - ((ui->frameLabel->height() - ui->frameLabel->getFrameSize().height()) / 2)) / (double)ui->frameLabel->getFrameSize().height();
+			wScalingFactor = (double)processingThread->getCurrentROI().width() / (double)ui->frameLabel->getFrameSize().width();
+			hScalingFactor = (double)processingThread->getCurrentROI().height() / (double)ui->frameLabel->getFrameSize().height();
 		}else {
 			xScalingFactor = (double)mouseData.selectionBox.x() / (double)ui->frameLabel->width();
 			yScalingFactor = (double)mouseData.selectionBox.y() / (double)ui->frameLabel->height();
@@ -362,11 +391,11 @@ void CameraView::updateMouseCursorPosLabelOriginalFrame()
 					 QString(")"));
 
 	// Show pixel cursor position if camera is connected (image is being shown)
-	if (originalFrame->pixmap() != 0) {
+	if (originalFrame->hasFrame()) {
 		// Scaling factor calculation depends on whether frame is scaled to fit label or not
 		if (!originalFrame->hasScaledContents()) {
-			double xScalingFactor = ((double)originalFrame->getMouseCursorPos().x() - ((originalFrame->width() - originalFrame->pixmap()->width()) / 2)) / (double)originalFrame->pixmap()->width();
-			double yScalingFactor = ((double)originalFrame->getMouseCursorPos().y() - ((originalFrame->height() - originalFrame->pixmap()->height()) / 2)) / (double)originalFrame->pixmap()->height();
+			double xScalingFactor = ((double)originalFrame->getMouseCursorPos().x() - ((originalFrame->width() - originalFrame->getFrameSize().width()) / 2)) / (double)originalFrame->getFrameSize().width();
+			double yScalingFactor = ((double)originalFrame->getMouseCursorPos().y() - ((originalFrame->height() - originalFrame->getFrameSize().height()) / 2)) / (double)originalFrame->getFrameSize().height();
 
 			ui->mouseCursorPosLabel->setText(ui->mouseCursorPosLabel->text() +
 							 QString(" [") + QString::number((int)(xScalingFactor * processingThread->getCurrentROI().width())) +
@@ -399,10 +428,10 @@ void CameraView::newMouseDataOriginalFrame(struct MouseData mouseData)
 
 		// Selection box calculation depends on whether frame is scaled to fit label or not
 		if (!originalFrame->hasScaledContents()) {
-			xScalingFactor = ((double)mouseData.selectionBox.x() - ((originalFrame->width() - originalFrame->pixmap()->width()) / 2)) / (double)originalFrame->pixmap()->width();
-			yScalingFactor = ((double)mouseData.selectionBox.y() - ((originalFrame->height() - originalFrame->pixmap()->height()) / 2)) / (double)originalFrame->pixmap()->height();
-			wScalingFactor = (double)processingThread->getCurrentROI().width() / (double)originalFrame->pixmap()->width();
-			hScalingFactor = (double)processingThread->getCurrentROI().height() / (double)originalFrame->pixmap()->height();
+			xScalingFactor = ((double)mouseData.selectionBox.x() - ((originalFrame->width() - originalFrame->getFrameSize().width()) / 2)) / (double)originalFrame->getFrameSize().width();
+			yScalingFactor = ((double)mouseData.selectionBox.y() - ((originalFrame->height() - originalFrame->getFrameSize().height()) / 2)) / (double)originalFrame->getFrameSize().height();
+			wScalingFactor = (double)processingThread->getCurrentROI().width() / (double)originalFrame->getFrameSize().width();
+			hScalingFactor = (double)processingThread->getCurrentROI().height() / (double)originalFrame->getFrameSize().height();
 		}else {
 			xScalingFactor = (double)mouseData.selectionBox.x() / (double)originalFrame->width();
 			yScalingFactor = (double)mouseData.selectionBox.y() / (double)originalFrame->height();
@@ -491,7 +520,7 @@ void CameraView::record()
 	if (processingThread->isRecording()) {
 		processingThread->stopRecord();
 		ui->recordButton->setText(tr("Record"));
-		//magnifyOptionsTab->toggleGrayscale(true);
+		magnifyOptionsTab->toggleGrayscale(true);
 		//ui->recordOriginalCheckbox->setDisabled(false);
 	}else {
 		if (recordPath.empty()) {
@@ -501,7 +530,7 @@ void CameraView::record()
 			//if (processingThread->startRecord(recordPath, ui->recordOriginalCheckbox->isChecked())) {
 			if (processingThread->startRecord(recordPath, false)) {
 				ui->recordButton->setText(tr("Stop"));
-				//magnifyOptionsTab->toggleGrayscale(false);
+				magnifyOptionsTab->toggleGrayscale(false);
 				//ui->recordOriginalCheckbox->setDisabled(true);
 			}else
 				QMessageBox::warning(this->parentWidget(), tr("WARNING:"), tr("Please enter a valid filename and -ending or change Codec (File->Saving Codec)"));
@@ -536,6 +565,29 @@ void CameraView::handleTabChange(int index)
 		ui->InfoTab->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Ignored);
 }
 
+// MagnifyOptions only owns the magnification part of flags/settings
+void CameraView::updateMagnifyFlags(struct ImageProcessingFlags flags)
+{
+	imgProcFlags.colorMagnifyOn = flags.colorMagnifyOn;
+	imgProcFlags.laplaceMagnifyOn = flags.laplaceMagnifyOn;
+	imgProcFlags.rieszMagnifyOn = flags.rieszMagnifyOn;
+	imgProcFlags.waveletMagnifyOn = flags.waveletMagnifyOn;
+	emit newImageProcessingFlags(imgProcFlags);
+}
+
+void CameraView::updateMagnifySettings(struct ImageProcessingSettings settings)
+{
+	imgProcSettings.amplification = settings.amplification;
+	imgProcSettings.coWavelength = settings.coWavelength;
+	imgProcSettings.coLow = settings.coLow;
+	imgProcSettings.coHigh = settings.coHigh;
+	imgProcSettings.chromAttenuation = settings.chromAttenuation;
+	imgProcSettings.levels = settings.levels;
+	imgProcSettings.rieszFilterRank = settings.rieszFilterRank;
+	imgProcSettings.temporalStorage = settings.temporalStorage;
+	emit newProcessingSettings(imgProcSettings);
+}
+
 void CameraView::setCodec(int codec)
 {
 	this->codec = codec;
@@ -596,6 +648,12 @@ void CameraView::on_checkBoxMeanShift_clicked(bool checked)
 	emit newImageProcessingFlags(imgProcFlags);
 }
 
+void CameraView::on_checkBoxMeanShiftSegment_clicked(bool checked)
+{
+	imgProcFlags.meanshiftSegmentOn = checked;
+	emit newImageProcessingFlags(imgProcFlags);
+}
+
 void CameraView::on_checkBoxCartoon_clicked(bool checked)
 {
 	imgProcFlags.cartoonOn = checked;
@@ -646,10 +704,10 @@ void CameraView::on_pushButtonShot_clicked()
 	qDebug() << "folder:" << MyUtils::stringMyFolder();
 	qDebug() << "fname: " << fname;
 
-	//const QPixmap *pm = ui->frameLabel->pixmap(Qt::ReturnByValueConstant); //deprecated!
-	QPixmap pm = ui->frameLabel->pixmap(Qt::ReturnByValue);
-	if (!pm.isNull()) {
-		pm.save(fname, nullptr);
+	// Save the full resolution frame, not the display sized one
+	Mat shot;
+	if (isCameraConnected && processingThread->getCurrentFrame(shot)) {
+		MatToQImage(shot).save(fname, nullptr);
 
 		//Append frame to listView
 		QStandardItem * item = new QStandardItem();
@@ -684,14 +742,14 @@ void CameraView::on_buttonMorphGradient_clicked()
 
 void CameraView::on_buttonShotSendCam_clicked()
 {
-	QPixmap pm = ui->frameLabel->pixmap(Qt::ReturnByValue);
-	if (!pm.isNull()) {
+	Mat shot;
+	if (isCameraConnected && processingThread->getCurrentFrame(shot)) {
 		QString sIP = ui->lineEditIPCam->text();
 		int iPort = ui->lineEditPortCam->text().toInt();
 		if ((!sIP.isEmpty()) && (iPort > 0)) {
 			myTcpSendPix = new TcpSendPix(sIP, iPort);
 
-			myTcpSendPix->send(pm);
+			myTcpSendPix->send(QPixmap::fromImage(MatToQImage(shot)));
 			qDebug() << "TcpSend:" << sIP << iPort;
 		}
 	}
@@ -30,6 +30,7 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QStandardItem>
+#include <QTimer>
 // Local
 #include "main/threads/CaptureThread.h"
 #include "main/threads/ProcessingThread.h"
@@ -37,6 +38,7 @@
 #include "main/helper/SharedImageBuffer.h"
 
 #include "main/ui/FrameLabel.h"
+#include "main/ui/MagnifyOptions.h"
 #include "helper/tcpsendpix.h"
 
 namespace Ui {
@@ -64,8 +66,9 @@ private:
 	void stopProcessingThread();
 	int deviceNumber;
 	bool isCameraConnected;
-	//MagnifyOptions *magnifyOptionsTab;
+	MagnifyOptions *magnifyOptionsTab;
 	FrameLabel *originalFrame;
+	QTimer *displayTimer;
 	void handleOriginalWindow(bool doEmit);
 	QString getFormattedTime(int timeInMSeconds);
 	int codec;
@@ -83,6 +86,7 @@ public slots:
 	void frameWritten(int frames);
 
 private slots:
+	void updateDisplay();
 	void updateFrame(const QImage &frame);
 	void updateOriginalFrame(const QImage &frame);
 	void updateProcessingThreadStats(struct ThreadStatisticsData statData);
@@ -92,6 +96,8 @@ private slots:
 	void record();
 	void selectButton_action();
 	void handleTabChange(int index);
+	void updateMagnifyFlags(struct ImageProcessingFlags flags);
+	void updateMagnifySettings(struct ImageProcessingSettings settings);
 
 	void on_checkBoxGrayscale_clicked(bool checked);
 	void on_checkBoxHsvHistogram_clicked(bool checked);
@@ -120,6 +126,7 @@ private slots:
 
 
 	void on_checkBoxMeanShift_clicked(bool checked);
+	void on_checkBoxMeanShiftSegment_clicked(bool checked);
 
 	void on_checkBoxCartoon_clicked(bool checked);
 
@@ -34,6 +34,12 @@ FrameLabel::FrameLabel(QWidget *parent) : QLabel(parent)
 	mouseData.leftButtonRelease = false;
 	mouseData.rightButtonRelease = false;
 	createContextMenu();
+	// OpenGL surface on top of the label, shown with the first frame
+	glView = NULL;
+	if (USE_GL_FRAME_LABEL) {
+		glView = new GLFrameView(this);
+		glView->setVisible(false);
+	}
 }
 
 FrameLabel::~FrameLabel()
@@ -49,6 +55,7 @@ void FrameLabel::mouseMoveEvent(QMouseEvent *ev)
 	if (drawBox) {
 		box->setWidth(getMouseCursorPos().x() - startPoint.x());
 		box->setHeight(getMouseCursorPos().y() - startPoint.y());
+		updateSelectionBox();
 	}
 	// Inform main window of mouse move event
 	emit onMouseMoveEvent();
@@ -75,6 +82,7 @@ void FrameLabel::mouseReleaseEvent(QMouseEvent *ev)
 		if (drawBox) {
 			// Stop drawing box
 			drawBox = false;
+			updateSelectionBox();
 			// Save box dimensions
 			mouseData.selectionBox.setX(box->left());
 			mouseData.selectionBox.setY(box->top());
@@ -91,9 +99,10 @@ void FrameLabel::mouseReleaseEvent(QMouseEvent *ev)
 	// On right mouse button release
 	else if (ev->button() == Qt::RightButton) {
 		// If user presses (and then releases) the right mouse button while drawing box, stop drawing box
-		if (drawBox)
+		if (drawBox) {
 			drawBox = false;
-		else{
+			updateSelectionBox();
+		}else{
 			// Show context menu
 			menu->exec(ev->globalPos());
 		}
@@ -109,6 +118,7 @@ void FrameLabel::mousePressEvent(QMouseEvent *ev)
 		startPoint = ev->pos();
 		box = new QRect(startPoint.x(), startPoint.y(), 0, 0);
 		drawBox = true;
+		updateSelectionBox();
 	}
 }
 
@@ -123,6 +133,64 @@ void FrameLabel::paintEvent(QPaintEvent *ev)
 	}
 }
 
+void FrameLabel::resizeEvent(QResizeEvent *ev)
+{
+	QLabel::resizeEvent(ev);
+	if (glView != NULL)
+		glView->setGeometry(rect());
+	// Inform the worker thread, frames are scaled to the label size there
+	emit newDisplaySize(ev->size());
+}
+
+void FrameLabel::setFrame(const QImage &frame)
+{
+	if (glView != NULL) {
+		glView->setFrame(frame);
+		if (!glView->isVisible()) {
+			glView->setGeometry(rect());
+			glView->setVisible(true);
+		}
+	}else {
+		// Already display sized by the worker, scaled() is a no-op unless a resize is in flight
+		setPixmap(QPixmap::fromImage(frame).scaled(width(), height(), Qt::KeepAspectRatio));
+	}
+}
+
+bool FrameLabel::hasFrame()
+{
+	if (glView != NULL)
+		return !glView->getFrame().isNull();
+	return pixmap() != 0;
+}
+
+// Size of the shown frame in widget coordinates (used to map mouse positions to the ROI)
+QSize FrameLabel::getFrameSize()
+{
+	if (glView != NULL)
+		return glView->getFrameRect().size();
+	return pixmap()->size();
+}
+
+QPixmap FrameLabel::getFramePixmap()
+{
+	if (glView != NULL)
+		return QPixmap::fromImage(glView->getFrame());
+	return pixmap(Qt::ReturnByValue);
+}
+
+void FrameLabel::setScaledContents(bool scaled)
+{
+	QLabel::setScaledContents(scaled);
+	if (glView != NULL)
+		glView->setScaledContents(scaled);
+}
+
+void FrameLabel::updateSelectionBox()
+{
+	if (glView != NULL)
+		glView->setSelectionBox(drawBox ? box->normalized() : QRect());
+}
+
 void FrameLabel::createContextMenu()
 {
 	// Create top-level menu object
@@ -33,8 +33,10 @@
 #include <QMenu>
 #include <QtGui/QPainter>
 #include <QtGui/QMouseEvent>
+#include <QtGui/QResizeEvent>
 // Local
 #include "main/other/Structures.h"
+#include "main/ui/GLFrameView.h"
 
 class FrameLabel : public QLabel
 {
@@ -45,10 +47,17 @@ public:
 	~FrameLabel();
 	void setMouseCursorPos(QPoint);
 	QPoint getMouseCursorPos();
+	void setFrame(const QImage &frame);
+	bool hasFrame();
+	QSize getFrameSize();
+	QPixmap getFramePixmap();
+	void setScaledContents(bool scaled);
 	QMenu *menu;
 
 private:
 	void createContextMenu();
+	void updateSelectionBox();
+	GLFrameView *glView;
 	MouseData mouseData;
 	QPoint startPoint;
 	QPoint mouseCursorPos;
@@ -60,10 +69,12 @@ protected:
 	void mousePressEvent(QMouseEvent *ev);
 	void mouseReleaseEvent(QMouseEvent *ev);
 	void paintEvent(QPaintEvent *ev);
+	void resizeEvent(QResizeEvent *ev);
 
 signals:
 	void newMouseData(struct MouseData mouseData);
 	void onMouseMoveEvent();
+	void newDisplaySize(QSize size);
 };
 
 #endif // FRAMELABEL_H
@@ -0,0 +1,209 @@
+/************************************************************************************/
+/* An OpenCV/Qt based realtime application			                    */
+/*                                                                                  */
+/*                                                                                  */
+/* Based on the work of                                                             */
+/*      Joseph Pan      <https://github.com/wzpan/QtEVM>                            */
+/*      Nick D'Ademo    <https://github.com/nickdademo/qt-opencv-multithreaded>     */
+/*                                                                                  */
+/* ui/GLFrameView.cpp                                                               */
+/*                                                                                  */
+/* This program is free software: you can redistribute it and/or modify             */
+/* it under the terms of the GNU General Public License as published by             */
+/* the Free Software Foundation, either version 3 of the License, or                */
+/* (at your option) any later version.                                              */
+/*                                                                                  */
+/* This program is distributed in the hope that it will be useful,                  */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of                   */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    */
+/* GNU General Public License for more details.                                     */
+/*                                                                                  */
+/* You should have received a copy of the GNU General Public License                */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.            */
+/************************************************************************************/
+
+#include "main/ui/GLFrameView.h"
+// Qt
+#include <QPainter>
+#include <QDebug>
+
+static const char *vertexShaderSource =
+	"attribute vec2 position;\n"
+	"varying vec2 texCoord;\n"
+	"void main() {\n"
+	"	texCoord = vec2(position.x + 1.0, 1.0 - position.y) * 0.5;\n"
+	"	gl_Position = vec4(position, 0.0, 1.0);\n"
+	"}\n";
+
+static const char *fragmentShaderSource =
+	"#ifdef GL_ES\n"
+	"precision mediump float;\n"
+	"#endif\n"
+	"uniform sampler2D frame;\n"
+	"uniform bool swapRB;\n"
+	"varying vec2 texCoord;\n"
+	"void main() {\n"
+	"	vec3 color = texture2D(frame, texCoord).rgb;\n"
+	"	gl_FragColor = vec4(swapRB ? color.bgr : color, 1.0);\n"
+	"}\n";
+
+static const GLfloat quad[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+
+GLFrameView::GLFrameView(QWidget *parent) : QOpenGLWidget(parent)
+{
+	texture = 0;
+	textureFormat = 0;
+	frameDirty = false;
+	scaledContents = false;
+	// FrameLabel underneath handles mouse selection and the context menu
+	setAttribute(Qt::WA_TransparentForMouseEvents);
+}
+
+GLFrameView::~GLFrameView()
+{
+	makeCurrent();
+	releaseTexture();
+	doneCurrent();
+}
+
+void GLFrameView::initializeGL()
+{
+	initializeOpenGLFunctions();
+	program.removeAllShaders();
+	program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource);
+	program.addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource);
+	program.bindAttributeLocation("position", 0);
+	if (!program.link())
+		qDebug() << "ERROR: GLFrameView shaders could not be built:" << program.log();
+	// Context may be recreated (e.g. on reparenting), texture has to follow
+	texture = 0;
+	textureSize = QSize();
+	frameDirty = !frame.isNull();
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void GLFrameView::setFrame(const QImage &frame)
+{
+	// Implicitly shared, upload happens in paintGL with the context current
+	this->frame = frame;
+	frameDirty = true;
+	update();
+}
+
+QImage GLFrameView::getFrame()
+{
+	return frame;
+}
+
+QRect GLFrameView::getFrameRect()
+{
+	if (frame.isNull())
+		return QRect();
+	if (scaledContents)
+		return rect();
+	// Same placement as a centered QLabel pixmap scaled with Qt::KeepAspectRatio
+	QSize fit = frame.size().scaled(size(), Qt::KeepAspectRatio);
+	return QRect(QPoint((width() - fit.width()) / 2, (height() - fit.height()) / 2), fit);
+}
+
+void GLFrameView::setScaledContents(bool scaled)
+{
+	scaledContents = scaled;
+	update();
+}
+
+void GLFrameView::setSelectionBox(const QRect &box)
+{
+	selectionBox = box;
+	update();
+}
+
+void GLFrameView::uploadFrame()
+{
+	GLenum format;
+	bool swapRB = false;
+	switch (frame.format()) {
+	case QImage::Format_Grayscale8:
+	case QImage::Format_Indexed8:
+		format = GL_LUMINANCE;
+		break;
+	case QImage::Format_RGB888:
+		format = GL_RGB;
+		break;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+	case QImage::Format_BGR888:
+		format = GL_RGB;
+		swapRB = true;
+		break;
+#endif
+	default:
+		frame = frame.convertToFormat(QImage::Format_RGB888);
+		format = GL_RGB;
+		break;
+	}
+	program.setUniformValue("swapRB", swapRB);
+
+	// QImage lines are 4-byte aligned, which is the default GL unpack alignment
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	if (texture == 0) {
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}else {
+		glBindTexture(GL_TEXTURE_2D, texture);
+	}
+	// (Re)allocate only on size/format change, otherwise update in place
+	if (textureSize != frame.size() || textureFormat != format) {
+		glTexImage2D(GL_TEXTURE_2D, 0, format, frame.width(), frame.height(), 0, format, GL_UNSIGNED_BYTE, frame.constBits());
+		textureSize = frame.size();
+		textureFormat = format;
+	}else {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame.width(), frame.height(), format, GL_UNSIGNED_BYTE, frame.constBits());
+	}
+	frameDirty = false;
+}
+
+void GLFrameView::paintGL()
+{
+	glClear(GL_COLOR_BUFFER_BIT);
+	if (frame.isNull())
+		return;
+
+	program.bind();
+	program.setUniformValue("frame", 0);
+	glActiveTexture(GL_TEXTURE0);
+	if (frameDirty)
+		uploadFrame();
+	else
+		glBindTexture(GL_TEXTURE_2D, texture);
+
+	// Draw into the frame rectangle (device pixels, GL origin is bottom left)
+	QRect r = getFrameRect();
+	qreal ratio = devicePixelRatioF();
+	glViewport((GLint)(r.x() * ratio), (GLint)((height() - r.y() - r.height()) * ratio),
+		   (GLsizei)(r.width() * ratio), (GLsizei)(r.height() * ratio));
+	program.enableAttributeArray(0);
+	program.setAttributeArray(0, GL_FLOAT, quad, 2);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	program.disableAttributeArray(0);
+	program.release();
+
+	// Draw box
+	if (!selectionBox.isNull()) {
+		QPainter painter(this);
+		painter.setPen(QPen(Qt::yellow, 3, Qt::DashDotLine));
+		painter.drawRect(selectionBox);
+	}
+}
+
+void GLFrameView::releaseTexture()
+{
+	if (texture != 0) {
+		glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+	textureSize = QSize();
+}
@@ -0,0 +1,75 @@
+/************************************************************************************/
+/* An OpenCV/Qt based realtime application			                    */
+/*                                                                                  */
+/*                                                                                  */
+/* Based on the work of                                                             */
+/*      Joseph Pan      <https://github.com/wzpan/QtEVM>                            */
+/*      Nick D'Ademo    <https://github.com/nickdademo/qt-opencv-multithreaded>     */
+/*                                                                                  */
+/* ui/GLFrameView.h                                                                 */
+/*                                                                                  */
+/* This program is free software: you can redistribute it and/or modify             */
+/* it under the terms of the GNU General Public License as published by             */
+/* the Free Software Foundation, either version 3 of the License, or                */
+/* (at your option) any later version.                                              */
+/*                                                                                  */
+/* This program is distributed in the hope that it will be useful,                  */
+/* but WITHOUT ANY WARRANTY; without even the implied warranty of                   */
+/* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                    */
+/* GNU General Public License for more details.                                     */
+/*                                                                                  */
+/* You should have received a copy of the GNU General Public License                */
+/* along with this program.  If not, see <http://www.gnu.org/licenses/>.            */
+/************************************************************************************/
+
+#ifndef GLFRAMEVIEW_H
+#define GLFRAMEVIEW_H
+
+// Qt
+#include <QImage>
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+
+/*  GLFrameView
+ *
+ *    OpenGL surface used by FrameLabel instead of QLabel::setPixmap. Frames are
+ *    uploaded with glTexSubImage2D into a texture that is only reallocated when the
+ *    frame size or format changes. BGR frames are uploaded as they are and swizzled
+ *    in the fragment shader, scaling is done by the texture sampler. Only GL 2.0 /
+ *    GLES 2.0 features are used, so it also runs on Mesa llvmpipe.
+ *    Mouse events go through to the FrameLabel underneath, which also hands over
+ *    the selection box to draw.
+ *
+ */
+class GLFrameView : public QOpenGLWidget, protected QOpenGLFunctions
+{
+Q_OBJECT
+
+public:
+	GLFrameView(QWidget *parent);
+	~GLFrameView();
+	void setFrame(const QImage &frame);
+	QImage getFrame();
+	QRect getFrameRect();
+	void setScaledContents(bool scaled);
+	void setSelectionBox(const QRect &box);
+
+protected:
+	void initializeGL();
+	void paintGL();
+
+private:
+	void uploadFrame();
+	void releaseTexture();
+	QOpenGLShaderProgram program;
+	GLuint texture;
+	QSize textureSize;
+	GLenum textureFormat;
+	QImage frame;
+	bool frameDirty;
+	bool scaledContents;
+	QRect selectionBox;
+};
+
+#endif // GLFRAMEVIEW_H
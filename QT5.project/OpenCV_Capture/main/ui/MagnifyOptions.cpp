@@ -24,6 +24,7 @@
 
 #include "main/ui/MagnifyOptions.h"
 #include "ui_MagnifyOptions.h"
+#include "main/magnification/RieszPyramid.h"
 
 MagnifyOptions::MagnifyOptions(QWidget *parent) :
     QWidget(parent),
@@ -33,9 +34,17 @@ MagnifyOptions::MagnifyOptions(QWidget *parent) :
     ui->setupUi(this);
 
     //Create new double slider
-    doubleSlider = new QxtSpanSlider(Qt::Horizontal,this);
+    doubleSlider = new RangeSlider(Qt::Horizontal, RangeSlider::DoubleHandles, this);
     ui->doubleSliderField->insertWidget(0, doubleSlider);
-    //doubleSlider->setHandleMovementMode(QxtSpanSlider::NoOverlapping);
+    // Grayscale is switched in the processing tab of the view
+    ui->grayscaleCheckBox->hide();
+    // Riesz filters, index = rank of the separable approximation (0: exact)
+    ui->RieszFilterComboBox->addItem(tr("Exact (9x9)"));
+    for (int rank = 1; rank <= 3; ++rank)
+        ui->RieszFilterComboBox->addItem(tr("Rank %1 (%2% error)").arg(rank)
+                                         .arg(RieszPyramid::filterErrorBound(rank) * 100.0, 0, 'g', 2));
+    // Temporal filter state, index = TemporalStorage. Kept over mode changes and resets
+    ui->TemporalStorageComboBox->setCurrentIndex(DEFAULT_TEMPORAL_STORAGE);
 
     // Connect all sliders/buttons/boxes directly for responsible feeling
     connect(ui->MagnifcationtypeComboBox, SIGNAL(currentIndexChanged(int)), SLOT(updateFlagsFromOptionsTab()));
@@ -48,11 +57,13 @@ MagnifyOptions::MagnifyOptions(QWidget *parent) :
     connect(ui->AmplificationSpinBox, SIGNAL(valueChanged(int)), SLOT(updateSettingsFromOptionsTab()));
     connect(ui->COWavelengthSpinBox, SIGNAL(valueChanged(double)), SLOT(updateSettingsFromOptionsTab()));
     connect(ui->LevelsSpinBox, SIGNAL(valueChanged(int)), SLOT(updateSettingsFromOptionsTab()));
+    connect(ui->RieszFilterComboBox, SIGNAL(currentIndexChanged(int)), SLOT(updateSettingsFromOptionsTab()));
+    connect(ui->TemporalStorageComboBox, SIGNAL(currentIndexChanged(int)), SLOT(updateSettingsFromOptionsTab()));
 
     // Update Spinbox
     connect(ui->COWavelengthSlider, SIGNAL(valueChanged(int)), this, SLOT(convertFromSlider(int)));
-    connect(doubleSlider, SIGNAL(lowerPositionChanged(int)), this, SLOT(convertFromSlider(int)));
-    connect(doubleSlider, SIGNAL(upperPositionChanged(int)), this, SLOT(convertFromSlider(int)));
+    connect(doubleSlider, SIGNAL(lowerValueChanged(int)), this, SLOT(convertFromSlider(int)));
+    connect(doubleSlider, SIGNAL(upperValueChanged(int)), this, SLOT(convertFromSlider(int)));
     connect(ui->ChromSlider, SIGNAL(valueChanged(int)), this, SLOT(convertFromSlider(int)));
 
     // Update Slider
@@ -90,7 +101,7 @@ void MagnifyOptions::convertFromSpinBox(double val)
         if(sender() == ui->COWavelengthSpinBox)
             ui->COWavelengthSlider->setValue(static_cast<int>(val*10.0));
     }
-    else if(imgProcFlags.laplaceMagnifyOn) {
+    else if(imgProcFlags.laplaceMagnifyOn || imgProcFlags.waveletMagnifyOn) {
         if(sender() == ui->COLowDoubleSpinBox)
             doubleSlider->setLowerValue(static_cast<int>(val));
         if(sender() == ui->COHighDoubleSpinBox)
@@ -115,23 +126,23 @@ void MagnifyOptions::convertFromSlider(int val)
     {
         if(imgProcFlags.colorMagnifyOn)
         {
-            if(val == doubleSlider->lowerPosition())
+            if(val == doubleSlider->GetLowerValue())
                 ui->COLowDoubleSpinBox->setValue(v/100.0);
-            else if( val == doubleSlider->upperPosition())
+            else if( val == doubleSlider->GetUpperValue())
                 ui->COHighDoubleSpinBox->setValue(v/100.0);
         }
-        else if(imgProcFlags.laplaceMagnifyOn)
+        else if(imgProcFlags.laplaceMagnifyOn || imgProcFlags.waveletMagnifyOn)
         {
-            if(val == doubleSlider->lowerPosition())
+            if(val == doubleSlider->GetLowerValue())
                 ui->COLowDoubleSpinBox->setValue(v);
-            else if( val == doubleSlider->upperPosition())
+            else if( val == doubleSlider->GetUpperValue())
                 ui->COHighDoubleSpinBox->setValue(v);
         }
         else if(imgProcFlags.rieszMagnifyOn)
         {
-            if(val == doubleSlider->lowerPosition())
+            if(val == doubleSlider->GetLowerValue())
                 ui->COLowDoubleSpinBox->setValue(v/100.0);
-            else if( val == doubleSlider->upperPosition())
+            else if( val == doubleSlider->GetUpperValue())
                 ui->COHighDoubleSpinBox->setValue(v/100.0);
         }
     }
@@ -194,10 +205,33 @@ void MagnifyOptions::reset()
         doubleSlider->setLowerValue(static_cast<int>(DEFAULT_PB_COLOW*100.0));
         ui->COHighDoubleSpinBox->setValue(DEFAULT_PB_COHIGH);
         doubleSlider->setUpperValue(static_cast<int>(DEFAULT_PB_COHIGH*100.0));
+        ui->RieszFilterComboBox->setCurrentIndex(DEFAULT_RIESZ_FILTER_RANK);
+        updateSettingsFromOptionsTab();
+        break;
+    case 4:
+        // Same IIR controls as Laplace, only the luminance is magnified
+        applyLaplaceInterface();
+        ui->ChromSpinBox->hide();
+        ui->ChromSlider->hide();
+        ui->ChromLabel->hide();
+        ui->ChromValLabel->hide();
+        ui->LevelsSpinBox->setValue(DEFAULT_LAP_MAG_LEVELS);
+        ui->AmplificationSpinBox->setValue(DEFAULT_MM_AMPLIFICATION);
+        ui->AmplificationSlider->setValue(DEFAULT_MM_AMPLIFICATION);
+        ui->COWavelengthSpinBox->setValue(DEFAULT_MM_COWAVELENGTH);
+        ui->COWavelengthSlider->setValue(DEFAULT_MM_COWAVELENGTH);
+        ui->COLowDoubleSpinBox->setValue(DEFAULT_MM_COLOW);
+        doubleSlider->setLowerValue(static_cast<int>(DEFAULT_MM_COLOW));
+        ui->COHighDoubleSpinBox->setValue(DEFAULT_MM_COHIGH);
+        doubleSlider->setUpperValue(static_cast<int>(DEFAULT_MM_COHIGH));
         updateSettingsFromOptionsTab();
         break;
     default:  
         ui->LevelsSpinBox->setDisabled(true);
+        ui->RieszFilterLabel->hide();
+        ui->RieszFilterComboBox->hide();
+        ui->TemporalStorageLabel->hide();
+        ui->TemporalStorageComboBox->hide();
         ui->verticalSpacer->changeSize(0,0,QSizePolicy::Maximum, QSizePolicy::Maximum);
 
         ui->AmplificationLabel->hide();
@@ -246,6 +280,7 @@ void MagnifyOptions::updateFlagsFromOptionsTab()
     imgProcFlags.colorMagnifyOn = (ui->MagnifcationtypeComboBox->currentIndex() == 1);
     imgProcFlags.laplaceMagnifyOn = (ui->MagnifcationtypeComboBox->currentIndex() == 2);
     imgProcFlags.rieszMagnifyOn = (ui->MagnifcationtypeComboBox->currentIndex() == 3);
+    imgProcFlags.waveletMagnifyOn = (ui->MagnifcationtypeComboBox->currentIndex() == 4);
 
     emit newImageProcessingFlags(imgProcFlags);
 }
@@ -271,8 +306,9 @@ void MagnifyOptions::updateSettingsFromOptionsTab()
 
         imgProcSettings.chromAttenuation = ui->ChromSpinBox->value()/100.0;
         imgProcSettings.levels = ui->LevelsSpinBox->value();
+        imgProcSettings.temporalStorage = ui->TemporalStorageComboBox->currentIndex();
     }
-    else if(imgProcFlags.laplaceMagnifyOn)
+    else if(imgProcFlags.laplaceMagnifyOn || imgProcFlags.waveletMagnifyOn)
     {
         imgProcSettings.amplification = ui->AmplificationSpinBox->value();
         imgProcSettings.coWavelength = ui->COWavelengthSpinBox->value()*10.0;
@@ -282,6 +318,7 @@ void MagnifyOptions::updateSettingsFromOptionsTab()
 
         imgProcSettings.chromAttenuation = ui->ChromSpinBox->value()/100.0;
         imgProcSettings.levels = ui->LevelsSpinBox->value();
+        imgProcSettings.temporalStorage = ui->TemporalStorageComboBox->currentIndex();
     }
     else if(imgProcFlags.rieszMagnifyOn)
     {
@@ -290,6 +327,7 @@ void MagnifyOptions::updateSettingsFromOptionsTab()
         imgProcSettings.coLow = ui->COLowDoubleSpinBox->value();
         imgProcSettings.coHigh = ui->COHighDoubleSpinBox->value();
         imgProcSettings.levels = ui->LevelsSpinBox->value();
+        imgProcSettings.rieszFilterRank = ui->RieszFilterComboBox->currentIndex();
     }
 
     emit newImageProcessingSettings(imgProcSettings);
@@ -309,6 +347,10 @@ void MagnifyOptions::applyColorInterface()
 {
     ui->LevelsSpinBox->setDisabled(false);
     ui->verticalSpacer->changeSize(0,20,QSizePolicy::Maximum, QSizePolicy::Maximum);
+    ui->RieszFilterLabel->hide();
+    ui->RieszFilterComboBox->hide();
+    ui->TemporalStorageLabel->show();
+    ui->TemporalStorageComboBox->show();
 
     doubleSlider->setMaximum(300);
     ui->COHighDoubleSpinBox->setMaximum(3.0);
@@ -351,6 +393,10 @@ void MagnifyOptions::applyLaplaceInterface()
 {
     ui->LevelsSpinBox->setDisabled(false);
     ui->verticalSpacer->changeSize(0,20,QSizePolicy::Maximum, QSizePolicy::Maximum);
+    ui->RieszFilterLabel->hide();
+    ui->RieszFilterComboBox->hide();
+    ui->TemporalStorageLabel->show();
+    ui->TemporalStorageComboBox->show();
 
     doubleSlider->setMaximum(100);
     ui->COHighDoubleSpinBox->setMaximum(100.0);
@@ -396,6 +442,10 @@ void MagnifyOptions::applyRieszInterface()
 {
     ui->LevelsSpinBox->setDisabled(false);
     ui->verticalSpacer->changeSize(0,20,QSizePolicy::Maximum, QSizePolicy::Maximum);
+    ui->RieszFilterLabel->show();
+    ui->RieszFilterComboBox->show();
+    ui->TemporalStorageLabel->hide();
+    ui->TemporalStorageComboBox->hide();
 
     ui->AmplificationLabel->show();
     ui->AmplificationSlider->show();
@@ -28,7 +28,7 @@
 // Qt
 #include <QWidget>
 // Local
-//#include "external/qxtSlider/qxtspanslider.h"
+#include "main/helper/RangeSlider.h"
 #include "main/other/Structures.h"
 #include "main/other/Config.h"
 
@@ -46,16 +46,16 @@ public:
     ImageProcessingSettings getSettings();
     ImageProcessingFlags getFlags();
     void toggleGrayscale(bool isActive);
-    void setFPS(double fps);
 
 private:
     Ui::MagnifyOptions *ui;
-    //QxtSpanSlider *doubleSlider;
+    RangeSlider *doubleSlider;
     ImageProcessingSettings imgProcSettings;
     ImageProcessingFlags imgProcFlags;
 
 public slots:
     void setMaxLevel(int level);
+    void setFPS(double fps);
     void reset();
 
 private slots:
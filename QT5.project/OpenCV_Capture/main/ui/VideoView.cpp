@@ -59,9 +59,10 @@ VideoView::VideoView(QWidget *parent, QString filepath) :
 	// Initialize ImageProcessingFlags structure
 	imageProcessingFlags.grayscaleOn = false;
 	imageProcessingFlags.hsvHistogramOn = false;
-	//imageProcessingFlags.colorMagnifyOn = false;
-	//imageProcessingFlags.laplaceMagnifyOn = false;
-	//imageProcessingFlags.rieszMagnifyOn = false;
+	imageProcessingFlags.colorMagnifyOn = false;
+	imageProcessingFlags.laplaceMagnifyOn = false;
+	imageProcessingFlags.rieszMagnifyOn = false;
+	imageProcessingFlags.waveletMagnifyOn = false;
 
 	// Connect signals/slots
 	connect(ui->hideSettingsButton, SIGNAL(released()), this, SLOT(hideSettings()));
@@ -109,7 +110,6 @@ VideoView::~VideoView()
 	delete vidSaver;
 	// Delete UI integrated Pointer
 	delete originalFrame;
-	//delete magnifyOptionsTab;
 	// Delete UI
 	delete ui;
 }
@@ -126,11 +126,11 @@ bool VideoView::loadVideo(int threadPrio, int width, int height, double fps)
 	if (playerThread->loadFile()) {
 		ui->frameLabel->setText("Video loaded");
 
-		// Create MagnifyOptions tab and set current
-		//this->magnifyOptionsTab = new MagnifyOptions();
-		//this->magnifyOptionsTab->setFPS(playerThread->getFPS());
-		//this->magnifyOptionsTab->reset();
-		//ui->tabWidget->insertTab(0, magnifyOptionsTab, tr("Options"));
+		// Create MagnifyOptions tab (appended, so the existing tab indices stay), keep first tab current
+		this->magnifyOptionsTab = new MagnifyOptions(this);
+		this->magnifyOptionsTab->setFPS(playerThread->getFPS());
+		this->magnifyOptionsTab->reset();
+		ui->tabWidget->addTab(magnifyOptionsTab, tr("Magnify"));
 		ui->tabWidget->setCurrentIndex(0);
 		ui->InfoTab->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Ignored);
 
@@ -144,16 +144,16 @@ bool VideoView::loadVideo(int threadPrio, int width, int height, double fps)
 		ui->listViewCapture->setUniformItemSizes(true);
 
 		// Setup signal/slot connections
-		//connect(playerThread, SIGNAL(maxLevels(int)), magnifyOptionsTab, SLOT(setMaxLevel(int)));
 		connect(ui->tabWidget, SIGNAL(currentChanged(int)), this, SLOT(handleTabChange(int)));
 		connect(this, SIGNAL(newImageProcessingFlags(ImageProcessingFlags)), playerThread, SLOT(updateImageProcessingFlags(ImageProcessingFlags)));
 		connect(this, SIGNAL(newProcessingSettings(ImageProcessingSettings)), playerThread, SLOT(updateProcessingSettings(ImageProcessingSettings)));
 
 		connect(this, SIGNAL(setROI(QRect)), playerThread, SLOT(setROI(QRect)));
-		//connect(playerThread, SIGNAL(maxLevels(int)), magnifyOptionsTab, SLOT(setMaxLevel(int)));
-		// Setup signal/slot connections for MagnifyOptions
-		//connect(magnifyOptionsTab, SIGNAL(newImageProcessingSettings(struct ImageProcessingSettings)), playerThread, SLOT(updateImageProcessingSettings(struct ImageProcessingSettings)));
-		//connect(magnifyOptionsTab, SIGNAL(newImageProcessingFlags(struct ImageProcessingFlags)), playerThread, SLOT(updateImageProcessingFlags(struct ImageProcessingFlags)));
+		connect(ui->frameLabel, SIGNAL(newDisplaySize(QSize)), playerThread, SLOT(setDisplaySize(QSize)));
+		connect(playerThread, SIGNAL(maxLevels(int)), magnifyOptionsTab, SLOT(setMaxLevel(int)));
+		// Setup signal/slot connections for MagnifyOptions, merged into the view's flags/settings
+		connect(magnifyOptionsTab, SIGNAL(newImageProcessingSettings(struct ImageProcessingSettings)), this, SLOT(updateMagnifySettings(struct ImageProcessingSettings)));
+		connect(magnifyOptionsTab, SIGNAL(newImageProcessingFlags(struct ImageProcessingFlags)), this, SLOT(updateMagnifyFlags(struct ImageProcessingFlags)));
 		// Setup signal/slot for PlayerThread
 		connect(playerThread, SIGNAL(endOfFrame()), this, SLOT(endOfFrame_action()));
 		connect(playerThread, SIGNAL(updateStatisticsInGUI(struct ThreadStatisticsData)), this, SLOT(updatePlayerThreadStats(struct ThreadStatisticsData)));
@@ -178,6 +178,7 @@ bool VideoView::loadVideo(int threadPrio, int width, int height, double fps)
 
 		// Set initial data in player thread
 		emit setROI(QRect(0, 0, playerThread->getInputSourceWidth(), playerThread->getInputSourceHeight()));
+		playerThread->setDisplaySize(ui->frameLabel->size());
 		emit newImageProcessingFlags(imageProcessingFlags);
 		emit newProcessingSettings(imgSettings);
 
@@ -198,7 +199,7 @@ bool VideoView::loadVideo(int threadPrio, int width, int height, double fps)
 void VideoView::updateOriginalFrame(const QImage &frame)
 {
 	// Display frame
-	originalFrame->setPixmap(QPixmap::fromImage(frame).scaled(ui->frameLabel->width(), ui->frameLabel->height(), Qt::KeepAspectRatio));
+	originalFrame->setFrame(frame);
 }
 
 QString VideoView::getFormattedTime(int timeInSeconds)
@@ -239,8 +240,15 @@ void VideoView::updatePlayerThreadStats(struct ThreadStatisticsData statData)
 	ui->captureRateLabel->setText(QString::number(statData.averageFPS));
 	ui->currentFrameNumberLabel->setText(QString::number(statData.nFramesProcessed));
 
-	// Show processing rate in processingRateLabel
-	ui->processingRateLabel->setText(QString::number(statData.averageVidProcessingFPS) + " fps");
+	// Show processing rate in processingRateLabel, with memory and bandwidth of the magnification state
+	QString rate = QString::number(statData.averageVidProcessingFPS) + " fps";
+	int magnifyMode = Magnificator::modeFromFlags(imgProcFlags);
+	if (magnifyMode != MAGNIFY_NONE) {
+		MagnifyCounters counters = playerThread->getMagnifyCounters(magnifyMode);
+		rate += QString(" | ") + QString::number(counters.stateBytes / 1048576.0, 'f', 1) + tr(" MB state, ") +
+			QString::number(counters.trafficBytes / 1048576.0, 'f', 1) + tr(" MB/frame");
+	}
+	ui->processingRateLabel->setText(rate);
 	// Show ROI information in roiLabel
 	ui->roiLabel->setText(QString("(") + QString::number(playerThread->getCurrentROI().x()) + QString(",") +
 			      QString::number(playerThread->getCurrentROI().y()) + QString(") ") +
@@ -250,10 +258,8 @@ void VideoView::updatePlayerThreadStats(struct ThreadStatisticsData statData)
 
 void VideoView::updateFrame(const QImage &frame)
 {
-	int w = ui->frameLabel->width();
-	int h = ui->frameLabel->height();
 	// Display frame
-	ui->frameLabel->setPixmap(QPixmap::fromImage(frame).scaled(w, h, Qt::KeepAspectRatio));
+	ui->frameLabel->setFrame(frame);
 }
 
 void VideoView::updateMouseCursorPosLabel()
@@ -264,11 +270,11 @@ void VideoView::updateMouseCursorPosLabel()
 					 QString(")"));
 
 	// Show pixel cursor position if camera is connected (image is being shown)
-	if (ui->frameLabel->pixmap() != 0) {
+	if (ui->frameLabel->hasFrame()) {
 		// Scaling factor calculation depends on whether frame is scaled to fit label or not
 		if (!ui->frameLabel->hasScaledContents()) {
-			double xScalingFactor = ((double)ui->frameLabel->getMouseCursorPos().x() - ((ui->frameLabel->width() - ui->frameLabel->pixmap()->width()) / 2)) / (double)ui->frameLabel->pixmap()->width();
-			double yScalingFactor = ((double)ui->frameLabel->getMouseCursorPos().y() - ((ui->frameLabel->height() - ui->frameLabel->pixmap()->height()) / 2)) / (double)ui->frameLabel->pixmap()->height();
+			double xScalingFactor = ((double)ui->frameLabel->getMouseCursorPos().x() - ((ui->frameLabel->width() - ui->frameLabel->getFrameSize().width()) / 2)) / (double)ui->frameLabel->getFrameSize().width();
+			double yScalingFactor = ((double)ui->frameLabel->getMouseCursorPos().y() - ((ui->frameLabel->height() - ui->frameLabel->getFrameSize().height()) / 2)) / (double)ui->frameLabel->getFrameSize().height();
 
 			ui->mouseCursorPosLabel->setText(ui->mouseCursorPosLabel->text() +
 							 QString(" [") + QString::number((int)(xScalingFactor * playerThread->getCurrentROI().width())) +
@@ -301,10 +307,10 @@ void VideoView::newMouseData(struct MouseData mouseData)
 
 		// Selection box calculation depends on whether frame is scaled to fit label or not
 		if (!ui->frameLabel->hasScaledContents()) {
-			xScalingFactor = ((double)mouseData.selectionBox.x() - ((ui->frameLabel->width() - ui->frameLabel->pixmap()->width()) / 2)) / (double)ui->frameLabel->pixmap()->width();
-			yScalingFactor = ((double)mouseData.selectionBox.y() - ((ui->frameLabel->height() - ui->frameLabel->pixmap()->height()) / 2)) / (double)ui->frameLabel->pixmap()->height();
-			wScalingFactor = (double)playerThread->getCurrentROI().width() / (double)ui->frameLabel->pixmap()->width();
-			hScalingFactor = (double)playerThread->getCurrentROI().height() / (double)ui->frameLabel->pixmap()->height();
+			xScalingFactor = ((double)mouseData.selectionBox.x() - ((ui->frameLabel->width() - ui->frameLabel->getFrameSize().width()) / 2)) / (double)ui->frameLabel->getFrameSize().width();
+			yScalingFactor = ((double)mouseData.selectionBox.y() - ((ui->frameLabel->height() - ui->frameLabel->getFrameSize().height()) / 2)) / (double)ui->frameLabel->getFrameSize().height();
+			wScalingFactor = (double)playerThread->getCurrentROI().width() / (double)ui->frameLabel->getFrameSize().width();
+			hScalingFactor = (double)playerThread->getCurrentROI().height() / (double)ui->frameLabel->getFrameSize().height();
 		}else {
 			xScalingFactor = (double)mouseData.selectionBox.x() / (double)ui->frameLabel->width();
 			yScalingFactor = (double)mouseData.selectionBox.y() / (double)ui->frameLabel->height();
@@ -358,11 +364,11 @@ void VideoView::updateMouseCursorPosLabelOriginalFrame()
 					 QString(")"));
 
 	// Show pixel cursor position if camera is connected (image is being shown)
-	if (originalFrame->pixmap() != 0) {
+	if (originalFrame->hasFrame()) {
 		// Scaling factor calculation depends on whether frame is scaled to fit label or not
 		if (!originalFrame->hasScaledContents()) {
-			double xScalingFactor = ((double)originalFrame->getMouseCursorPos().x() - ((originalFrame->width() - originalFrame->pixmap()->width()) / 2)) / (double)originalFrame->pixmap()->width();
-			double yScalingFactor = ((double)originalFrame->getMouseCursorPos().y() - ((originalFrame->height() - originalFrame->pixmap()->height()) / 2)) / (double)originalFrame->pixmap()->height();
+			double xScalingFactor = ((double)originalFrame->getMouseCursorPos().x() - ((originalFrame->width() - originalFrame->getFrameSize().width()) / 2)) / (double)originalFrame->getFrameSize().width();
+			double yScalingFactor = ((double)originalFrame->getMouseCursorPos().y() - ((originalFrame->height() - originalFrame->getFrameSize().height()) / 2)) / (double)originalFrame->getFrameSize().height();
 
 			ui->mouseCursorPosLabel->setText(ui->mouseCursorPosLabel->text() +
 							 QString(" [") + QString::number((int)(xScalingFactor * playerThread->getCurrentROI().width())) +
@@ -395,10 +401,10 @@ void VideoView::newMouseDataOriginalFrame(struct MouseData mouseData)
 
 		// Selection box calculation depends on whether frame is scaled to fit label or not
 		if (!originalFrame->hasScaledContents()) {
-			xScalingFactor = ((double)mouseData.selectionBox.x() - ((originalFrame->width() - originalFrame->pixmap()->width()) / 2)) / (double)originalFrame->pixmap()->width();
-			yScalingFactor = ((double)mouseData.selectionBox.y() - ((originalFrame->height() - originalFrame->pixmap()->height()) / 2)) / (double)originalFrame->pixmap()->height();
-			wScalingFactor = (double)playerThread->getCurrentROI().width() / (double)originalFrame->pixmap()->width();
-			hScalingFactor = (double)playerThread->getCurrentROI().height() / (double)originalFrame->pixmap()->height();
+			xScalingFactor = ((double)mouseData.selectionBox.x() - ((originalFrame->width() - originalFrame->getFrameSize().width()) / 2)) / (double)originalFrame->getFrameSize().width();
+			yScalingFactor = ((double)mouseData.selectionBox.y() - ((originalFrame->height() - originalFrame->getFrameSize().height()) / 2)) / (double)originalFrame->getFrameSize().height();
+			wScalingFactor = (double)playerThread->getCurrentROI().width() / (double)originalFrame->getFrameSize().width();
+			hScalingFactor = (double)playerThread->getCurrentROI().height() / (double)originalFrame->getFrameSize().height();
 		}else {
 			xScalingFactor = (double)mouseData.selectionBox.x() / (double)originalFrame->width();
 			yScalingFactor = (double)mouseData.selectionBox.y() / (double)originalFrame->height();
@@ -534,13 +540,12 @@ void VideoView::save_action()
 	// First, load the file about to be processed
 	if (vidSaver->loadFile(source)) {
 		// Second, hand over the Settings for magnification
-		//imageProcessingFlags = magnifyOptionsTab->getFlags();
+		vidSaver->settings(imgProcFlags, imgSettings);
 
 		//Set Codec
 		int savingCodec = (useVideoCodec) ? vidSaver->getVideoCodec() : codec;
 		vidSaver->savingCodec = savingCodec;
 
-		//vidSaver->settings(magnifyOptionsTab->getFlags(), magnifyOptionsTab->getSettings());
 		// Third, start saving if destination is valid
 		//if (vidSaver->saveFile(destination, playerThread->getFPS(), playerThread->getCurrentROI(), ui->saveOriginalCheckBox->checkState())) {
 		if (vidSaver->saveFile(destination, playerThread->getFPS(), playerThread->getCurrentROI(), false)) {
@@ -581,6 +586,29 @@ void VideoView::handleTabChange(int index)
 		ui->InfoTab->setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Ignored);
 }
 
+// MagnifyOptions only owns the magnification part of flags/settings
+void VideoView::updateMagnifyFlags(struct ImageProcessingFlags flags)
+{
+	imgProcFlags.colorMagnifyOn = flags.colorMagnifyOn;
+	imgProcFlags.laplaceMagnifyOn = flags.laplaceMagnifyOn;
+	imgProcFlags.rieszMagnifyOn = flags.rieszMagnifyOn;
+	imgProcFlags.waveletMagnifyOn = flags.waveletMagnifyOn;
+	emit newImageProcessingFlags(imgProcFlags);
+}
+
+void VideoView::updateMagnifySettings(struct ImageProcessingSettings settings)
+{
+	imgSettings.amplification = settings.amplification;
+	imgSettings.coWavelength = settings.coWavelength;
+	imgSettings.coLow = settings.coLow;
+	imgSettings.coHigh = settings.coHigh;
+	imgSettings.chromAttenuation = settings.chromAttenuation;
+	imgSettings.levels = settings.levels;
+	imgSettings.rieszFilterRank = settings.rieszFilterRank;
+	imgSettings.temporalStorage = settings.temporalStorage;
+	emit newProcessingSettings(imgSettings);
+}
+
 void VideoView::setCodec(int codec)
 {
 	this->codec = codec;
@@ -684,6 +712,12 @@ void VideoView::on_checkBoxMeanShift_clicked(bool checked)
 	emit newImageProcessingFlags(imgProcFlags);
 }
 
+void VideoView::on_checkBoxMeanShiftSegment_clicked(bool checked)
+{
+	imgProcFlags.meanshiftSegmentOn = checked;
+	emit newImageProcessingFlags(imgProcFlags);
+}
+
 void VideoView::on_checkBoxCartoon_clicked(bool checked)
 {
 	imgProcFlags.cartoonOn = checked;
@@ -812,10 +846,10 @@ void VideoView::on_pushButtonShot_clicked()
 	qDebug() << "folder:" << MyUtils::stringMyFolder();
 	qDebug() << "fname: " << fname;
 
-	//const QPixmap *pm = ui->frameLabel->pixmap(Qt::ReturnByValueConstant); //deprecated!
-	QPixmap pm = ui->frameLabel->pixmap(Qt::ReturnByValue);
-	if (!pm.isNull()) {
-		pm.save(fname, nullptr);
+	// Save the full resolution frame, not the display sized one
+	Mat shot;
+	if (isFileLoaded && playerThread->getCurrentFrame(shot)) {
+		MatToQImage(shot).save(fname, nullptr);
 
 		//Append frame to listView
 		QStandardItem * item = new QStandardItem();
@@ -849,14 +883,14 @@ void VideoView::on_buttonMorphGradient_clicked()
 
 void VideoView::on_buttonShotSend_clicked()
 {
-	QPixmap pm = ui->frameLabel->pixmap(Qt::ReturnByValue);
-	if (!pm.isNull()) {
+	Mat shot;
+	if (isFileLoaded && playerThread->getCurrentFrame(shot)) {
 		QString sIP = ui->lineEditIP->text();
 		int iPort = ui->lineEditPort->text().toInt();
 		if ((!sIP.isEmpty()) && (iPort > 0)) {
 			myTcpSendPix = new TcpSendPix(sIP, iPort);
 
-			myTcpSendPix->send(pm);
+			myTcpSendPix->send(QPixmap::fromImage(MatToQImage(shot)));
 			qDebug() << "TcpSend:" << sIP << iPort;
 		}
 	}
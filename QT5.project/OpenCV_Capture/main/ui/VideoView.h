@@ -31,7 +31,7 @@
 #include <QFileDialog>
 #include <QStandardItem>
 // Local
-//#include "main/ui/MagnifyOptions.h"
+#include "main/ui/MagnifyOptions.h"
 #include "main/other/Structures.h"
 #include "main/threads/PlayerThread.h"
 #include "main/ui/FrameLabel.h"
@@ -64,7 +64,7 @@ private:
 	PlayerThread *playerThread;
 	ImageProcessingFlags imageProcessingFlags;
 	bool isFileLoaded;
-	//MagnifyOptions *magnifyOptionsTab;
+	MagnifyOptions *magnifyOptionsTab;
 	void stopPlayerThread();
 	QString getFormattedTime(int time);
 	void handleOriginalWindow(bool doEmit);
@@ -96,6 +96,8 @@ private slots:
 	void hideSettings();
 	void save_action();
 	void handleTabChange(int index);
+	void updateMagnifyFlags(struct ImageProcessingFlags flags);
+	void updateMagnifySettings(struct ImageProcessingSettings settings);
 
 	void on_checkBoxGrayscale_clicked(bool checked);
 	void on_checkBoxHsvHistogram_clicked(bool checked);
@@ -134,6 +136,7 @@ private slots:
 	void on_buttonShotSend_clicked();
 
 	void on_checkBoxMeanShift_clicked(bool checked);
+	void on_checkBoxMeanShiftSegment_clicked(bool checked);
 
 	void on_checkBoxCartoon_clicked(bool checked);
 